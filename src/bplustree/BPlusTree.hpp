@@ -9,17 +9,24 @@
 #include "Node.hpp"
 
 #include "buffer.hpp"
+#include "file.hpp"
 #include "segment.hpp"
 
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <ostream>
+#include <tuple>
 #include <utility>
 
 namespace simpledb {
 
-    template <typename K, typename V, typename C = std::less<K>>
+    /**
+     * B+-tree stored in a segment with pages of PAGE_SIZE.
+     * The degrees of the nodes derive from the page size, so larger pages give a higher fanout.
+     * In mapped mode the tree is read-only, lookups read the nodes from a memory mapping of the segment file instead of frames.
+     */
+    template <typename K, typename V, typename C = std::less<K>, uint64_t PAGE_SIZE = BufferManager::PAGE_SIZE>
     class BPlusTree {
     public:
         using key_type = K;
@@ -27,24 +34,25 @@ namespace simpledb {
         using size_type = uint64_t;
         using comparator = C;
 
-        static constexpr uint64_t INNER_DEGREE = (BufferManager::PAGE_SIZE - sizeof (InnerNode<K, V, C, 0>) - sizeof (PageId)) / (2 * (sizeof (K) + sizeof (PageId)));
-        static_assert(sizeof (InnerNode<K, V, C, 0>) + 2 * INNER_DEGREE * sizeof (K) + (2 * INNER_DEGREE + 1) * sizeof (PageId) <= BufferManager::PAGE_SIZE, "");
+        static constexpr uint64_t INNER_DEGREE = (PAGE_SIZE - sizeof (InnerNode<K, V, C, 0>) - sizeof (PageId)) / (2 * (sizeof (K) + sizeof (PageId)));
+        static_assert(sizeof (InnerNode<K, V, C, 0>) + 2 * INNER_DEGREE * sizeof (K) + (2 * INNER_DEGREE + 1) * sizeof (PageId) <= PAGE_SIZE, "");
         //static constexpr uint64_t INNER_DEGREE = 2; // = k
 
-        static constexpr uint64_t LEAF_DEGREE = (BufferManager::PAGE_SIZE - sizeof (LeafNode<K, V, C, 0>)) / (2 * (sizeof (K) + sizeof (V)));
-        static_assert(sizeof (LeafNode<K, V, C, 0>) + 2 * LEAF_DEGREE * sizeof (K) + 2 * LEAF_DEGREE * sizeof (V) <= BufferManager::PAGE_SIZE, "");
+        static constexpr uint64_t LEAF_DEGREE = (PAGE_SIZE - sizeof (LeafNode<K, V, C, 0>)) / (2 * (sizeof (K) + sizeof (V)));
+        static_assert(sizeof (LeafNode<K, V, C, 0>) + 2 * LEAF_DEGREE * sizeof (K) + 2 * LEAF_DEGREE * sizeof (V) <= PAGE_SIZE, "");
         //static constexpr uint64_t LEAF_DEGREE = 2;
 
-        using iterator = BPlusTreeIterator<BPlusTree<K, V, C>, false>;
-        using exclusive_iterator = BPlusTreeIterator<BPlusTree<K, V, C>, true>;
+        using iterator = BPlusTreeIterator<BPlusTree<K, V, C, PAGE_SIZE>, false>;
+        using exclusive_iterator = BPlusTreeIterator<BPlusTree<K, V, C, PAGE_SIZE>, true>;
 
         /**
          * Constructs a new b+ tree segment.
-         * @param segmentId the segment id
+         * @param segmentId the segment id, the segment must have pages of PAGE_SIZE
          * @param segmentManager the segment manager
          * @param bufferManager the buffer manager
+         * @param access buffered, to read and write the nodes in frames; mapped, to look up keys in an existing immutable tree from a mapping
          */
-        BPlusTree(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager);
+        BPlusTree(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager, SegmentAccess access = SegmentAccess::buffered);
         ~BPlusTree() = default;
 
         BPlusTree(const BPlusTree& orig) = delete;
@@ -65,6 +73,7 @@ namespace simpledb {
         V lookup(K key);
 
         /**
+         * Range lookups fix the leaves in frames, also in mapped mode.
          * @param key the key
          * @return returns an iterator to iterate from the given key to the end of the tree
          */
@@ -98,8 +107,25 @@ namespace simpledb {
         uint64_t _segmentId; // the segment id
         std::shared_ptr<SegmentManager> _segmentManager; // the segment manager
         std::shared_ptr<BufferManager> _bufferManager; // the buffer manager
+        std::unique_ptr<MappedFile> _mapping; // the mapping of the segment file in mapped mode; nullptr, if the nodes are fixed
 
-        std::shared_ptr<BufferFrame> lookupPage(K key, bool exclusive, bool leftmost);
+        PageGuard lookupPage(K key, bool exclusive, bool leftmost);
+
+        /**
+         * Looks up a key in mapped mode. The nodes don't change, so they are read without validation.
+         * @param key the key
+         * @return the corresponding value, or the default value, if the key does not exist
+         */
+        V lookupMapped(K key);
+
+        /**
+         * Swizzles the reference to a child of a node read optimistically, if the node wasn't modified since.
+         * @param nodeFrame the frame of the node
+         * @param nodeVersion the version of the node, updated to the version after swizzling
+         * @param slot the slot of the child
+         * @param reference the swizzled reference to the child
+         */
+        void swizzleChild(BufferFrame* nodeFrame, uint64_t& nodeVersion, uint64_t slot, PageId reference);
         void allocate(uint64_t size);
         PageId newPage();
     };
@@ -1,15 +1,24 @@
 
 namespace simpledb {
 
-    template <typename K, typename V, typename C>
-    BPlusTree<K, V, C>::BPlusTree(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager) : _segmentId(segmentId), _segmentManager(segmentManager), _bufferManager(bufferManager) {
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    BPlusTree<K, V, C, PAGE_SIZE>::BPlusTree(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager, SegmentAccess access) : _segmentId(segmentId), _segmentManager(segmentManager), _bufferManager(bufferManager), _mapping() {
+        assert(_segmentManager->retrieve(_segmentId)->pageSize() == PAGE_SIZE); // the template parameter must match the segment
+
+        if (access == SegmentAccess::mapped) {
+            assert(_segmentManager->retrieve(_segmentId)->size() >= MIN_PAGE_NUMBER); // a mapped tree can't be initialized
+            _mapping = _segmentManager->map(_segmentId, MapAdvice::random);
+            return;
+        }
         allocate(MIN_PAGE_NUMBER);
     }
 
-    template <typename K, typename V, typename C>
-    void BPlusTree<K, V, C>::insert(K key, V value) {
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    void BPlusTree<K, V, C, PAGE_SIZE>::insert(K key, V value) {
+        assert(!_mapping); // mapped trees are read-only
+
         { // free space on page? -> normal insert
-            std::shared_ptr<BufferFrame> leafFrame = lookupPage(key, true, false);
+            PageGuard leafFrame = lookupPage(key, true, false);
             LeafNode<K, V, C, LEAF_DEGREE> *leafNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (leafFrame->getData());
 
             if (leafNode->hasFreeSpace()) {
@@ -24,7 +33,7 @@ namespace simpledb {
         // no free space on page? -> preventive splitting insert with exclusive access
         PageId rootId(_segmentId, ROOT_PAGE_ID);
 
-        std::shared_ptr<BufferFrame> rootFrame = _bufferManager->fixPage(rootId.segment, rootId.page, true);
+        PageGuard rootFrame = _bufferManager->fixPage(rootId.segment, rootId.page, true);
         InnerNode<K, V, C, INNER_DEGREE> *rootNode = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (rootFrame->getData());
 
         bool dirtyParent = false;
@@ -32,7 +41,7 @@ namespace simpledb {
         // ensure space on root node
         if (!rootNode->hasFreeSpace()) {
             PageId newPages[]{newPage(), newPage()};
-            std::shared_ptr<BufferFrame> newFrames[]{
+            PageGuard newFrames[]{
                 _bufferManager->fixPage(newPages[0].segment, newPages[0].page, true),
                 _bufferManager->fixPage(newPages[1].segment, newPages[1].page, true),
             };
@@ -48,11 +57,11 @@ namespace simpledb {
             dirtyParent = true;
         }
 
-        std::shared_ptr<BufferFrame> parentFrame = std::move(rootFrame);
+        PageGuard parentFrame = std::move(rootFrame);
         InnerNode<K, V, C, INNER_DEGREE> *parentNode = rootNode;
 
         PageId nodeId = rootNode->lookup(key);
-        std::shared_ptr<BufferFrame> nodeFrame = _bufferManager->fixPage(nodeId.segment, nodeId.page, true);
+        PageGuard nodeFrame = _bufferManager->fixPage(nodeId.segment, nodeId.page, true);
         Node<K, V, C> *node = reinterpret_cast<Node<K, V, C>*> (nodeFrame->getData());
 
         while (!node->isLeaf()) {
@@ -62,7 +71,7 @@ namespace simpledb {
             if (!innerNode->hasFreeSpace()) {
                 // reserve new page
                 PageId newPageId = newPage();
-                std::shared_ptr<BufferFrame> newFrame = _bufferManager->fixPage(newPageId.segment, newPageId.page, true);
+                PageGuard newFrame = _bufferManager->fixPage(newPageId.segment, newPageId.page, true);
                 InnerNode<K, V, C, INNER_DEGREE> *newNode = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (newFrame->getData());
 
                 // split node
@@ -110,7 +119,7 @@ namespace simpledb {
         if (!leafNode->hasFreeSpace()) {
             // reserve new page
             PageId newPageId = newPage();
-            std::shared_ptr<BufferFrame> newFrame = _bufferManager->fixPage(newPageId.segment, newPageId.page, true);
+            PageGuard newFrame = _bufferManager->fixPage(newPageId.segment, newPageId.page, true);
             LeafNode<K, V, C, LEAF_DEGREE> *newNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (newFrame->getData());
 
             // split node
@@ -147,9 +156,13 @@ namespace simpledb {
         _bufferManager->unfixPage(nodeFrame, true);
     }
 
-    template <typename K, typename V, typename C>
-    V BPlusTree<K, V, C>::lookup(K key) {
-        std::shared_ptr<BufferFrame> nodeFrame = lookupPage(key, false, false);
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    V BPlusTree<K, V, C, PAGE_SIZE>::lookup(K key) {
+        if (_mapping) {
+            return lookupMapped(key);
+        }
+
+        PageGuard nodeFrame = lookupPage(key, false, false);
 
         // find value
         LeafNode<K, V, C, LEAF_DEGREE> *leafNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (nodeFrame->getData());
@@ -160,20 +173,22 @@ namespace simpledb {
         return value;
     }
 
-    template <typename K, typename V, typename C>
-    typename BPlusTree<K, V, C>::iterator BPlusTree<K, V, C>::lookupRange(K key) {
-        std::shared_ptr<BufferFrame> nodeFrame = lookupPage(key, false, false);
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    typename BPlusTree<K, V, C, PAGE_SIZE>::iterator BPlusTree<K, V, C, PAGE_SIZE>::lookupRange(K key) {
+        PageGuard nodeFrame = lookupPage(key, false, false);
 
         // find index
         LeafNode<K, V, C, LEAF_DEGREE> *leafNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (nodeFrame->getData());
         int64_t index = leafNode->lookupIndex(key);
 
-        return BPlusTree<K, V, C>::iterator(index, nodeFrame, _bufferManager);
+        return BPlusTree<K, V, C, PAGE_SIZE>::iterator(index, std::move(nodeFrame), _bufferManager, _segmentManager->retrieve(_segmentId)->size());
     }
 
-    template <typename K, typename V, typename C>
-    bool BPlusTree<K, V, C>::erase(K key) {
-        std::shared_ptr<BufferFrame> nodeFrame = lookupPage(key, true, false);
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    bool BPlusTree<K, V, C, PAGE_SIZE>::erase(K key) {
+        assert(!_mapping); // mapped trees are read-only
+
+        PageGuard nodeFrame = lookupPage(key, true, false);
 
         // delete entry
         LeafNode<K, V, C, LEAF_DEGREE> *leafNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (nodeFrame->getData());
@@ -184,73 +199,129 @@ namespace simpledb {
         return res;
     }
 
-    template <typename K, typename V, typename C>
-    typename BPlusTree<K, V, C>::size_type BPlusTree<K, V, C>::size() {
-        std::shared_ptr<BufferFrame> nodeFrame = lookupPage(K(), false, true);
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    typename BPlusTree<K, V, C, PAGE_SIZE>::size_type BPlusTree<K, V, C, PAGE_SIZE>::size() {
+        PageGuard nodeFrame = lookupPage(K(), false, true);
 
-        BPlusTree<K, V, C>::iterator it(0, nodeFrame, _bufferManager);
+        BPlusTree<K, V, C, PAGE_SIZE>::iterator it(0, std::move(nodeFrame), _bufferManager, _segmentManager->retrieve(_segmentId)->size());
         uint64_t i = 0;
         for (; it.isValid(); ++it, ++i);
         return i;
     }
 
-    template <typename K, typename V, typename C>
-    void BPlusTree<K, V, C>::visualize(std::ostream& out) {
+    template <typename K, typename V, typename C, uint64_t PAGE_SIZE>
+    void BPlusTree<K, V, C, PAGE_SIZE>::visualize(std::ostream& out) {
         out << "digraph myBTree {\n";
 
         PageId rootId(_segmentId, ROOT_PAGE_ID);
-        std::shared_ptr<BufferFrame> nodeFrame = _bufferManager->fixPage(rootId.segment, rootId.page, false);
+        PageGuard nodeFrame = _bufferManager->fixPage(rootId.segment, rootId.page, false);
         InnerNode<K, V, C, INNER_DEGREE> *node = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (nodeFrame->getData());
 
         LeafNode<K, V, C, LEAF_DEGREE> *unusedLeafNode = nullptr;
-        node->visualize(rootId, nodeFrame, out, *_bufferManager, unusedLeafNode);
+        node->visualize(rootId, std::move(nodeFrame), out, *_bufferManager, unusedLeafNode);
 
         out << "}\n";
     }
 
-    template <class K, class V, class C>
-    std::shared_ptr<BufferFrame> BPlusTree<K, V, C>::lookupPage(K key, bool exclusive, bool leftmost) {
+    template <class K, class V, class C, uint64_t PAGE_SIZE>
+    PageGuard BPlusTree<K, V, C, PAGE_SIZE>::lookupPage(K key, bool exclusive, bool leftmost) {
         PageId rootId(_segmentId, ROOT_PAGE_ID);
 
-        std::shared_ptr<BufferFrame> nodeFrame = _bufferManager->fixPage(rootId.segment, rootId.page, false);
-        Node<K, V, C> *node = reinterpret_cast<Node<K, V, C>*> (nodeFrame->getData());
-        while (!node->isLeaf()) {
-            // search child page
-            InnerNode<K, V, C, INNER_DEGREE> *innerNode = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (node);
-            PageId childId;
-            if (!leftmost) { // normal key lookup
-                childId = innerNode->lookup(key);
-            } else { // leftmost child
-                childId = innerNode->leftmost();
+        // inner nodes are read optimistically, only the leaf is locked
+        // if a node was modified while reading it, restart from the root
+        while (true) {
+            BufferFrame *nodeFrame;
+            uint64_t nodeVersion;
+            std::tie(nodeFrame, nodeVersion) = _bufferManager->fixPageOptimistic(rootId.segment, rootId.page);
+
+            while (true) {
+                // search child page, check bounds as the node may be inconsistent
+                InnerNode<K, V, C, INNER_DEGREE> *innerNode = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (nodeFrame->getData());
+                if (!innerNode->hasValidSize()) {
+                    break;
+                }
+                uint64_t childSlot;
+                if (!leftmost) { // normal key lookup
+                    childSlot = innerNode->lookupSlot(key);
+                } else { // leftmost child
+                    childSlot = 0;
+                }
+                PageId childReference = innerNode->child(childSlot);
+                if (!nodeFrame->validate(nodeVersion)) {
+                    break;
+                }
+
+                // fix child page and check that the parent didn't change in the meantime (e.g. by a split)
+                // a swizzled reference is resolved without looking up the frame table
+                BufferFrame *childFrame;
+                uint64_t childVersion;
+                std::tie(childFrame, childVersion) = _bufferManager->fixPageOptimistic(childReference);
+                bool childIsLeaf = reinterpret_cast<Node<K, V, C>*> (childFrame->getData())->isLeaf();
+                if (!childFrame->validate(childVersion) || !nodeFrame->validate(nodeVersion)) {
+                    break;
+                }
+
+                // reference not swizzled or to a frame that doesn't hold the child anymore? -> swizzle it
+                PageId swizzledReference = _bufferManager->swizzle(BufferManager::unswizzle(childReference), childFrame);
+                if (!(swizzledReference == childReference)) {
+                    swizzleChild(nodeFrame, nodeVersion, childSlot, swizzledReference);
+                }
+
+                if (!childIsLeaf) {
+                    // new node is the child of the old node
+                    _bufferManager->unfixPageOptimistic(nodeFrame, nodeVersion);
+                    nodeFrame = childFrame;
+                    nodeVersion = childVersion;
+                    continue;
+                }
+
+                // lock leaf page, it must still be the child of the parent page
+                PageGuard leafFrame = _bufferManager->fixPage(swizzledReference, exclusive);
+                if (!_bufferManager->unfixPageOptimistic(nodeFrame, nodeVersion)) {
+                    _bufferManager->unfixPage(leafFrame, false);
+                    break;
+                }
+
+                return leafFrame;
             }
+        }
+    }
 
-            // fix child page
-            std::shared_ptr<BufferFrame> childFrame = _bufferManager->fixPage(childId.segment, childId.page, false);
-            Node<K, V, C> *childNode = reinterpret_cast<Node<K, V, C>*> (nodeFrame->getData());
-
-            // do we need exclusive access on leaf page?
-            if (exclusive && childNode->isLeaf()) {
-                // unfix and fix with exclusive access, do this BEFORE unfix on parent page! (lock coupling)
-                _bufferManager->unfixPage(childFrame, false);
-                childNode = nullptr;
-                childFrame.reset();
-                childFrame = _bufferManager->fixPage(childId.segment, childId.page, exclusive);
-            }
+    template <class K, class V, class C, uint64_t PAGE_SIZE>
+    V BPlusTree<K, V, C, PAGE_SIZE>::lookupMapped(K key) {
+        // the nodes are only read, child references written while they were swizzled are unswizzled by the lookup
+        Node<K, V, C> *node = reinterpret_cast<Node<K, V, C>*> (const_cast<char*> (_mapping->page(ROOT_PAGE_ID, PAGE_SIZE)));
+        while (!node->isLeaf()) {
+            PageId childId = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (node)->lookup(key);
+            node = reinterpret_cast<Node<K, V, C>*> (const_cast<char*> (_mapping->page(childId.page, PAGE_SIZE)));
+        }
 
-            // unfix parent page
-            _bufferManager->unfixPage(nodeFrame, false);
-            nodeFrame.reset();
+        return reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (node)->lookup(key);
+    }
 
-            // new node is the child of the old node
-            nodeFrame = std::move(childFrame);
-            node = reinterpret_cast<Node<K, V, C>*> (nodeFrame->getData());
+    template <class K, class V, class C, uint64_t PAGE_SIZE>
+    void BPlusTree<K, V, C, PAGE_SIZE>::swizzleChild(BufferFrame* nodeFrame, uint64_t& nodeVersion, uint64_t slot, PageId reference) {
+        // swizzling is only an optimization, so never wait for the lock
+        // the node was read optimistically, the lock must be the first one since then, otherwise the slot might have moved
+        if (!nodeFrame->tryLock(true)) {
+            return;
         }
+        if (nodeFrame->version() != nodeVersion + 1) {
+            nodeFrame->unlock(true);
+            return;
+        }
+
+        // the node's page on disk doesn't change, so the frame isn't dirty
+        InnerNode<K, V, C, INNER_DEGREE> *innerNode = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (nodeFrame->getData());
+        innerNode->swizzleChild(slot, reference);
+        nodeFrame->unlock(true);
 
-        return nodeFrame;
+        // nothing but the reference changed, continue reading with the version of the unlock
+        nodeVersion += 2;
     }
 
-    template <class K, class V, class C>
-    void BPlusTree<K, V, C>::allocate(uint64_t size) {
+    template <class K, class V, class C, uint64_t PAGE_SIZE>
+    void BPlusTree<K, V, C, PAGE_SIZE>::allocate(uint64_t size) {
         uint64_t oldSize = _segmentManager->retrieve(_segmentId)->size();
         if (oldSize >= size) {
             return;
@@ -263,19 +334,19 @@ namespace simpledb {
             assert(size >= MIN_PAGE_NUMBER);
 
             { // meta node
-                std::shared_ptr<BufferFrame> metaFrame = _bufferManager->fixPage(_segmentId, META_PAGE_ID, true);
+                PageGuard metaFrame = _bufferManager->fixPage(_segmentId, META_PAGE_ID, true);
                 MetaNode *metaNode = reinterpret_cast<MetaNode*> (metaFrame->getData());
                 metaNode->init(3);
                 _bufferManager->unfixPage(metaFrame, true);
             }
             { // root node
-                std::shared_ptr<BufferFrame> rootFrame = _bufferManager->fixPage(_segmentId, ROOT_PAGE_ID, true);
+                PageGuard rootFrame = _bufferManager->fixPage(_segmentId, ROOT_PAGE_ID, true);
                 InnerNode<K, V, C, INNER_DEGREE> *rootNode = reinterpret_cast<InnerNode<K, V, C, INNER_DEGREE>*> (rootFrame->getData());
                 rootNode->init(PageId(_segmentId, FIRST_LEAF_PAGE_ID));
                 _bufferManager->unfixPage(rootFrame, true);
             }
             { // first leaf node
-                std::shared_ptr<BufferFrame> leafFrame = _bufferManager->fixPage(_segmentId, FIRST_LEAF_PAGE_ID, true);
+                PageGuard leafFrame = _bufferManager->fixPage(_segmentId, FIRST_LEAF_PAGE_ID, true);
                 LeafNode<K, V, C, LEAF_DEGREE> *leafNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (leafFrame->getData());
                 leafNode->init();
                 _bufferManager->unfixPage(leafFrame, true);
@@ -283,9 +354,9 @@ namespace simpledb {
         }
     }
 
-    template <class K, class V, class C>
-    PageId BPlusTree<K, V, C>::newPage() {
-        std::shared_ptr<BufferFrame> metaFrame = _bufferManager->fixPage(_segmentId, META_PAGE_ID, true);
+    template <class K, class V, class C, uint64_t PAGE_SIZE>
+    PageId BPlusTree<K, V, C, PAGE_SIZE>::newPage() {
+        PageGuard metaFrame = _bufferManager->fixPage(_segmentId, META_PAGE_ID, true);
         MetaNode *metaNode = reinterpret_cast<MetaNode*> (metaFrame->getData());
         uint64_t newPageId = metaNode->nextFreePageId();
         _bufferManager->unfixPage(metaFrame, true);
@@ -18,7 +18,7 @@ namespace simpledb {
     public:
         using value_type = typename B::value_type;
 
-        BPlusTreeIterator(int64_t onPageIt, std::shared_ptr<BufferFrame> bufferFrame, std::shared_ptr<BufferManager> bufferManager);
+        BPlusTreeIterator(int64_t onPageIt, PageGuard bufferFrame, std::shared_ptr<BufferManager> bufferManager, uint64_t segmentSize);
         ~BPlusTreeIterator();
 
         BPlusTreeIterator(const BPlusTreeIterator& orig) = delete;
@@ -39,9 +39,10 @@ namespace simpledb {
         using leaf_type = LeafNode<typename B::key_type, typename B::value_type, typename B::comparator, B::LEAF_DEGREE>;
 
         std::shared_ptr<BufferManager> _bufferManager;
-        std::shared_ptr<BufferFrame> _bufferFrame;
+        PageGuard _bufferFrame;
         bool _dirty;
         int64_t _onPageIt;
+        ReadAhead _readAhead;
 
         leaf_type* leaf() const {
             return reinterpret_cast<leaf_type*> (_bufferFrame->getData());
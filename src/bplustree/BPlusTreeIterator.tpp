@@ -2,7 +2,8 @@
 namespace simpledb {
 
     template <typename B, bool EXCLUSIVE>
-    BPlusTreeIterator<B, EXCLUSIVE>::BPlusTreeIterator(int64_t onPageIt, std::shared_ptr<BufferFrame> bufferFrame, std::shared_ptr<BufferManager> bufferManager) : _bufferManager(bufferManager), _bufferFrame(bufferFrame), _dirty(false), _onPageIt(onPageIt) {
+    BPlusTreeIterator<B, EXCLUSIVE>::BPlusTreeIterator(int64_t onPageIt, PageGuard bufferFrame, std::shared_ptr<BufferManager> bufferManager, uint64_t segmentSize) : _bufferManager(bufferManager), _bufferFrame(std::move(bufferFrame)), _dirty(false), _onPageIt(onPageIt), _readAhead(bufferManager.get(), segmentSize) {
+        _readAhead.access(_bufferFrame->pageId());
         if (_onPageIt >= leaf()->size()) { // end of page
             operator++();
         }
@@ -10,7 +11,7 @@ namespace simpledb {
 
     template <typename B, bool EXCLUSIVE>
     BPlusTreeIterator<B, EXCLUSIVE>::~BPlusTreeIterator() {
-        if (isValid()) {
+        if (_bufferFrame.isValid()) { // not moved and not at the end
             _bufferManager->unfixPage(_bufferFrame, _dirty);
         }
     }
@@ -73,20 +74,19 @@ namespace simpledb {
                     assert(EXCLUSIVE);
                 }
                 _bufferManager->unfixPage(_bufferFrame, _dirty);
-                _bufferFrame.reset();
 
                 break;
             }
 
             // fix next frame
-            std::shared_ptr<BufferFrame> nextFrame = _bufferManager->fixPage(nextPage.segment, nextPage.page, EXCLUSIVE);
+            _readAhead.access(nextPage);
+            PageGuard nextFrame = _bufferManager->fixPage(nextPage.segment, nextPage.page, EXCLUSIVE);
 
             // unfix old frame
             if (_dirty) {
                 assert(EXCLUSIVE);
             }
             _bufferManager->unfixPage(_bufferFrame, _dirty);
-            _bufferFrame.reset();
 
             // set new page and reset dirty flag
             _bufferFrame = std::move(nextFrame);
@@ -34,14 +34,36 @@ namespace simpledb {
         PageId lookup(K key);
         PageId leftmost();
 
+        /**
+         * Child references can be swizzled by the buffer manager, lookup and leftmost return them unswizzled.
+         * @param key the key
+         * @return the slot of the child to follow for the key
+         */
+        uint64_t lookupSlot(K key);
+
+        /**
+         * @param slot the slot of a child
+         * @return the possibly swizzled reference to the child
+         */
+        PageId child(uint64_t slot);
+
+        /**
+         * Replaces the reference to a child with a (un)swizzled reference to the same child.
+         * The node must be locked exclusively by the caller, but isn't dirty afterwards.
+         * @param slot the slot of the child
+         * @param reference the new reference
+         */
+        void swizzleChild(uint64_t slot, PageId reference);
+
         uint64_t size();
         bool hasFreeSpace();
+        bool hasValidSize();
 
         void splitRoot(PageId pageId[2], InnerNode<K, V, C, DEGREE> *node[2]);
         void split(PageId newPageId, InnerNode<K, V, C, DEGREE> *newNode, InnerNode<K, V, C, DEGREE> *parentNode);
 
         template<uint64_t LEAF_DEGREE>
-        void visualize(PageId thisPageId, std::shared_ptr<BufferFrame> bufferFrame, std::ostream& out, BufferManager& bufferManager, LeafNode<K, V, C, LEAF_DEGREE> *unused);
+        void visualize(PageId thisPageId, PageGuard bufferFrame, std::ostream& out, BufferManager& bufferManager, LeafNode<K, V, C, LEAF_DEGREE> *unused);
 
     private:
         using KeyArray = std::array<K, 2 * DEGREE>;
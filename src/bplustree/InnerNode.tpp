@@ -31,13 +31,32 @@ namespace simpledb {
 
     template <typename K, typename V, typename C, uint64_t DEGREE>
     PageId InnerNode<K, V, C, DEGREE>::lookup(K key) {
-        typename KeyArray::iterator it = std::lower_bound(keys().begin(), keysEnd(), key, C());
-        return children()[it - keys().begin()];
+        return BufferManager::unswizzle(child(lookupSlot(key)));
     }
 
     template <typename K, typename V, typename C, uint64_t DEGREE>
     PageId InnerNode<K, V, C, DEGREE>::leftmost() {
-        return children()[0];
+        return BufferManager::unswizzle(child(0));
+    }
+
+    template <typename K, typename V, typename C, uint64_t DEGREE>
+    uint64_t InnerNode<K, V, C, DEGREE>::lookupSlot(K key) {
+        // optimistic readers may see the count change after checking it, so it's read once and bounded
+        uint64_t count = std::min<uint64_t>(size(), keys().size() - 1);
+        typename KeyArray::iterator it = std::lower_bound(keys().begin(), keys().begin() + count, key, C());
+        return (it - keys().begin());
+    }
+
+    template <typename K, typename V, typename C, uint64_t DEGREE>
+    PageId InnerNode<K, V, C, DEGREE>::child(uint64_t slot) {
+        return children()[slot];
+    }
+
+    template <typename K, typename V, typename C, uint64_t DEGREE>
+    void InnerNode<K, V, C, DEGREE>::swizzleChild(uint64_t slot, PageId reference) {
+        assert(slot <= size());
+        assert(BufferManager::unswizzle(reference) == BufferManager::unswizzle(children()[slot]));
+        children()[slot] = reference;
     }
 
     template <typename K, typename V, typename C, uint64_t DEGREE>
@@ -50,6 +69,12 @@ namespace simpledb {
         return (size() + 1 < keys().size());
     }
 
+    template <typename K, typename V, typename C, uint64_t DEGREE>
+    bool InnerNode<K, V, C, DEGREE>::hasValidSize() {
+        // used by optimistic readers to check the bounds of a possibly inconsistent node
+        return (size() < keys().size());
+    }
+
     template <typename K, typename V, typename C, uint64_t DEGREE>
     void InnerNode<K, V, C, DEGREE>::splitRoot(PageId pageId[2], InnerNode<K, V, C, DEGREE> *node[2]) {
         uint64_t k = size() / 2;
@@ -100,7 +125,7 @@ namespace simpledb {
 
     template <typename K, typename V, typename C, uint64_t DEGREE>
     template<uint64_t LEAF_DEGREE>
-    void InnerNode<K, V, C, DEGREE>::visualize(PageId thisPageId, std::shared_ptr<BufferFrame> bufferFrame, std::ostream& out, BufferManager& bufferManager, LeafNode<K, V, C, LEAF_DEGREE> *unused) {
+    void InnerNode<K, V, C, DEGREE>::visualize(PageId thisPageId, PageGuard bufferFrame, std::ostream& out, BufferManager& bufferManager, LeafNode<K, V, C, LEAF_DEGREE> *unused) {
         out << "node" << thisPageId.page << " [shape=record, label=\n ";
         out << "\"<count> " << _count << " | <isLeaf> " << std::boolalpha << this->isLeaf();
         for (uint64_t i = 0; i < _count; ++i) {
@@ -118,20 +143,20 @@ namespace simpledb {
         out << "\"];\n";
 
         for (uint64_t i = 0; i < _count + 1; ++i) {
-            out << "node" << thisPageId.page << ":ptr" << i << " -> node" << children()[i].page << ":count;\n";
+            out << "node" << thisPageId.page << ":ptr" << i << " -> node" << child(i).page << ":count;\n";
         }
         out << "\n";
 
         bufferManager.unfixPage(bufferFrame, false);
 
         for (uint64_t i = 0; i < _count + 1; ++i) {
-            PageId childId = children()[i];
-            std::shared_ptr<BufferFrame> childFrame = bufferManager.fixPage(childId.segment, childId.page, false);
+            PageId childId = BufferManager::unswizzle(child(i));
+            PageGuard childFrame = bufferManager.fixPage(childId.segment, childId.page, false);
             Node<K, V, C> *childNode = reinterpret_cast<Node<K, V, C>*> (childFrame->getData());
 
             if (!childNode->isLeaf()) {
                 InnerNode<K, V, C, DEGREE> *innerNode = reinterpret_cast<InnerNode<K, V, C, DEGREE>*> (childNode);
-                innerNode->visualize(childId, childFrame, out, bufferManager, unused);
+                innerNode->visualize(childId, std::move(childFrame), out, bufferManager, unused);
             } else {
                 LeafNode<K, V, C, LEAF_DEGREE> *leafNode = reinterpret_cast<LeafNode<K, V, C, LEAF_DEGREE>*> (childNode);
                 leafNode->visualize(childId, std::move(childFrame), out, bufferManager);
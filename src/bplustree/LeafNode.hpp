@@ -42,7 +42,7 @@ namespace simpledb {
         template<uint64_t INNER_DEGREE>
         void split(PageId newPageId, LeafNode<K, V, C, DEGREE> *newNode, InnerNode<K, V, C, INNER_DEGREE> *parentNode);
 
-        void visualize(PageId thisPageId, std::shared_ptr<BufferFrame> bufferFrame, std::ostream& out, BufferManager& bufferManager);
+        void visualize(PageId thisPageId, PageGuard bufferFrame, std::ostream& out, BufferManager& bufferManager);
 
     private:
         using KeyArray = std::array<K, 2 * DEGREE>;
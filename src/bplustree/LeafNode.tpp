@@ -112,7 +112,7 @@ namespace simpledb {
     }
 
     template <typename K, typename V, typename C, uint64_t DEGREE>
-    void LeafNode<K, V, C, DEGREE>::visualize(PageId thisPageId, std::shared_ptr<BufferFrame> bufferFrame, std::ostream& out, BufferManager& bufferManager) {
+    void LeafNode<K, V, C, DEGREE>::visualize(PageId thisPageId, PageGuard bufferFrame, std::ostream& out, BufferManager& bufferManager) {
         out << "node" << thisPageId.page << " [shape=record, label=\n ";
         out << "\"<count> " << _count << " | <isLeaf> " << std::boolalpha << this->isLeaf();
         for (uint64_t i = 0; i < _count; ++i) {
@@ -4,5 +4,12 @@
 
 #include "buffer/BufferFrame.hpp"
 #include "buffer/BufferManager.hpp"
+#include "buffer/BufferManagerOptions.hpp"
+#include "buffer/BufferRing.hpp"
+#include "buffer/PageBatch.hpp"
+#include "buffer/PageCodec.hpp"
+#include "buffer/PageGuard.hpp"
+#include "buffer/ReadAhead.hpp"
+#include "buffer/Statistics.hpp"
 
 #endif	/* SIMPLEDB_BUFFER_HPP */
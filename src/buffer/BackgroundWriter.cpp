@@ -0,0 +1,79 @@
+
+#include "BackgroundWriter.hpp"
+
+namespace simpledb {
+
+    constexpr uint64_t BackgroundWriter::WRITER_INTERVAL;
+
+    BackgroundWriter::BackgroundWriter(BufferFrame* frames, uint64_t pageSize, FileManager& fileManager, BufferReplacementManager& replacementManager, uint64_t threads, uint64_t cleanFrames, Statistics& statistics) : _frames(frames), _pageSize(pageSize), _fileManager(fileManager), _replacementManager(replacementManager), _threadCount(threads), _cleanFrames(cleanFrames), _statistics(statistics), _mutex(), _condition(), _stop(false), _threads() {
+        assert(threads > 0);
+
+        for (uint64_t i = 0; i < _threadCount; ++i) {
+            _threads.add_thread(new boost::thread(&BackgroundWriter::run, this, i));
+        }
+    }
+
+    BackgroundWriter::~BackgroundWriter() {
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _stop = true;
+            _condition.notify_all();
+        }
+        _threads.join_all();
+    }
+
+    void BackgroundWriter::wakeUp() {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _condition.notify_all();
+    }
+
+    void BackgroundWriter::run(uint64_t thread) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (!_stop) {
+            lock.unlock();
+            uint64_t written = writeBatch(thread);
+            lock.lock();
+
+            // nothing to write? -> sleep until a page miss wakes us up or the interval elapsed
+            if (written == 0 && !_stop) {
+                _condition.timed_wait(lock, boost::posix_time::milliseconds(WRITER_INTERVAL));
+            }
+        }
+    }
+
+    uint64_t BackgroundWriter::writeBatch(uint64_t thread) {
+        std::vector<BufferFrame*> victims;
+        _replacementManager.nextVictims(victims, _cleanFrames);
+
+        // lock dirty victims of this thread shared, so they can't be modified while writing
+        std::vector<BufferFrame*> batch;
+        for (BufferFrame *frame : victims) {
+            if ((frame - _frames) % _threadCount != thread || !frame->isDirty()) {
+                continue;
+            }
+            if (!frame->tryLock(false)) {
+                continue; // locked exclusively, it's in use anyway
+            }
+            if (!frame->isDirty()) { // cleaned by an eviction in the meantime
+                frame->unlock(false);
+                continue;
+            }
+            batch.push_back(frame);
+        }
+
+        // write in page order, runs of consecutive pages with one write each
+        IOBatch writes;
+        for (BufferFrame *frame : batch) {
+            writes.write(frame->pageId(), _pageSize, frame->getData());
+        }
+        _fileManager.writeCoalesced(writes);
+
+        for (BufferFrame *frame : batch) {
+            frame->setClean(); // nobody can dirty the frame, while we hold the shared lock
+            frame->unlock(false);
+        }
+        _statistics.add(Counter::backgroundWrites, batch.size());
+
+        return batch.size();
+    }
+}
@@ -0,0 +1,86 @@
+
+#ifndef SIMPLEDB_BUFFER_BACKGROUNDWRITER_HPP
+#define	SIMPLEDB_BUFFER_BACKGROUNDWRITER_HPP
+
+#include "file.hpp"
+#include "BufferFrame.hpp"
+#include "BufferReplacementManager.hpp"
+#include "Statistics.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace simpledb {
+
+    /**
+     * Pool of threads that write dirty frames to disk before the replacement strategy evicts them,
+     * so a page miss only has to read the new page.
+     * The threads look at the next victims of the replacement manager and write the dirty ones in batches sorted by page id.
+     */
+    class BackgroundWriter {
+    public:
+
+        /**
+         * Starts the writer threads.
+         * @param frames the frames of the buffer manager
+         * @param pageSize the size of a frame in bytes
+         * @param fileManager the file manager to write with
+         * @param replacementManager the replacement manager to ask for the next victims
+         * @param threads number of writer threads
+         * @param cleanFrames number of next victims to keep clean
+         * @param statistics the statistics to count the written pages in
+         */
+        BackgroundWriter(BufferFrame* frames, uint64_t pageSize, FileManager& fileManager, BufferReplacementManager& replacementManager, uint64_t threads, uint64_t cleanFrames, Statistics& statistics);
+
+        /**
+         * Stops the writer threads and waits for them to finish their current batch.
+         */
+        ~BackgroundWriter();
+
+        BackgroundWriter(const BackgroundWriter& orig) = delete;
+        BackgroundWriter& operator=(const BackgroundWriter& orig) = delete;
+
+        /**
+         * Wakes up the writer threads, e.g. because a page miss had to write a dirty victim itself.
+         * This method is thread-safe.
+         */
+        void wakeUp();
+
+    private:
+        static constexpr uint64_t WRITER_INTERVAL = 10; // time in ms the writer threads sleep, if there is nothing to write
+
+        BufferFrame* _frames; // the frames of the buffer manager
+        uint64_t _pageSize; // the size of a frame in bytes
+        FileManager& _fileManager; // writes the pages to disk
+        BufferReplacementManager& _replacementManager; // knows the next victims
+        uint64_t _threadCount; // number of writer threads
+        uint64_t _cleanFrames; // number of next victims to keep clean
+        Statistics& _statistics; // counts the written pages
+
+        boost::mutex _mutex; // mutex for sleeping and stopping
+        boost::condition_variable _condition; // wakes up the writer threads
+        bool _stop; // true, if the writer threads should terminate
+        boost::thread_group _threads; // the writer threads
+
+        /**
+         * Main loop of a writer thread.
+         * @param thread number of the thread
+         */
+        void run(uint64_t thread);
+
+        /**
+         * Writes the dirty frames among the next victims, that belong to a writer thread.
+         * Frames are locked shared while writing, frames locked exclusively are skipped.
+         * @param thread number of the thread, it handles the frames with index % number of threads == thread
+         * @return the number of pages written
+         */
+        uint64_t writeBatch(uint64_t thread);
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_BACKGROUNDWRITER_HPP */
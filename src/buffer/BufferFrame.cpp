@@ -5,18 +5,38 @@ namespace simpledb {
 
     void BufferFrame::lock(bool exclusive) {
         if (exclusive) {
-            if (_uniqueLock.get() == nullptr) {
-                _uniqueLock.reset(new boost::unique_lock<boost::shared_mutex>(_mutex));
-            }
+            _mutex.lock();
+
+            // invalidate optimistic readers before the data is modified
+            _version.store(_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
         } else {
-            if (_sharedLock.get() == nullptr) {
-                _sharedLock.reset(new boost::shared_lock<boost::shared_mutex>(_mutex));
+            _mutex.lock_shared();
+        }
+    }
+
+    bool BufferFrame::tryLock(bool exclusive) {
+        if (exclusive) {
+            if (!_mutex.try_lock()) {
+                return false;
             }
+
+            // invalidate optimistic readers before the data is modified
+            _version.store(_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            return true;
+        } else {
+            return _mutex.try_lock_shared();
         }
     }
 
-    void BufferFrame::unlock() {
-        _uniqueLock.reset();
-        _sharedLock.reset();
+    void BufferFrame::unlock(bool exclusive) {
+        if (exclusive) {
+            // publish the modifications to optimistic readers
+            _version.store(_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            _mutex.unlock();
+        } else {
+            _mutex.unlock_shared();
+        }
     }
 }
@@ -2,26 +2,25 @@
 #ifndef SIMPLEDB_BUFFER_BUFFERFRAME_HPP
 #define	SIMPLEDB_BUFFER_BUFFERFRAME_HPP
 
-#include "BufferFrameNode.hpp"
 #include "PageId.hpp"
 
 #include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
-#include <boost/thread/lock_types.hpp>
-#include <boost/thread/tss.hpp>
 
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <list>
 
 namespace simpledb {
 
     /**
      * Buffer frame holds meta information for a frame in memory and handles its locks.
-     * @param pageId page and segment indentifying the frame on disk
+     * Frames are allocated once by the buffer manager and reused for different pages.
      */
     class BufferFrame {
     public:
 
-        BufferFrame(PageId pageId) : _pageId(pageId), _state(FrameState::clean), _queueState(QueueState::none), _data(nullptr), _queueNode(), _mutex(), _uniqueLock(), _sharedLock() {
+        BufferFrame() : _pageId(), _state(FrameState::free), _queueState(QueueState::none), _data(nullptr), _queueNode(), _referenced(false), _version(0), _fixCount(0), _mutex() {
         };
 
         ~BufferFrame() {
@@ -34,12 +33,23 @@ namespace simpledb {
             return _pageId;
         };
 
+        /**
+         * Assigns a page to a free frame. The frame is clean afterwards.
+         * The frame must be locked exclusively by the caller.
+         * @param pageId the page id
+         */
+        void setPageId(PageId pageId) {
+            assert(isFree());
+            _pageId = pageId;
+            _state = FrameState::clean;
+        }
+
         bool isClean() const {
             return (_state == FrameState::clean);
         }
 
         void setClean() {
-            assert(!isDeleted());
+            assert(!isFree());
             _state = FrameState::clean;
         }
 
@@ -48,17 +58,17 @@ namespace simpledb {
         }
 
         void setDirty() {
-            assert(!isDeleted());
+            assert(!isFree());
             _state = FrameState::dirty;
         }
 
-        bool isDeleted() const {
-            return (_state == FrameState::deleted);
+        bool isFree() const {
+            return (_state == FrameState::free);
         }
 
-        void setDeleted() {
+        void setFree() {
             assert(isClean());
-            _state = FrameState::deleted;
+            _state = FrameState::free;
         }
 
         bool isInFifoQueue() const {
@@ -95,14 +105,32 @@ namespace simpledb {
             _data = data;
         }
 
-        std::list<BufferFrameNode>::iterator& queueNode() {
+        std::list<BufferFrame*>::iterator& queueNode() {
             return _queueNode;
         }
 
-        void setQueueNode(std::list<BufferFrameNode>::iterator queueNode) {
+        void setQueueNode(std::list<BufferFrame*>::iterator queueNode) {
             _queueNode = queueNode;
         }
 
+        /**
+         * @return the reference bit used by the clock replacement strategy
+         */
+        bool isReferenced() const {
+            return _referenced.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Sets the reference bit used by the clock replacement strategy.
+         * The bit is only written, if it changes, so hits on hot frames don't invalidate the cache line.
+         * @param referenced the new value of the reference bit
+         */
+        void setReferenced(bool referenced) {
+            if (_referenced.load(std::memory_order_relaxed) != referenced) {
+                _referenced.store(referenced, std::memory_order_relaxed);
+            }
+        }
+
         /**
          * Blocks until a lock can be obtained.
          * @param exclusive true, for exclusive (write) lock; false, for shared (read) lock
@@ -110,19 +138,78 @@ namespace simpledb {
         void lock(bool exclusive);
 
         /**
-         * Returns all previously obtained locks.
+         * Tries to obtain a lock without blocking.
+         * @param exclusive true, for exclusive (write) lock; false, for shared (read) lock
+         * @return true, if the lock was obtained; false, otherwise
+         */
+        bool tryLock(bool exclusive);
+
+        /**
+         * Returns a previously obtained lock.
+         * @param exclusive true, if the lock is an exclusive (write) lock; false, for a shared (read) lock
          */
-        void unlock();
+        void unlock(bool exclusive);
+
+        /**
+         * Pins the frame, so it isn't evicted until it's unfixed again.
+         */
+        void fix() {
+            _fixCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Unpins the frame.
+         * @return true, if the frame isn't fixed by any thread anymore; false, otherwise
+         */
+        bool unfix() {
+            assert(isFixed());
+            return (_fixCount.fetch_sub(1, std::memory_order_release) == 1);
+        }
+
+        /**
+         * @return true, if the frame is pinned by at least one thread; false, otherwise
+         */
+        bool isFixed() const {
+            return (_fixCount.load(std::memory_order_acquire) > 0);
+        }
+
+        /**
+         * Reads the version of the frame for an optimistic (latch-free) read.
+         * The version is incremented whenever an exclusive lock is obtained or returned,
+         * i.e. it is odd while the frame is locked exclusively.
+         * @return the current version
+         */
+        uint64_t version() const {
+            return _version.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Checks if the frame was not locked exclusively since the supplied version was read.
+         * All data read optimistically must be discarded, if the validation fails.
+         * @param version the version obtained by version() before reading
+         * @return true, if the data read since then is consistent; false, otherwise
+         */
+        bool validate(uint64_t version) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return (_version.load(std::memory_order_relaxed) == version);
+        }
+
+        /**
+         * @param version a version obtained by version()
+         * @return true, if the frame was locked exclusively when the version was read
+         */
+        static bool isLockedVersion(uint64_t version) {
+            return ((version & 1) == 1);
+        }
 
     private:
 
         /**
          * Indicates whether the frame is in a consistent state with the disk (clean)
-         * or must be written back to disk before flushing (dirty) or is already
-         * evicted (deleted).
+         * or must be written back to disk before flushing (dirty) or holds no page (free).
          */
         enum class FrameState {
-            clean, dirty, deleted
+            clean, dirty, free
         };
 
         /**
@@ -137,13 +224,14 @@ namespace simpledb {
 
         PageId _pageId; // page id identifying the segment and page on disk
         // uint64_t _LSN;
-        FrameState _state;
+        std::atomic<FrameState> _state; // atomic, as the background writer checks it without holding the lock
         QueueState _queueState; // indicates in which queue the replacement manager holds the frame node
         void *_data; // pointer to allocated memory
-        std::list<BufferFrameNode>::iterator _queueNode; // reference to frame node in the queues of the replacement manager
+        std::list<BufferFrame*>::iterator _queueNode; // reference to frame node in the queues of the replacement manager
+        std::atomic<bool> _referenced; // reference bit for clock replacement
+        std::atomic<uint64_t> _version; // version for optimistic reads, odd while locked exclusively
+        std::atomic<uint64_t> _fixCount; // number of threads that have fixed the frame
         boost::shared_mutex _mutex; // shared mutex for concurrent access
-        boost::thread_specific_ptr<boost::unique_lock<boost::shared_mutex>> _uniqueLock; // exclusive (write) lock
-        boost::thread_specific_ptr<boost::shared_lock<boost::shared_mutex>> _sharedLock; // shared (read) lock
     };
 }
 
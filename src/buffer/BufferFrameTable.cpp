@@ -1,13 +1,32 @@
 
 #include "BufferFrameTable.hpp"
 
+#include <algorithm>
+#include <cassert>
+
 namespace simpledb {
 
-    BufferFrameTableBucket& BufferFrameTable::findBucket(PageId pageId) {
-        return _table[hash(pageId) & (_table.size() - 1)];
-    }
+    constexpr uint64_t BufferFrameTable::TABLE_OVERHEAD_FACTOR;
+    constexpr uint64_t BufferFrameTable::MIN_SHARD_SIZE;
+    constexpr uint64_t BufferFrameTable::MAX_SHARDS;
+
+    BufferFrameTable::BufferFrameTable(BufferFrame* frames, uint64_t size) : _shards(), _shardBits(0) {
+        assert(size > 0 && size < (1ull << 32)); // entries hold 32 bit frame indexes
+
+        uint64_t shards = 1;
+        while (shards * 2 <= std::min(MAX_SHARDS, size / MIN_SHARD_SIZE)) {
+            shards *= 2;
+            ++_shardBits;
+        }
+
+        // the shards are sized for an even distribution, a shard that gets more frames grows
+        uint64_t capacity = 1;
+        while (capacity < TABLE_OVERHEAD_FACTOR * size / shards) {
+            capacity *= 2;
+        }
 
-    size_t BufferFrameTable::hash(PageId pageId) {
-        return Hash()(reinterpret_cast<void *> (&pageId), sizeof (PageId));
+        for (uint64_t i = 0; i < shards; ++i) {
+            _shards.emplace_back(new BufferFrameTableShard(frames, capacity));
+        }
     }
-}
\ No newline at end of file
+}
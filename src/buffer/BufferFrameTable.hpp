@@ -3,14 +3,9 @@
 #define	SIMPLEDB_BUFFER_BUFFERFRAMETABLE_HPP
 
 #include "BufferFrame.hpp"
-#include "BufferFrameTableBucket.hpp"
+#include "BufferFrameTableShard.hpp"
 
-#include "hash.hpp"
-
-#include <cmath>
-#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <memory>
 #include <vector>
 
@@ -18,17 +13,16 @@ namespace simpledb {
 
     /**
      * Hash table for alle buffer frames in memory identified by the page id.
+     * The table is split into shards, so inserts and deletes of different pages rarely contend on the same lock.
      */
     class BufferFrameTable {
     public:
 
         /**
+         * @param frames the frames of the buffer manager
          * @param size number of frames to manage
          */
-        BufferFrameTable(uint64_t size) : _table(exp2(static_cast<uint64_t> (log2(TABLE_OVERHEAD_FACTOR * size - 1) + 1))) {
-            assert((_table.size() & (_table.size() - 1)) == 0); // size is power of 2
-
-        }
+        BufferFrameTable(BufferFrame* frames, uint64_t size);
 
         ~BufferFrameTable() {
         }
@@ -37,31 +31,33 @@ namespace simpledb {
         BufferFrameTable& operator=(const BufferFrameTable& orig) = delete;
 
         /**
-         * Finds the correct bucket for a pageId.
-         * @param pageId
-         * @return reference to the correct bucket
+         * Calculates a hash value for a page id.
+         * Page ids are dense small numbers, multiplying each by an odd constant spreads them over the upper bits,
+         * which select the shard (the highest bits) and the slot in the shard (the upper half), so consecutive pages land in different shards.
+         * @param pageId the page id
+         * @return the hash value for the page id
          */
-        BufferFrameTableBucket& findBucket(PageId pageId);
-
-        std::vector<BufferFrameTableBucket>::iterator begin() {
-            return _table.begin();
+        static uint64_t hash(PageId pageId) {
+            return (pageId.page * 0x9e3779b97f4a7c15ull) ^ (pageId.segment * 0xc2b2ae3d27d4eb4full);
         }
 
-        std::vector<BufferFrameTableBucket>::iterator end() {
-            return _table.end();
+        /**
+         * Finds the correct shard for a pageId.
+         * @param hash the hash of the page id
+         * @return reference to the correct shard
+         */
+        BufferFrameTableShard& findShard(uint64_t hash) {
+            // the low bits of the hash are the same for pages a multiple of a power of 2 apart, so they don't select the shard
+            return *_shards[_shardBits == 0 ? 0 : hash >> (64 - _shardBits)];
         }
 
     private:
-        static constexpr int TABLE_OVERHEAD_FACTOR = 3; // scaling factor for table size
-
-        std::vector<BufferFrameTableBucket> _table; // vector of buckets
+        static constexpr uint64_t TABLE_OVERHEAD_FACTOR = 2; // scaling factor for table size, keeps the probe sequences short
+        static constexpr uint64_t MIN_SHARD_SIZE = 64; // minimal number of frames per shard, so the frames distribute evenly
+        static constexpr uint64_t MAX_SHARDS = 64; // maximal number of shards
 
-        /**
-         * Calculates a hash value for a page id.
-         * @param pageId
-         * @return the hash value for the page id
-         */
-        size_t hash(PageId pageId);
+        std::vector<std::unique_ptr<BufferFrameTableShard>> _shards; // the shards, a power of 2
+        uint64_t _shardBits; // log2 of the number of shards
     };
 }
 #endif	/* SIMPLEDB_BUFFER_BUFFERFRAMETABLE_HPP */
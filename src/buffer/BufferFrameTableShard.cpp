@@ -0,0 +1,135 @@
+
+#include "BufferFrameTableShard.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace simpledb {
+
+    constexpr uint64_t BufferFrameTableShard::EMPTY;
+    constexpr uint64_t BufferFrameTableShard::CACHE_LINE_SIZE;
+    constexpr uint64_t BufferFrameTableShard::MAX_LOAD_PERCENT;
+
+    BufferFrameTableShard::BufferFrameTableShard(BufferFrame* frames, uint64_t capacity) : _mutex(), _frames(frames), _table(nullptr), _tables(), _count(0) {
+        _tables.push_back(allocateTable(capacity));
+        _table.store(_tables.back(), std::memory_order_release);
+    }
+
+    BufferFrameTableShard::~BufferFrameTableShard() {
+        for (Table *table : _tables) {
+            free(table->slots);
+            delete table;
+        }
+    }
+
+    std::unique_ptr<boost::unique_lock<boost::mutex>> BufferFrameTableShard::lock() {
+        return std::unique_ptr<boost::unique_lock < boost::mutex >> (new boost::unique_lock<boost::mutex>(_mutex));
+    };
+
+    BufferFrame* BufferFrameTableShard::lookupFrame(PageId pageId, uint64_t hash) const {
+        const Table *table = _table.load(std::memory_order_acquire);
+        for (uint64_t i = homeSlot(table, hash), probes = 0; probes <= table->mask; i = (i + 1) & table->mask, ++probes) {
+            uint64_t entry = table->slots[i].load(std::memory_order_acquire);
+            if (entry == EMPTY) {
+                return nullptr;
+            }
+            // compare the tag first, so only matching entries touch the frame
+            if (matchesTag(entry, hash) && entryFrame(entry)->pageId() == pageId) {
+                return entryFrame(entry);
+            }
+        }
+        return nullptr;
+    }
+
+    void BufferFrameTableShard::insertFrame(BufferFrame* frame, uint64_t hash) {
+        // the pages might not distribute evenly over the shards, then the shard grows instead of filling up
+        if ((_count + 1) * 100 > (_table.load(std::memory_order_relaxed)->mask + 1) * MAX_LOAD_PERCENT) {
+            grow();
+        }
+
+        Table *table = _table.load(std::memory_order_relaxed);
+        for (uint64_t i = homeSlot(table, hash); ; i = (i + 1) & table->mask) {
+            if (table->slots[i].load(std::memory_order_relaxed) == EMPTY) {
+                table->slots[i].store(entry(frame, hash), std::memory_order_release);
+                ++_count;
+                return;
+            }
+        }
+    }
+
+    void BufferFrameTableShard::deleteFrame(PageId pageId, uint64_t hash) {
+        Table *table = _table.load(std::memory_order_relaxed);
+        uint64_t hole = findSlot(table, pageId, hash);
+        if (hole > table->mask) {
+            return;
+        }
+        --_count;
+
+        // shift the following entries of the probe sequence back, so no tombstones are needed
+        // an entry is copied before its old slot is cleared, so a lock-free lookup only misses it, if it passed the new slot already
+        for (uint64_t i = (hole + 1) & table->mask; ; i = (i + 1) & table->mask) {
+            uint64_t entry = table->slots[i].load(std::memory_order_relaxed);
+            if (entry == EMPTY) {
+                break;
+            }
+
+            // the entry can fill the hole, if the hole is between its home slot and its current slot
+            if (((i - homeSlot(table, entry)) & table->mask) >= ((i - hole) & table->mask)) {
+                table->slots[hole].store(entry, std::memory_order_release);
+                hole = i;
+            }
+        }
+        table->slots[hole].store(EMPTY, std::memory_order_release);
+    }
+
+    BufferFrameTableShard::Table* BufferFrameTableShard::allocateTable(uint64_t capacity) {
+        assert(capacity > 0 && capacity <= (1ull << 32) && (capacity & (capacity - 1)) == 0); // capacity is power of 2
+
+        // a probe sequence starting at the beginning of a cache line needs a single cache miss for up to 8 entries
+        void *slots;
+        assert(posix_memalign(&slots, CACHE_LINE_SIZE, capacity * sizeof (std::atomic<uint64_t>)) == 0);
+        // TODO: error handling
+        Table *table = new Table();
+        table->mask = capacity - 1;
+        table->slots = reinterpret_cast<std::atomic<uint64_t>*> (slots);
+        for (uint64_t i = 0; i < capacity; ++i) {
+            new (&table->slots[i]) std::atomic<uint64_t>(EMPTY);
+        }
+        return table;
+    }
+
+    void BufferFrameTableShard::grow() {
+        Table *oldTable = _table.load(std::memory_order_relaxed);
+        Table *newTable = allocateTable(2 * (oldTable->mask + 1));
+
+        // the entries are rehashed into the new table before it's published, lookups in the old table still find them
+        for (uint64_t i = 0; i <= oldTable->mask; ++i) {
+            uint64_t entry = oldTable->slots[i].load(std::memory_order_relaxed);
+            if (entry == EMPTY) {
+                continue;
+            }
+            for (uint64_t j = homeSlot(newTable, entry); ; j = (j + 1) & newTable->mask) {
+                if (newTable->slots[j].load(std::memory_order_relaxed) == EMPTY) {
+                    newTable->slots[j].store(entry, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+
+        _tables.push_back(newTable);
+        _table.store(newTable, std::memory_order_release);
+    }
+
+    uint64_t BufferFrameTableShard::findSlot(const Table* table, PageId pageId, uint64_t hash) const {
+        for (uint64_t i = homeSlot(table, hash), probes = 0; probes <= table->mask; i = (i + 1) & table->mask, ++probes) {
+            uint64_t entry = table->slots[i].load(std::memory_order_relaxed);
+            if (entry == EMPTY) {
+                break;
+            }
+            if (matchesTag(entry, hash) && entryFrame(entry)->pageId() == pageId) {
+                return i;
+            }
+        }
+        return table->mask + 1;
+    }
+}
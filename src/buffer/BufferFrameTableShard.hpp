@@ -0,0 +1,151 @@
+
+#ifndef SIMPLEDB_BUFFER_BUFFERFRAMETABLESHARD_HPP
+#define	SIMPLEDB_BUFFER_BUFFERFRAMETABLESHARD_HPP
+
+#include "BufferFrame.hpp"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/lock_types.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace simpledb {
+
+    /**
+     * Shard of the hash table for buffer frames, an open addressing table with linear probing.
+     * An entry is a single word holding the frame index and the upper half of the hash as tag, so no entry is allocated on
+     * the heap and most mismatches are detected without touching the frame.
+     * Lookups are lock-free. Insert and delete need an external lock using lock().
+     * A lock-free lookup may miss a frame, while a concurrent delete moves it or the shard grows. Lookups under the lock are exact.
+     * A shard that gets more frames than expected grows, the old tables are kept until the shard is destructed for lookups still reading them.
+     * Buffer frames can be accessed without locking the shard, they have their own locking mechanism.
+     */
+    class BufferFrameTableShard {
+    public:
+
+        /**
+         * @param frames the frames of the buffer manager, entries refer to them by index
+         * @param capacity initial number of entries, a power of 2 up to 2^32
+         */
+        BufferFrameTableShard(BufferFrame* frames, uint64_t capacity);
+
+        ~BufferFrameTableShard();
+
+        BufferFrameTableShard(const BufferFrameTableShard& orig) = delete;
+        BufferFrameTableShard& operator=(const BufferFrameTableShard& orig) = delete;
+
+        /**
+         * Locks the shard.
+         * The lock is released when the lock is destructed.
+         * @return the lock
+         */
+        std::unique_ptr<boost::unique_lock<boost::mutex>> lock();
+
+        /**
+         * Looks for the frame with the specified pageId in the shard.
+         * Without the lock, the frame may be evicted concurrently, so the caller must check the page id of the frame after locking it.
+         * @param pageId the page id
+         * @param hash the hash of the page id
+         * @return pointer to the frame; or nullptr, if it can't be found
+         */
+        BufferFrame* lookupFrame(PageId pageId, uint64_t hash) const;
+
+        /**
+         * Inserts a frame in the shard.
+         * The shard must be locked externally by the caller using lock().
+         * @param frame the frame to insert
+         * @param hash the hash of the page id of the frame
+         */
+        void insertFrame(BufferFrame* frame, uint64_t hash);
+
+        /**
+         * Deletes a frame from the shard.
+         * The shard must be locked externally by the caller using lock().
+         * @param pageId the page id identifying the frame
+         * @param hash the hash of the page id
+         */
+        void deleteFrame(PageId pageId, uint64_t hash);
+
+    private:
+        static constexpr uint64_t EMPTY = 0; // entry of an empty slot
+        static constexpr uint64_t CACHE_LINE_SIZE = 64; // size of a cache line in bytes
+        static constexpr uint64_t MAX_LOAD_PERCENT = 75; // the shard grows, if more slots are used, keeps the probe sequences short
+
+        /**
+         * Open addressing table of the shard.
+         */
+        struct Table {
+            uint64_t mask; // capacity - 1, maps a hash to a slot
+            std::atomic<uint64_t>* slots; // the entries, aligned to a cache line
+        };
+
+        boost::mutex _mutex; // mutex for concurrent inserts and deletes
+        BufferFrame* _frames; // the frames of the buffer manager
+        std::atomic<Table*> _table; // the current table
+        std::vector<Table*> _tables; // all tables of the shard, old ones might still be read by lock-free lookups
+        uint64_t _count; // number of entries in the current table
+
+        /**
+         * Allocates a new empty table.
+         * @param capacity number of entries, a power of 2 up to 2^32
+         * @return the table
+         */
+        static Table* allocateTable(uint64_t capacity);
+
+        /**
+         * Replaces the table by one with twice the capacity. The shard must be locked.
+         */
+        void grow();
+
+        /**
+         * @param frame the frame
+         * @param hash the hash of the page id of the frame
+         * @return the entry of the frame, the upper half of the hash as tag and the frame index + 1
+         */
+        uint64_t entry(BufferFrame* frame, uint64_t hash) const {
+            return ((hash & 0xffffffff00000000ull) | static_cast<uint64_t> (frame - _frames + 1));
+        }
+
+        /**
+         * The upper half of the hash selects the slot, so the home slot of an entry is known from its tag.
+         * @param hash a hash or an entry
+         * @return the first slot of the probe sequence
+         */
+        static uint64_t homeSlot(const Table* table, uint64_t hash) {
+            return ((hash >> 32) & table->mask);
+        }
+
+        /**
+         * @param entry an entry, that isn't empty
+         * @return the frame of the entry
+         */
+        BufferFrame* entryFrame(uint64_t entry) const {
+            return &_frames[(entry & 0xffffffffull) - 1];
+        }
+
+        /**
+         * @param entry an entry
+         * @param hash a hash
+         * @return true, if the tag of the entry matches the hash; false, otherwise
+         */
+        static bool matchesTag(uint64_t entry, uint64_t hash) {
+            return ((entry ^ hash) >> 32) == 0;
+        }
+
+        /**
+         * Finds the slot of a frame. The shard must be locked.
+         * @param table the current table
+         * @param pageId the page id identifying the frame
+         * @param hash the hash of the page id
+         * @return the slot; or the capacity, if the frame isn't in the shard
+         */
+        uint64_t findSlot(const Table* table, PageId pageId, uint64_t hash) const;
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_BUFFERFRAMETABLESHARD_HPP */
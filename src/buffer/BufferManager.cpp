@@ -1,139 +1,694 @@
 
 #include "BufferManager.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
 namespace simpledb {
 
+    constexpr uint64_t BufferManager::MAX_CLEAN_NEIGHBORS;
+    constexpr uint64_t BufferManager::MAX_BATCH_SHARE;
+    constexpr uint64_t BufferManager::MAX_BATCHES_SHARE;
+    constexpr uint64_t BufferManager::EVICTION_WAIT_INTERVAL;
+    constexpr uint64_t BufferManager::MAX_RING_SHARE;
+    constexpr uint64_t BufferManager::MAX_SEGMENTS;
+    constexpr uint64_t BufferManager::SWIZZLED_BIT;
+    constexpr uint64_t BufferManager::SWIZZLED_FRAME_SHIFT;
+    constexpr uint64_t BufferManager::SWIZZLED_SEGMENT_MASK;
+
+    BufferManager::BufferManager(std::string path, uint64_t size, BufferManagerOptions options) : _size(countFrames(size, options)), _frames(new BufferFrame[_size]), _statistics(), _fileManager(path, options.ioBackend, options.directIO, &_statistics), _table(_frames.get(), _size), _pools(initPools(size, options)), _segmentPools(initSegmentPools()), _compressedCache(options.compressedCacheSize > 0 ? new CompressedCache(options.compressedCacheSize, _statistics) : nullptr), _unfixMutex(), _unfixCondition(), _waitingThreads(0), _statisticsReporter() {
+        if (options.statisticsInterval > 0) {
+            _statisticsReporter.reset(new StatisticsReporter([this]() {
+                return statistics();
+            }, options.statisticsInterval, options.statisticsFile));
+        }
+    }
+
     BufferManager::~BufferManager() {
-        // write dirty pages to disk
-        for (BufferFrameTableBucket &bucket : _table) {
-            std::unique_ptr<boost::unique_lock < boost::mutex>> bucketLock = bucket.lock();
+        // stop the reporter and background writers before the frames are destructed
+        _statisticsReporter.reset();
+        for (std::unique_ptr<BufferPool> &pool : _pools) {
+            pool->stopBackgroundWriter();
+        }
 
-            for (std::shared_ptr<BufferFrame> &frame : bucket) {
-                frame->lock(true);
-                cleanFrame(frame.get());
-                frame->unlock();
+        // write dirty pages to disk in one batch, runs of adjacent pages with one write each
+        IOBatch batch;
+        for (uint64_t i = 0; i < _size; ++i) {
+            BufferFrame *frame = &_frames[i];
+            assert(!frame->isFixed()); // all guards must be destructed before the buffer manager
+
+            if (frame->isDirty()) {
+                batch.write(frame->pageId(), pool(frame->pageId().segment).pageSize(), frame->getData());
+                frame->setClean();
             }
         }
-
-        free(_buffer);
+        _fileManager.writeCoalesced(batch);
+        _fileManager.sync();
     };
 
-    std::shared_ptr<BufferFrame> BufferManager::fixPage(uint64_t segmentId, uint64_t pageId, bool exclusive) {
+    PageGuard BufferManager::fixPage(uint64_t segmentId, uint64_t pageId, bool exclusive, AccessPattern pattern, BufferRing* ring) {
         PageId page(segmentId, pageId);
+        BufferPool& pagePool = pool(segmentId);
 
-        // find the bucket of the page
-        BufferFrameTableBucket& bucket = _table.findBucket(page);
-        std::shared_ptr<BufferFrame> frame;
-
-        bool deleted = false;
-        do {
-            // lock bucket
-            std::unique_ptr<boost::unique_lock < boost::mutex>> bucketLock = bucket.lock();
+        // find the shard of the page
+        uint64_t hash = BufferFrameTable::hash(page);
+        BufferFrameTableShard& shard = _table.findShard(hash);
+        BufferFrame *freeFrame = nullptr;
+        uint64_t missStart = 0;
+        _statistics.add(Counter::fixes);
 
-            // lookup frame
-            frame = bucket.lookupFrame(page);
+        while (true) {
+            // lookup frame without locking the shard
+            BufferFrame *frame = shard.lookupFrame(page, hash);
 
-            // is the frame loaded?
-            bool newlyCreated = false;
+            // not found? -> lookup again with the lock, a concurrent delete might have hidden the frame
             if (!frame) {
-                newlyCreated = true;
+                std::unique_ptr<boost::unique_lock < boost::mutex>> shardLock = shard.lock();
+                frame = shard.lookupFrame(page, hash);
+
+                // page not loaded and we have a free frame? -> load page
+                if (!frame && freeFrame) {
+                    // the free frame is locked exclusively until we loaded the page from disk
+                    freeFrame->setPageId(page);
+                    freeFrame->fix();
+                    shard.insertFrame(freeFrame, hash);
+                    shardLock->unlock();
+
+                    // load data from the compressed tier or from disk
+                    readPage(page, pagePool.pageSize(), freeFrame->getData());
+
+                    // the frame of a page of a scan joins the ring, the ring recycles it, unless another thread used or evicted it
+                    if (ring) {
+                        ring->_frames.push_back(std::make_pair(frameIndex(freeFrame), page));
+                        if (ring->_frames.size() > ringSize(pagePool, *ring)) {
+                            ring->_frames.pop_front();
+                        }
+                    }
+                    if (ring || pattern == AccessPattern::sequential) {
+                        pagePool.replacementManager().coldFrame(freeFrame);
+                    } else {
+                        pagePool.replacementManager().newFrame(freeFrame);
+                    }
+
+                    if (!exclusive) {
+                        freeFrame->unlock(true);
+                        freeFrame->lock(false);
+                    }
+
+                    _statistics.record(Histogram::missLatency, missStart);
+                    _statistics.add(Counter::misses);
+                    return PageGuard(this, frameIndex(freeFrame), exclusive);
+                }
+
+                shardLock->unlock(); // unlock shard, so we don't block
+
+                // page not loaded? -> evict a frame and lookup the page again
+                if (!frame) {
+                    missStart = Statistics::now();
+                    freeFrame = ring ? evictRingFrame(pagePool, *ring) : evictPage(pagePool);
+                    continue;
+                }
+            }
+
+            // fix frame, so it isn't evicted while we wait for the lock
+            frame->fix();
 
-                frame.reset(new BufferFrame(page));
-                frame->lock(true); // get exclusive lock until we loaded page from disk
-                bucket.insertFrame(frame);
+            // page was loaded concurrently, while we evicted a frame? -> return free frame
+            if (freeFrame) {
+                pagePool.replacementManager().freeFrame(freeFrame);
+                freeFrame->unlock(true);
+                notifyUnfixedFrame();
+                freeFrame = nullptr;
+            }
 
-                bucketLock->unlock(); // unlock bucket, so we don't block
+            // finally aquire frame lock, and check that the frame wasn't evicted before we fixed it
+            lockFrame(frame, exclusive);
+            if (frame->isFree() || !(frame->pageId() == page)) {
+                frame->unlock(exclusive);
+                if (frame->unfix()) {
+                    notifyUnfixedFrame();
+                }
+                continue;
+            }
+            if (pattern != AccessPattern::sequential) {
+                pagePool.replacementManager().reprioritizeFrame(frame);
+            }
 
-                void *data = evictPage();
-                frame->setData(data);
+            return PageGuard(this, frameIndex(frame), exclusive);
+        }
+    }
 
-                // load data to from disk
-                _fileManager.read(page, PAGE_SIZE, data);
+    void BufferManager::unfixPage(PageGuard& guard, bool isDirty) {
+        // is the frame loaded?
+        assert(guard.isValid());
+        // why do we call unlock, if the frame doesn't exist / we don't have the lock?!
+        // has the caller used unfixPage before fixPage?
 
-                _replacementManager.newFrame(frame.get());
+        BufferFrame *fixedFrame = frame(guard.frameIndex());
 
-                frame->unlock();
+        if (isDirty) {
+            assert(guard.isExclusive());
+            fixedFrame->setDirty();
+        }
+
+        fixedFrame->unlock(guard.isExclusive());
+        if (fixedFrame->unfix()) {
+            notifyUnfixedFrame();
+        }
+        guard.release();
+    }
+
+    void BufferManager::prefetch(uint64_t segmentId, uint64_t firstPage, uint64_t count, AccessPattern pattern) {
+        BufferPool& pagePool = pool(segmentId);
+        count = std::min(count, batchSize(pagePool));
+
+        // a prefetch is only a hint, skip it rather than take frames the batches of other threads need
+        if (!pagePool.reserveBatchFrames(count, batchBudget(pagePool))) {
+            _statistics.add(Counter::batchesDeclined);
+            return;
+        }
+
+        std::vector<PageId> pages;
+        pages.reserve(count);
+        for (uint64_t pageId = firstPage; pageId < firstPage + count; ++pageId) {
+            pages.push_back(PageId(segmentId, pageId));
+        }
+        loadPages(pages.data(), pages.size(), pattern);
+        pagePool.releaseBatchFrames(count);
+    }
+
+    PageBatch BufferManager::fixPages(const std::vector<PageId>& pages, bool exclusive) {
+        PageBatch batch;
+        if (pages.empty()) {
+            return batch;
+        }
+
+        // sort a copy, so consecutive pages are read in order and all batches fix the frames in the same order
+        std::vector<std::pair<PageId, uint64_t>> sorted; // page -> index in the input
+        sorted.reserve(pages.size());
+        for (uint64_t i = 0; i < pages.size(); ++i) {
+            sorted.push_back(std::make_pair(pages[i], i));
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<PageId, uint64_t>& a, const std::pair<PageId, uint64_t>& b) {
+            return (a.first.segment < b.first.segment || (a.first.segment == b.first.segment && a.first.page < b.first.page));
+        });
+
+        // each distinct page is fixed once, a page fixed twice would wait for itself
+        std::vector<PageId> distinctPages;
+        batch._guardIndexes.resize(pages.size());
+        for (const std::pair<PageId, uint64_t> &page : sorted) {
+            if (distinctPages.empty() || !(distinctPages.back() == page.first)) {
+                distinctPages.push_back(page.first);
+            }
+            batch._guardIndexes[page.second] = distinctPages.size() - 1;
+        }
+
+        // count the frames each pool needs, all batches together fix at most the budget of a pool
+        for (const PageId &page : distinctPages) {
+            BufferPool *pagePool = &pool(page.segment);
+            uint64_t i = 0;
+            while (i < batch._reservations.size() && batch._reservations[i].first != pagePool) {
+                ++i;
+            }
+            if (i == batch._reservations.size()) {
+                batch._reservations.push_back(std::make_pair(pagePool, 0));
+            }
+            ++batch._reservations[i].second;
+        }
+        for (uint64_t i = 0; i < batch._reservations.size(); ++i) {
+            BufferPool &pagePool = *batch._reservations[i].first;
+            assert(batch._reservations[i].second <= batchSize(pagePool)); // fixing more pages than the pool can hold at once?
+            // TODO: error handling
+
+            // other batches fix the budget of frames? -> the caller fixes the pages one at a time, so nobody waits for frames forever
+            if (!pagePool.reserveBatchFrames(batch._reservations[i].second, batchBudget(pagePool))) {
+                for (uint64_t j = 0; j < i; ++j) {
+                    batch._reservations[j].first->releaseBatchFrames(batch._reservations[j].second);
+                }
+                _statistics.add(Counter::batchesDeclined);
+                return PageBatch();
+            }
+        }
+
+        // load all missing pages at once, they are rarely evicted again before we fix them
+        _statistics.add(Counter::misses, loadPages(distinctPages.data(), distinctPages.size(), AccessPattern::random));
+
+        batch._guards.reserve(distinctPages.size());
+        for (const PageId &page : distinctPages) {
+            batch._guards.push_back(fixPage(page.segment, page.page, exclusive));
+        }
+        batch._bufferManager = this;
+        return batch;
+    }
+
+    void BufferManager::unfixPages(PageBatch& batch) {
+        assert(batch.isValid());
+
+        for (PageGuard &guard : batch._guards) {
+            if (guard.isValid()) {
+                unfixPage(guard, false);
+            }
+        }
+        for (const std::pair<BufferPool*, uint64_t> &reservation : batch._reservations) {
+            reservation.first->releaseBatchFrames(reservation.second);
+        }
+        batch.release();
+    }
+
+    uint64_t BufferManager::loadPages(const PageId* pages, uint64_t count, AccessPattern pattern) {
+        // assign a free frame to each page that isn't loaded, the frames stay locked exclusively until the page is read
+        IOBatch batch;
+        std::vector<BufferFrame*> frames;
+        for (uint64_t i = 0; i < count; ++i) {
+            PageId page = pages[i];
+            BufferPool& pagePool = pool(page.segment);
+            uint64_t hash = BufferFrameTable::hash(page);
+            BufferFrameTableShard& shard = _table.findShard(hash);
+
+            if (shard.lookupFrame(page, hash)) {
+                continue; // already loaded
+            }
+
+            BufferFrame *freeFrame = evictPage(pagePool);
+
+            // page loaded concurrently, while we evicted a frame? -> return free frame
+            std::unique_ptr<boost::unique_lock < boost::mutex>> shardLock = shard.lock();
+            if (shard.lookupFrame(page, hash)) {
+                shardLock->unlock();
+                pagePool.replacementManager().freeFrame(freeFrame);
+                freeFrame->unlock(true);
+                notifyUnfixedFrame();
+                continue;
+            }
+            freeFrame->setPageId(page);
+            shard.insertFrame(freeFrame, hash);
+            shardLock->unlock();
+
+            // pages in the compressed tier are decompressed right away, they don't need to wait for the batch
+            if (!_compressedCache || !_compressedCache->load(page, freeFrame->getData(), pagePool.pageSize())) {
+                batch.read(page, pagePool.pageSize(), freeFrame->getData());
+            }
+            frames.push_back(freeFrame);
+        }
+
+        _fileManager.submit(batch);
+        _fileManager.complete(batch);
+
+        for (BufferFrame *frame : frames) {
+            BufferReplacementManager &replacementManager = pool(frame->pageId().segment).replacementManager();
+            if (pattern == AccessPattern::sequential) {
+                replacementManager.coldFrame(frame);
             } else {
-                bucketLock->unlock();
+                replacementManager.newFrame(frame);
             }
+            frame->unlock(true);
+        }
+
+        return frames.size();
+    }
 
-            // TODO: if we newly loaded the frame, don't give up lock; if necessary downgrade lock
-            // then we won't need to check for deletion (but only if the frame is newly loaded))
+    std::tuple<BufferFrame*, uint64_t> BufferManager::fixPageOptimistic(uint64_t segmentId, uint64_t pageId) {
+        PageId page(segmentId, pageId);
+        _statistics.add(Counter::optimisticReads);
+
+        {
+            // lookup frame without locking the shard
+            uint64_t hash = BufferFrameTable::hash(page);
+            BufferFrame *frame = _table.findShard(hash).lookupFrame(page, hash);
+
+            // frame loaded and not locked exclusively? -> read without locking
+            // the frame might have been reused for another page since the lookup, so check the page id after reading the version
+            if (frame) {
+                uint64_t version = frame->version();
+                if (!BufferFrame::isLockedVersion(version) && !frame->isFree() && frame->pageId() == page) {
+                    return std::make_tuple(frame, version);
+                }
+            }
+        }
 
-            // finally aquire frame lock
-            frame->lock(exclusive);
+        // frame not loaded or locked exclusively -> wait for a shared lock, the version is stable while we hold it
+        PageGuard guard = fixPage(segmentId, pageId, false);
+        BufferFrame *frame = guard.get();
+        uint64_t version = frame->version();
+        unfixPage(guard, false);
 
-            // aquired lock, now reprioritize
-            if (!newlyCreated) {
-                _replacementManager.reprioritizeFrame(frame.get());
+        return std::make_tuple(frame, version);
+    }
+
+    bool BufferManager::unfixPageOptimistic(BufferFrame* frame, uint64_t version) {
+        assert(frame != nullptr);
+        assert(!BufferFrame::isLockedVersion(version));
+
+        return frame->validate(version);
+    }
+
+    PageId BufferManager::swizzle(PageId page, BufferFrame* frame) {
+        uint64_t index = frameIndex(frame);
+        if (page.segment > SWIZZLED_SEGMENT_MASK || index >= (SWIZZLED_BIT >> SWIZZLED_FRAME_SHIFT)) {
+            return page; // doesn't fit into a reference
+        }
+        return PageId(SWIZZLED_BIT | (index << SWIZZLED_FRAME_SHIFT) | page.segment, page.page);
+    }
+
+    PageGuard BufferManager::fixPage(PageId reference, bool exclusive) {
+        PageId page = unswizzle(reference);
+
+        if (isSwizzled(reference)) {
+            // the frame might have been reused for another page, check the page id before and after locking it
+            BufferFrame *frame = swizzledFrame(reference);
+            if (frame && !frame->isFree() && frame->pageId() == page) {
+                frame->fix();
+                lockFrame(frame, exclusive);
+                if (!frame->isFree() && frame->pageId() == page) {
+                    _statistics.add(Counter::fixes);
+                    pool(page.segment).replacementManager().reprioritizeFrame(frame);
+                    return PageGuard(this, frameIndex(frame), exclusive);
+                }
+                frame->unlock(exclusive);
+                if (frame->unfix()) {
+                    notifyUnfixedFrame();
+                }
             }
+        }
 
-            // is the frame deleted? -> start from the beginning
-            deleted = frame->isDeleted();
-            if (deleted) {
-                frame->unlock();
+        // not swizzled or the page isn't in the frame anymore -> lookup the frame table
+        return fixPage(page.segment, page.page, exclusive);
+    }
+
+    std::tuple<BufferFrame*, uint64_t> BufferManager::fixPageOptimistic(PageId reference) {
+        PageId page = unswizzle(reference);
+
+        if (isSwizzled(reference)) {
+            // same checks as an optimistic read after a frame table lookup
+            BufferFrame *frame = swizzledFrame(reference);
+            if (frame) {
+                uint64_t version = frame->version();
+                if (!BufferFrame::isLockedVersion(version) && !frame->isFree() && frame->pageId() == page) {
+                    _statistics.add(Counter::optimisticReads);
+                    return std::make_tuple(frame, version);
+                }
             }
-        } while (deleted);
+        }
 
-        //std::cout << "  fix: " << frame->getData() << std::endl;
-        // TODO: really return a normal pointer?
-        return frame;
+        // not swizzled or the page isn't in the frame anymore -> lookup the frame table
+        return fixPageOptimistic(page.segment, page.page);
     }
 
-    void BufferManager::unfixPage(std::shared_ptr<BufferFrame> frame, bool isDirty) {
-        //std::cout << "unfix: " << frame->getData() << std::endl;
+    StatisticsSnapshot BufferManager::statistics() {
+        StatisticsSnapshot snapshot;
+        _statistics.snapshot(snapshot);
 
-        // is the frame loaded?
-        assert(frame.get());
-        // why do we call unlock, if the frame doesn't exist / we don't have the lock?!
-        // has the caller used unfixPage before fixPage?
+        // count the pages in memory without locking the frames, the snapshot is approximate anyway
+        snapshot.frames = _size;
+        if (_compressedCache) {
+            snapshot.compressedPages = _compressedCache->pages();
+            snapshot.compressedBytes = _compressedCache->bytes();
+        }
+        for (uint64_t i = 0; i < _size; ++i) {
+            BufferFrame *frame = &_frames[i];
+            if (frame->isFree()) {
+                continue;
+            }
+            ++snapshot.residentPages[frame->pageId().segment];
+            if (frame->isDirty()) {
+                ++snapshot.dirtyFrames;
+            }
+        }
 
-        if (isDirty) {
-            frame->setDirty();
+        return snapshot;
+    }
+
+    void BufferManager::writePages(uint64_t segmentId, uint64_t firstPage, uint64_t count, const char* data) {
+        uint64_t pageSize = pool(segmentId).pageSize();
+
+        // copies in memory are replaced first, so an eviction can't write them over the new pages
+        for (uint64_t i = 0; i < count; ++i) {
+            PageId page(segmentId, firstPage + i);
+            if (_compressedCache) {
+                _compressedCache->erase(page);
+            }
+            uint64_t hash = BufferFrameTable::hash(page);
+            if (_table.findShard(hash).lookupFrame(page, hash)) {
+                PageGuard guard = fixPage(segmentId, page.page, true);
+                memcpy(guard->getData(), data + i * pageSize, pageSize);
+                unfixPage(guard, true);
+            }
+        }
+
+        _fileManager.writePages(PageId(segmentId, firstPage), pageSize, count * pageSize, data);
+    }
+
+    void BufferManager::flushSegment(uint64_t segmentId) {
+        flushFrames(segmentId, false);
+        _fileManager.sync(segmentId);
+    }
+
+    void BufferManager::flushAll() {
+        flushFrames(0, true);
+        _fileManager.sync();
+    }
+
+    void BufferManager::setPageSize(uint64_t segmentId, uint64_t pageSize) {
+        for (uint64_t i = 0; i < _pools.size(); ++i) {
+            if (_pools[i]->pageSize() == pageSize) {
+                if (segmentId < MAX_SEGMENTS) {
+                    _segmentPools[segmentId].store(i);
+                } else {
+                    assert(i == 0); // too many segments for other page sizes
+                }
+                return;
+            }
         }
+        assert(false); // no frames of the page size, configure them in the options
+        // TODO: error handling
+    }
 
-        frame->unlock();
+    uint64_t BufferManager::countFrames(uint64_t size, const BufferManagerOptions& options) {
+        for (const std::pair<const uint64_t, uint64_t> &pageSize : options.pageSizes) {
+            size += pageSize.second;
+        }
+        return size;
     }
 
-    void* BufferManager::initBuffer() {
-        void *buffer;
-        assert(posix_memalign(&buffer, PAGE_SIZE, _size * PAGE_SIZE) == 0);
-        assert(buffer != nullptr); // TODO: error handling
-        return buffer;
+    std::vector<std::unique_ptr<BufferPool>> BufferManager::initPools(uint64_t size, const BufferManagerOptions& options) {
+        std::vector<std::unique_ptr<BufferPool>> pools;
+        pools.emplace_back(new BufferPool(PAGE_SIZE, _frames.get(), 0, size, _fileManager, _statistics, options));
+
+        uint64_t firstFrame = size;
+        for (const std::pair<const uint64_t, uint64_t> &pageSize : options.pageSizes) {
+            assert(pageSize.first % PAGE_SIZE == 0 && pageSize.first != PAGE_SIZE);
+            assert(pageSize.second > 0);
+            pools.emplace_back(new BufferPool(pageSize.first, _frames.get() + firstFrame, firstFrame, pageSize.second, _fileManager, _statistics, options));
+            firstFrame += pageSize.second;
+        }
+        assert(pools.size() <= UINT8_MAX);
+        return pools;
+    }
+
+    std::unique_ptr<std::atomic<uint8_t>[]> BufferManager::initSegmentPools() {
+        std::unique_ptr<std::atomic<uint8_t>[]> segmentPools(new std::atomic<uint8_t>[MAX_SEGMENTS]);
+        for (uint64_t i = 0; i < MAX_SEGMENTS; ++i) {
+            segmentPools[i].store(0, std::memory_order_relaxed);
+        }
+        return segmentPools;
+    }
+
+    BufferFrame* BufferManager::evictPage(BufferPool& pool) {
+        while (true) {
+            BufferFrame *frame = pool.replacementManager().evictFrame();
+
+            // all frames fixed? -> wait until one is unfixed, however long that takes
+            // the waits are counted, so a pool that is too small for its threads shows up in the statistics
+            if (frame == nullptr) {
+                _statistics.add(Counter::frameWaits);
+                waitForUnfixedFrame();
+                continue;
+            }
+
+            // never wait for a frame lock, the thread fixing the frame in the meantime might wait for us
+            if (!frame->tryLock(true)) {
+                pool.replacementManager().keepFrame(frame);
+                continue;
+            }
+
+            if (!reclaimFrame(pool, frame)) {
+                pool.replacementManager().keepFrame(frame);
+                frame->unlock(true);
+                continue;
+            }
+            _statistics.add(Counter::evictions);
+            return frame;
+        }
     }
 
-    void* BufferManager::evictPage() {
-        BufferFrameNode node = _replacementManager.evictFrame();
-        if (node.inUse) {
-            // lookup frame in table
-            BufferFrameTableBucket& bucket = _table.findBucket(node.page);
-            std::unique_ptr<boost::unique_lock < boost::mutex>> bucketLock = bucket.lock();
-            std::shared_ptr<BufferFrame> frame = bucket.lookupFrame(node.page);
-            assert(frame); // all deletions evict the node fromt the queues first in an atomic operation
-            bucketLock->unlock();
+    bool BufferManager::reclaimFrame(BufferPool& pool, BufferFrame* frame) {
+        // frame holds no page? -> use it
+        if (frame->isFree()) {
+            return true;
+        }
+
+        // write dirty page to disk while the frame can still be found, so nobody loads stale data
+        // the background writer should have done that, wake it up to keep up with the evictions
+        if (cleanFrame(pool, frame) && pool.backgroundWriter()) {
+            pool.backgroundWriter()->wakeUp();
+        }
 
-            // lock and clean frame
-            frame->lock(true);
+        // keep the clean page compressed, while it can still be found in the frame, so no miss reads an older copy
+        if (_compressedCache) {
+            _compressedCache->store(frame->pageId(), frame->getData(), pool.pageSize());
+        }
 
-            cleanFrame(frame.get());
-            frame->setDeleted();
+        // lock shard and delete frame, unless somebody fixed it in the meantime
+        // a thread fixing it after the check finds the frame reused, once it gets the frame lock
+        PageId page = frame->pageId();
+        uint64_t hash = BufferFrameTable::hash(page);
+        BufferFrameTableShard& shard = _table.findShard(hash);
+        std::unique_ptr<boost::unique_lock < boost::mutex>> shardLock = shard.lock();
+        if (frame->isFixed()) {
+            if (_compressedCache) {
+                _compressedCache->erase(page); // the page stays in the frame, the copy would be outdated by the next change
+            }
+            return false;
+        }
+        shard.deleteFrame(page, hash);
+        shardLock->unlock();
 
-            // lock bucket and delete frame
-            bucketLock->lock();
-            bucket.deleteFrame(node.page);
-            bucketLock->unlock();
+        frame->setFree();
+        return true;
+    }
 
-            frame->unlock();
+    BufferFrame* BufferManager::evictRingFrame(BufferPool& pool, BufferRing& ring) {
+        // ring not full yet? -> take a frame from the pool
+        if (ring._frames.size() < ringSize(pool, ring)) {
+            return evictPage(pool);
         }
 
-        return node.data;
+        // recycle the oldest frame of the ring, unless it belongs to another pool or it doesn't hold the page of the ring anymore
+        uint64_t index = ring._frames.front().first;
+        PageId page = ring._frames.front().second;
+        ring._frames.pop_front();
+        BufferFrame *frame = this->frame(index);
+        if (pool.containsFrame(index) && frame->tryLock(true)) {
+            // the frame stays in the pool, if another thread used it or selected it for eviction
+            if (!frame->isFree() && frame->pageId() == page && pool.replacementManager().takeColdFrame(frame)) {
+                if (reclaimFrame(pool, frame)) {
+                    _statistics.add(Counter::evictions);
+                    return frame;
+                }
+                pool.replacementManager().keepFrame(frame);
+            }
+            frame->unlock(true);
+        }
+
+        return evictPage(pool);
     }
 
-    void BufferManager::cleanFrame(BufferFrame* frame) {
-        if (frame->isDirty()) {
-            // write data to disk
-            _fileManager.write(frame->pageId(), PAGE_SIZE, frame->getData());
+    void BufferManager::waitForUnfixedFrame() {
+        boost::unique_lock<boost::mutex> lock(_unfixMutex);
+        _waitingThreads.fetch_add(1);
+        // wait with a timeout, as a frame might have been unfixed before we started waiting
+        _unfixCondition.timed_wait(lock, boost::posix_time::milliseconds(EVICTION_WAIT_INTERVAL));
+        _waitingThreads.fetch_sub(1);
+    }
+
+    void BufferManager::notifyUnfixedFrame() {
+        if (_waitingThreads.load() > 0) {
+            boost::lock_guard<boost::mutex> lock(_unfixMutex);
+            _unfixCondition.notify_all();
+        }
+    }
+
+    void BufferManager::flushFrames(uint64_t segmentId, bool allSegments) {
+        // lock the dirty frames shared, so they can't be modified or evicted while writing
+        IOBatch batch;
+        std::vector<BufferFrame*> locked;
+        std::vector<BufferFrame*> busy;
+        for (uint64_t i = 0; i < _size; ++i) {
+            BufferFrame *frame = &_frames[i];
+            if (!frame->isDirty() || (!allSegments && frame->pageId().segment != segmentId)) {
+                continue;
+            }
+            if (!frame->tryLock(false)) {
+                busy.push_back(frame); // locked exclusively, write it after the others
+                continue;
+            }
+            if (!frame->isDirty() || (!allSegments && frame->pageId().segment != segmentId)) { // cleaned or reused in the meantime
+                frame->unlock(false);
+                continue;
+            }
+            batch.write(frame->pageId(), pool(frame->pageId().segment).pageSize(), frame->getData());
+            locked.push_back(frame);
+        }
+
+        _fileManager.writeCoalesced(batch);
+        for (BufferFrame *frame : locked) {
             frame->setClean();
+            frame->unlock(false);
+        }
+
+        // wait for the frames in use one at a time, holding no other lock, like any other thread fixing a page
+        for (BufferFrame *frame : busy) {
+            frame->fix();
+            frame->lock(false);
+            if (frame->isDirty() && (allSegments || frame->pageId().segment == segmentId)) {
+                _fileManager.write(frame->pageId(), pool(frame->pageId().segment).pageSize(), frame->getData());
+                frame->setClean();
+            }
+            frame->unlock(false);
+            if (frame->unfix()) {
+                notifyUnfixedFrame();
+            }
+        }
+    }
+
+    void BufferManager::lockDirtyNeighbors(PageId page, std::vector<BufferFrame*>& frames) {
+        // walk in both directions, until a neighbor isn't in memory, not dirty or in use
+        for (int64_t direction : {-1, 1}) {
+            for (uint64_t distance = 1; distance <= MAX_CLEAN_NEIGHBORS; ++distance) {
+                if (direction < 0 && distance > page.page) {
+                    break;
+                }
+                PageId neighbor(page.segment, page.page + direction * static_cast<int64_t> (distance));
+                uint64_t hash = BufferFrameTable::hash(neighbor);
+                BufferFrame *frame = _table.findShard(hash).lookupFrame(neighbor, hash);
+                if (!frame || !frame->isDirty() || !frame->tryLock(false)) {
+                    break;
+                }
+
+                // the frame might have been reused since the lookup
+                if (frame->isFree() || !(frame->pageId() == neighbor) || !frame->isDirty()) {
+                    frame->unlock(false);
+                    break;
+                }
+                frames.push_back(frame);
+            }
+        }
+    }
+
+    bool BufferManager::cleanFrame(BufferPool& pool, BufferFrame* frame) {
+        if (!frame->isDirty()) {
+            return false;
+        }
+
+        // write the adjacent dirty pages along, they are likely evicted soon as well
+        std::vector<BufferFrame*> neighbors;
+        lockDirtyNeighbors(frame->pageId(), neighbors);
+
+        IOBatch batch;
+        batch.write(frame->pageId(), pool.pageSize(), frame->getData());
+        for (BufferFrame *neighbor : neighbors) {
+            batch.write(neighbor->pageId(), pool.pageSize(), neighbor->getData());
+        }
+        _fileManager.writeCoalesced(batch);
+
+        frame->setClean();
+        for (BufferFrame *neighbor : neighbors) {
+            neighbor->setClean();
+            neighbor->unlock(false);
         }
+        _statistics.add(Counter::evictionWrites, batch.size());
+        return true;
     }
 }
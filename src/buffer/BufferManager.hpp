@@ -5,34 +5,53 @@
 #include "file.hpp"
 #include "BufferFrame.hpp"
 #include "BufferFrameTable.hpp"
-#include "BufferFrameTableBucket.hpp"
-#include "BufferReplacementManager.hpp"
+#include "BufferFrameTableShard.hpp"
+#include "BufferManagerOptions.hpp"
+#include "BufferPool.hpp"
+#include "BufferRing.hpp"
+#include "CompressedCache.hpp"
+#include "PageBatch.hpp"
+#include "PageGuard.hpp"
+#include "Statistics.hpp"
+#include "StatisticsReporter.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <tuple>
+#include <vector>
 
 namespace simpledb {
 
     /**
      * Buffer Manager that manages buffer frames and controls concurrent access to these frames.
+     * Segments have pages of PAGE_SIZE, unless setPageSize assigned them a larger page size.
+     * The frames of each page size form a pool of their own.
      */
     class BufferManager {
     public:
-        static constexpr uint64_t PAGE_SIZE = 4096 * 1; // the size of a frame in bytes
+        static constexpr uint64_t PAGE_SIZE = 4096 * 1; // the default size of a page in bytes, all page sizes are multiples of it
 
         /**
          * Creates a new instance that manages size frames and operates files in the folder path.
+         * Frames for larger pages are configured in the options.
          * @param path the path of the files the buffer manager operates on
-         * @param size the number of frames the buffer manager holds in memory
+         * @param size the number of frames of PAGE_SIZE the buffer manager holds in memory
+         * @param options the tuning options
          */
-        BufferManager(std::string path, uint64_t size) : _size(size), _buffer(initBuffer()), _fileManager(path), _table(size), _replacementManager(_size, PAGE_SIZE, _buffer) {
-        }
+        BufferManager(std::string path, uint64_t size, BufferManagerOptions options = BufferManagerOptions());
 
         /**
          * Writes all dirty pages back to disk and frees the allocated memory for the buffer frames.
+         * Adjacent dirty pages are written with one vectored write.
          */
         ~BufferManager();
 
@@ -46,56 +65,423 @@ namespace simpledb {
          * @param segmentId the segment ID
          * @param pageId the page ID
          * @param exclusive true, for exclusive (write) access; false, for shared (read) access
-         * @return pointer to the buffer frame
+         * @param pattern the access pattern, hits of sequential accesses aren't reprioritized
+         * @param ring the ring of a sequential scan, whose frames are recycled for pages that aren't loaded; nullptr, to evict from the pool
+         * @return guard holding the fixed frame
          */
-        std::shared_ptr<BufferFrame> fixPage(uint64_t segmentId, uint64_t pageId, bool exclusive);
+        PageGuard fixPage(uint64_t segmentId, uint64_t pageId, bool exclusive, AccessPattern pattern = AccessPattern::random, BufferRing* ring = nullptr);
 
         /**
          * Return a frame to the buffer manager indicating whether it is dirty or not.
          * If dirty, the page manager writes it back to disk. It does not
          * have to write it back immediately, but must not write it back before
          * unfixPage is called.
+         * The guard is empty afterwards.
          * This method is thread-safe.
-         * @param frame the frame to unfix
+         * @param guard the guard holding the frame to unfix
          * @param isDirty true, if the frame is dirty (has been changed); false, otherwise
          */
-        void unfixPage(std::shared_ptr<BufferFrame> frame, bool isDirty);
+        void unfixPage(PageGuard& guard, bool isDirty);
+
+        /**
+         * Loads pages that aren't in memory yet with one batch of reads, so they are in flight at once.
+         * Pages in memory are skipped. The pages must exist on disk.
+         * At most maxBatchSize pages are loaded, so a prefetch can't flush the whole buffer.
+         * The prefetch is skipped, if the batches of the pool use up their budget of frames.
+         * This method is thread-safe.
+         * @param segmentId the segment ID
+         * @param firstPage the page ID of the first page
+         * @param count the number of pages
+         * @param pattern the access pattern, sequentially accessed pages are loaded as cold frames
+         */
+        void prefetch(uint64_t segmentId, uint64_t firstPage, uint64_t count, AccessPattern pattern = AccessPattern::random);
+
+        /**
+         * Retrieves the frames of many pages at once, e.g. the pages of a list of TIDs.
+         * Repeated pages are fixed once. The pages that aren't in memory are loaded with one batch of reads.
+         * The frames are fixed in page order, so concurrent batches can't deadlock.
+         * At most maxBatchSize distinct pages of a pool can be fixed at once.
+         * All batches together fix at most half of the frames of a pool, so they can't pin the whole pool and wait for each other.
+         * If other batches already fix that many frames, no page is fixed and the caller fixes the pages one at a time instead.
+         * This method is thread-safe.
+         * @param pages the pages, they may repeat
+         * @param exclusive true, for exclusive (write) access; false, for shared (read) access
+         * @return the batch holding the fixed frames, it maps each of the pages to the guard of its frame;
+         * or an empty batch, if the budget of frames for batches is used up or there are no pages
+         */
+        PageBatch fixPages(const std::vector<PageId>& pages, bool exclusive);
+
+        /**
+         * Unfixes the pages of a batch that are still fixed as not dirty.
+         * Dirty pages are unfixed with unfixPage on their guards before.
+         * The batch is empty afterwards.
+         * This method is thread-safe.
+         * @param batch the batch holding the frames to unfix
+         */
+        void unfixPages(PageBatch& batch);
+
+        /**
+         * This method is thread-safe.
+         * @param segmentId the segment ID
+         * @return the number of pages of the segment, that can be fixed or prefetched with one batch
+         */
+        uint64_t maxBatchSize(uint64_t segmentId) {
+            return batchSize(pool(segmentId));
+        }
+
+        /**
+         * @return true, if pages are read from the device with direct I/O, then batches of reads save round trips;
+         * false, if the kernel page cache serves the reads
+         */
+        bool isDirectIO() const {
+            return _fileManager.isDirectIO();
+        }
+
+        /**
+         * Retrieves a frame for an optimistic read given a segment ID and a page ID.
+         * The frame is neither locked nor fixed, so the data can be modified concurrently. Readers must not trust
+         * anything they read (bounds check before dereferencing) until unfixPageOptimistic validated it.
+         * Only if the page is not in memory or locked exclusively, the frame is locked shortly.
+         * This method is thread-safe.
+         * @param segmentId the segment ID
+         * @param pageId the page ID
+         * @return a tuple of the buffer frame and the version to validate the read against
+         */
+        std::tuple<BufferFrame*, uint64_t> fixPageOptimistic(uint64_t segmentId, uint64_t pageId);
+
+        /**
+         * Validates an optimistic read of a frame retrieved by fixPageOptimistic.
+         * This method is thread-safe.
+         * @param frame the frame to unfix
+         * @param version the version returned by fixPageOptimistic
+         * @return true, if the frame was not modified since it was fixed; false, if all data read must be discarded
+         */
+        bool unfixPageOptimistic(BufferFrame* frame, uint64_t version);
+
+        /**
+         * Swizzles a reference to a page into a reference to the frame holding it, e.g. for a child reference in an index node.
+         * Swizzled references keep the page id, so they can be unswizzled at any time. They are validated against the frame
+         * on each use, so a reference to a frame that was evicted or reused for another page falls back to the frame table.
+         * @param page the page id
+         * @param frame the frame holding the page
+         * @return the swizzled reference; the page id, if it can't be swizzled
+         */
+        PageId swizzle(PageId page, BufferFrame* frame);
+
+        /**
+         * @param reference a swizzled or unswizzled reference
+         * @return the page id of the reference
+         */
+        static PageId unswizzle(PageId reference) {
+            if (!isSwizzled(reference)) {
+                return reference;
+            }
+            return PageId(reference.segment & SWIZZLED_SEGMENT_MASK, reference.page);
+        }
+
+        /**
+         * @param reference a swizzled or unswizzled reference
+         * @return true, if the reference was swizzled by swizzle; false, otherwise
+         */
+        static bool isSwizzled(PageId reference) {
+            return ((reference.segment & SWIZZLED_BIT) != 0);
+        }
+
+        /**
+         * Retrieves a frame like fixPage, but given a reference that might be swizzled.
+         * A swizzled reference to a frame still holding the page is resolved without a frame table lookup.
+         * This method is thread-safe.
+         * @param reference a swizzled or unswizzled reference
+         * @param exclusive true, for exclusive (write) access; false, for shared (read) access
+         * @return guard holding the fixed frame
+         */
+        PageGuard fixPage(PageId reference, bool exclusive);
+
+        /**
+         * Retrieves a frame for an optimistic read like fixPageOptimistic, but given a reference that might be swizzled.
+         * A swizzled reference to a frame still holding the page is resolved without a frame table lookup.
+         * This method is thread-safe.
+         * @param reference a swizzled or unswizzled reference
+         * @return a tuple of the buffer frame and the version to validate the read against
+         */
+        std::tuple<BufferFrame*, uint64_t> fixPageOptimistic(PageId reference);
+
+        /**
+         * Writes consecutive pages of a segment filled outside of the buffer with one write, e.g. by a bulk load.
+         * The pages aren't loaded into frames, but pages already in memory (e.g. of a removed segment with the same id) are overwritten.
+         * The pages must not be fixed concurrently.
+         * @param segmentId the segment ID
+         * @param firstPage the first page
+         * @param count the number of pages
+         * @param data the data of the pages
+         */
+        void writePages(uint64_t segmentId, uint64_t firstPage, uint64_t count, const char* data);
+
+        /**
+         * Writes all dirty pages of a segment to disk and syncs its file, e.g. at a checkpoint.
+         * Adjacent dirty pages are written with one vectored write. Pages modified concurrently are written after the modification.
+         * This method is thread-safe.
+         * @param segmentId the segment ID
+         */
+        void flushSegment(uint64_t segmentId);
+
+        /**
+         * Writes all dirty pages to disk and syncs all files, e.g. at a checkpoint.
+         * Adjacent dirty pages are written with one vectored write. Pages modified concurrently are written after the modification.
+         * This method is thread-safe.
+         */
+        void flushAll();
+
+        /**
+         * Sets the page size of a segment, e.g. when the segment manager creates or loads it.
+         * The buffer manager must have frames of that size and no page of the segment must be in memory.
+         * @param segmentId the segment ID
+         * @param pageSize the size of a page in bytes
+         */
+        void setPageSize(uint64_t segmentId, uint64_t pageSize);
+
+        /**
+         * This method is thread-safe.
+         * @param segmentId the segment ID
+         * @return the size of a page of the segment in bytes
+         */
+        uint64_t pageSize(uint64_t segmentId) {
+            return pool(segmentId).pageSize();
+        }
+
+        /**
+         * Takes a snapshot of the statistics, e.g. the hit rate, miss latencies and the pages of each segment in memory.
+         * The options can dump snapshots periodically.
+         * This method is thread-safe.
+         * @return the snapshot
+         */
+        StatisticsSnapshot statistics();
 
         /**
-         * @deprecated use PAGE_SIZE instead
+         * @deprecated use PAGE_SIZE or pageSize(segmentId) instead
          */
         uint64_t pageSize() {
             return PAGE_SIZE;
         }
 
     private:
-        uint64_t _size; // the number of frames the buffer manager holds in memory
-        void *_buffer; // the allocated memory region
+        friend class PageGuard;
+
+        static constexpr uint64_t MAX_CLEAN_NEIGHBORS = 16; // number of adjacent dirty pages in each direction an eviction writes along
+        static constexpr uint64_t MAX_BATCH_SHARE = 4; // a batch loads at most this fraction of the frames of a pool
+        static constexpr uint64_t MAX_BATCHES_SHARE = 2; // all batches of a pool together fix or load at most this fraction of its frames
+        static constexpr uint64_t EVICTION_WAIT_INTERVAL = 1; // time in ms to wait for an unfixed frame before retrying eviction
+        static constexpr uint64_t MAX_RING_SHARE = 8; // a ring holds at most this fraction of the frames of a pool
+        static constexpr uint64_t MAX_SEGMENTS = 1 << 16; // number of segments, that can have a page size other than PAGE_SIZE
+        static constexpr uint64_t SWIZZLED_BIT = 1ul << 63; // marks a swizzled reference, its segment holds the frame index in the bits below
+        static constexpr uint64_t SWIZZLED_FRAME_SHIFT = 32; // position of the frame index in the segment of a swizzled reference
+        static constexpr uint64_t SWIZZLED_SEGMENT_MASK = (1ul << SWIZZLED_FRAME_SHIFT) - 1; // the segment id in a swizzled reference
+
+        uint64_t _size; // the number of frames of all page sizes the buffer manager holds in memory
+        std::unique_ptr<BufferFrame[]> _frames; // the frames, the pools hold consecutive ranges of them
+        Statistics _statistics; // counters and histograms of the buffer manager and its file manager
         FileManager _fileManager; // manages reading and writing to disk
         BufferFrameTable _table; // hash table for all frames in memory
-        BufferReplacementManager _replacementManager; // implements page replacement strategy
+        std::vector<std::unique_ptr<BufferPool>> _pools; // one pool per page size, the first one for PAGE_SIZE
+        std::unique_ptr<std::atomic<uint8_t>[]> _segmentPools; // the index of the pool of each segment
+        std::unique_ptr<CompressedCache> _compressedCache; // keeps clean evicted pages compressed; or nullptr
+
+        boost::mutex _unfixMutex; // mutex for waiting on unfixed frames
+        boost::condition_variable _unfixCondition; // notified when a frame becomes evictable again
+        std::atomic<uint64_t> _waitingThreads; // number of threads waiting for an unfixed frame
+        std::unique_ptr<StatisticsReporter> _statisticsReporter; // dumps the statistics periodically; or nullptr
+
+        /**
+         * @param size the number of frames of PAGE_SIZE
+         * @param options the tuning options
+         * @return the number of frames of all page sizes
+         */
+        static uint64_t countFrames(uint64_t size, const BufferManagerOptions& options);
+
+        /**
+         * Creates a pool for PAGE_SIZE and for each page size in the options.
+         * @param size the number of frames of PAGE_SIZE
+         * @param options the tuning options
+         * @return the pools
+         */
+        std::vector<std::unique_ptr<BufferPool>> initPools(uint64_t size, const BufferManagerOptions& options);
+
+        /**
+         * Assigns all segments the pool of PAGE_SIZE.
+         * @return the pool indexes of the segments
+         */
+        std::unique_ptr<std::atomic<uint8_t>[]> initSegmentPools();
+
+        /**
+         * @param segmentId the segment ID
+         * @return the pool holding the pages of the segment
+         */
+        BufferPool& pool(uint64_t segmentId) {
+            if (segmentId >= MAX_SEGMENTS) {
+                return *_pools[0];
+            }
+            return *_pools[_segmentPools[segmentId].load(std::memory_order_relaxed)];
+        }
+
+        /**
+         * @param index the index of a frame
+         * @return pointer to the frame
+         */
+        BufferFrame* frame(uint64_t index) {
+            assert(index < _size);
+            return &_frames[index];
+        }
+
+        /**
+         * @param frame pointer to a frame
+         * @return the index of the frame
+         */
+        uint64_t frameIndex(BufferFrame* frame) {
+            assert(frame >= _frames.get() && frame < _frames.get() + _size);
+            return (frame - _frames.get());
+        }
+
+        /**
+         * @param reference a swizzled reference
+         * @return the frame the reference points to; nullptr, if the frame doesn't exist (e.g. a reference read from disk)
+         */
+        BufferFrame* swizzledFrame(PageId reference) {
+            uint64_t index = (reference.segment & ~SWIZZLED_BIT) >> SWIZZLED_FRAME_SHIFT;
+            if (index >= _size) {
+                return nullptr;
+            }
+            return &_frames[index];
+        }
+
+        /**
+         * Locks a frame, and records the time waited if it's locked by another thread.
+         * @param frame the frame
+         * @param exclusive true, for an exclusive lock; false, for a shared lock
+         */
+        void lockFrame(BufferFrame* frame, bool exclusive) {
+            if (!frame->tryLock(exclusive)) {
+                uint64_t start = Statistics::now();
+                frame->lock(exclusive);
+                _statistics.record(Histogram::lockWait, start);
+                _statistics.add(Counter::lockWaits);
+            }
+        }
+
+        /**
+         * Reads a page into a frame, from the compressed tier if it's there; from disk, otherwise.
+         * @param page the page
+         * @param pageSize the size of the page in bytes
+         * @param data the memory of the frame
+         */
+        void readPage(PageId page, uint64_t pageSize, void* data) {
+            if (!_compressedCache || !_compressedCache->load(page, data, pageSize)) {
+                _fileManager.read(page, pageSize, data);
+            }
+        }
+
+        /**
+         * Loads pages that aren't in memory yet with one batch of reads.
+         * Pages in the compressed tier are decompressed instead.
+         * Pages in memory are skipped. The pages must exist on disk.
+         * This method is thread-safe.
+         * @param pages the pages
+         * @param count the number of pages
+         * @param pattern the access pattern, sequentially accessed pages are loaded as cold frames
+         * @return the number of pages loaded
+         */
+        uint64_t loadPages(const PageId* pages, uint64_t count, AccessPattern pattern);
+
+        /**
+         * Evicts a buffer frame of a pool.
+         * Replacement is done by the replacement manager, fixed frames are never evicted. Dirty pages are written to disk.
+         * If all frames are fixed, it waits until a frame is unfixed.
+         * This method is thread-safe.
+         * @param pool the pool to evict from
+         * @return the free frame, it's locked exclusively
+         */
+        BufferFrame* evictPage(BufferPool& pool);
 
         /**
-         * Allocates memory to hold the buffer frames.
-         * Memory is aligned to the page size
-         * @return pointer to the allocated memory region
+         * Deletes the page of a frame from the frame table, so the frame can be reused.
+         * Dirty pages are written to disk first. The clean page is stored in the compressed tier, before it can't be found anymore.
+         * The frame must be locked exclusively by the caller.
+         * This method is thread-safe.
+         * @param pool the pool of the frame
+         * @param frame the frame
+         * @return true, if the frame is free; false, if it's fixed and can't be reused
          */
-        void* initBuffer();
+        bool reclaimFrame(BufferPool& pool, BufferFrame* frame);
 
         /**
-         * Evicts a buffer frame.
-         * Replacement is done by the replacement manager. Dirty pages are written to disk.
+         * Evicts a buffer frame for a page that a sequential scan loads.
+         * Until the ring is full, the frame is evicted from the pool. Then the oldest frame of the ring is recycled,
+         * unless another thread used or evicted it in the meantime; it stays in the pool then.
          * This method is thread-safe.
-         * @return pointer to the freed memory region
+         * @param pool the pool to evict from
+         * @param ring the ring of the scan
+         * @return the free frame, it's locked exclusively
+         */
+        BufferFrame* evictRingFrame(BufferPool& pool, BufferRing& ring);
+
+        /**
+         * @param pool the pool
+         * @param ring the ring
+         * @return the number of frames of the pool the ring may hold
+         */
+        static uint64_t ringSize(BufferPool& pool, BufferRing& ring) {
+            return std::min(ring._size, pool.size() / MAX_RING_SHARE);
+        }
+
+        /**
+         * @param pool the pool
+         * @return the number of frames of the pool, that one batch may fix or load
+         */
+        static uint64_t batchSize(BufferPool& pool) {
+            return std::max<uint64_t>(pool.size() / MAX_BATCH_SHARE, 1);
+        }
+
+        /**
+         * @param pool the pool
+         * @return the number of frames of the pool, that all batches together may fix or load
+         */
+        static uint64_t batchBudget(BufferPool& pool) {
+            return std::max<uint64_t>(pool.size() / MAX_BATCHES_SHARE, 1);
+        }
+
+        /**
+         * Blocks until a frame is unfixed or the wait interval elapsed.
+         * Used for backpressure, if all frames are fixed and none can be evicted.
+         */
+        void waitForUnfixedFrame();
+
+        /**
+         * Wakes up threads waiting for an unfixed frame, if there are any.
+         */
+        void notifyUnfixedFrame();
+
+        /**
+         * Writes the dirty pages of all or one segment to disk.
+         * @param segmentId the segment ID
+         * @param allSegments true, to write the pages of all segments; false, to write the pages of the segment only
+         */
+        void flushFrames(uint64_t segmentId, bool allSegments);
+
+        /**
+         * Locks the frames of dirty pages adjacent to a page shared, until a page isn't dirty or its frame is locked.
+         * @param page the page
+         * @param frames the vector to append the locked frames to
          */
-        void* evictPage();
+        void lockDirtyNeighbors(PageId page, std::vector<BufferFrame*>& frames);
 
         /**
          * Checks if a frame is dirty and writes it to disk.
+         * Adjacent dirty pages are written along with one vectored write, if their frames aren't locked exclusively.
          * The frame must be locked exclusively by the caller first.
+         * @param pool the pool of the frame
          * @param frame the frame to clean
+         * @return true, if the frame was dirty; false, otherwise
          */
-        void cleanFrame(BufferFrame* frame);
+        bool cleanFrame(BufferPool& pool, BufferFrame* frame);
     };
 }
 
@@ -0,0 +1,36 @@
+
+#ifndef SIMPLEDB_BUFFER_BUFFERMANAGEROPTIONS_HPP
+#define	SIMPLEDB_BUFFER_BUFFERMANAGEROPTIONS_HPP
+
+#include "BufferReplacementManager.hpp"
+#include "file/IOBackend.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace simpledb {
+
+    /**
+     * Tuning options of a buffer manager.
+     * The defaults are reasonable for all workloads, set single options to deviate from them.
+     */
+    struct BufferManagerOptions {
+        ReplacementStrategy strategy; // the buffer frame replacement strategy
+        uint64_t writerThreads; // number of background writer threads; 0, to write dirty pages only on eviction
+        uint64_t cleanFrames; // number of frames the background writer keeps clean ahead of the replacement strategy
+        IOBackendType ioBackend; // the backend for batched I/O
+        bool directIO; // bypass the kernel page cache with O_DIRECT, writes are synced when the buffer manager is destructed instead of on each write
+        std::map<uint64_t, uint64_t> pageSizes; // frames for segments with larger pages: page size in bytes -> number of frames
+        bool hugePages; // back the frames with huge pages; falls back to transparent huge pages, if none are reserved
+        bool numaAware; // place the frames on all NUMA nodes and evict frames of the local node first (needs the clock strategy)
+        uint64_t statisticsInterval; // time in ms between two dumps of the statistics; 0, to dump them never
+        std::string statisticsFile; // the file to append the dumps of the statistics to; empty, to print them to stdout
+        uint64_t compressedCacheSize; // memory in bytes for evicted pages kept compressed below the frames; 0, to read evicted pages from disk
+
+        BufferManagerOptions() : strategy(ReplacementStrategy::clock), writerThreads(1), cleanFrames(32), ioBackend(IOBackendType::automatic), directIO(false), pageSizes(), hugePages(true), numaAware(true), statisticsInterval(0), statisticsFile(), compressedCacheSize(0) {
+        };
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_BUFFERMANAGEROPTIONS_HPP */
@@ -0,0 +1,79 @@
+
+#include "BufferPool.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+
+namespace simpledb {
+
+    constexpr uint64_t BufferPool::HUGE_PAGE_SIZE;
+
+    BufferPool::BufferPool(uint64_t pageSize, BufferFrame* frames, uint64_t firstFrame, uint64_t size, FileManager& fileManager, Statistics& statistics, const BufferManagerOptions& options) : _pageSize(pageSize), _frames(frames), _firstFrame(firstFrame), _size(size), _nodes(options.numaAware ? std::min(Numa::nodes(), size) : 1), _bufferSize(), _hugePages(false), _buffer(initBuffer(options.hugePages)), _replacementManager(initReplacementManager(options.strategy)), _backgroundWriter(initBackgroundWriter(fileManager, statistics, options)), _batchFrames(0) {
+    }
+
+    BufferPool::~BufferPool() {
+        assert(!_backgroundWriter);
+        munmap(_buffer, _bufferSize);
+    }
+
+    bool BufferPool::reserveBatchFrames(uint64_t count, uint64_t budget) {
+        uint64_t reserved = _batchFrames.load();
+        do {
+            if (reserved + count > budget) {
+                return false;
+            }
+        } while (!_batchFrames.compare_exchange_weak(reserved, reserved + count));
+        return true;
+    }
+
+    void* BufferPool::initBuffer(bool hugePages) {
+        // round up to whole huge pages, so the last frames are backed by huge pages too
+        _bufferSize = (_size * _pageSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+        void *buffer = MAP_FAILED;
+        if (hugePages) {
+            buffer = mmap(nullptr, _bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            _hugePages = (buffer != MAP_FAILED);
+        }
+        if (buffer == MAP_FAILED) { // no huge pages reserved? -> ask for transparent huge pages
+            buffer = mmap(nullptr, _bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            assert(buffer != MAP_FAILED); // TODO: error handling
+            if (hugePages) {
+                madvise(buffer, _bufferSize, MADV_HUGEPAGE);
+            } else {
+                madvise(buffer, _bufferSize, MADV_NOHUGEPAGE);
+            }
+        }
+
+        // place the frames of each node before they are touched the first time, huge pages can't be split across nodes
+        for (uint64_t node = 0; node < _nodes && _nodes > 1; ++node) {
+            uint64_t begin = nodeBegin(node) * _pageSize / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            uint64_t end = std::min((nodeBegin(node + 1) * _pageSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE, _bufferSize);
+            Numa::bindMemory(reinterpret_cast<char *> (buffer) + begin, end - begin, node);
+        }
+
+        for (uint64_t i = 0; i < _size; ++i) {
+            _frames[i].setData(reinterpret_cast<char *> (buffer) + i * _pageSize);
+        }
+        return buffer;
+    }
+
+    std::unique_ptr<BufferReplacementManager> BufferPool::initReplacementManager(ReplacementStrategy strategy) {
+        switch (strategy) {
+            case ReplacementStrategy::twoQueue:
+                return std::unique_ptr<BufferReplacementManager>(new TwoQueueReplacementManager(_frames, _size));
+            case ReplacementStrategy::clock:
+                return std::unique_ptr<BufferReplacementManager>(new ClockReplacementManager(_frames, _size, _nodes));
+        }
+        assert(false); // unknown strategy
+        return nullptr;
+    }
+
+    std::unique_ptr<BackgroundWriter> BufferPool::initBackgroundWriter(FileManager& fileManager, Statistics& statistics, const BufferManagerOptions& options) {
+        if (options.writerThreads == 0) {
+            return nullptr;
+        }
+        return std::unique_ptr<BackgroundWriter>(new BackgroundWriter(_frames, _pageSize, fileManager, *_replacementManager, options.writerThreads, std::min(options.cleanFrames, _size), statistics));
+    }
+}
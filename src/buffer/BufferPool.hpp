@@ -0,0 +1,161 @@
+
+#ifndef SIMPLEDB_BUFFER_BUFFERPOOL_HPP
+#define	SIMPLEDB_BUFFER_BUFFERPOOL_HPP
+
+#include "file.hpp"
+#include "BackgroundWriter.hpp"
+#include "BufferFrame.hpp"
+#include "BufferManagerOptions.hpp"
+#include "BufferReplacementManager.hpp"
+#include "ClockReplacementManager.hpp"
+#include "Numa.hpp"
+#include "Statistics.hpp"
+#include "TwoQueueReplacementManager.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+namespace simpledb {
+
+    /**
+     * The frames of one page size, with their own replacement strategy and background writer.
+     * A pool holds a range of the frames of the buffer manager, so pages of different sizes never evict each other
+     * and guards address all frames by their index.
+     * The memory is mapped with huge pages, to need fewer TLB entries, and split into one consecutive part per NUMA node.
+     */
+    class BufferPool {
+    public:
+
+        /**
+         * Maps the memory of the frames and assigns each frame its memory region.
+         * @param pageSize the size of a page in bytes, a multiple of BufferManager::PAGE_SIZE
+         * @param frames the frames of the pool
+         * @param firstFrame the index of the first frame of the pool in the buffer manager
+         * @param size the number of frames of the pool
+         * @param fileManager the file manager the background writer writes with
+         * @param statistics the statistics the background writer counts in
+         * @param options the tuning options
+         */
+        BufferPool(uint64_t pageSize, BufferFrame* frames, uint64_t firstFrame, uint64_t size, FileManager& fileManager, Statistics& statistics, const BufferManagerOptions& options);
+
+        /**
+         * Unmaps the memory of the frames. The background writer must be stopped and the frames written before.
+         */
+        ~BufferPool();
+
+        BufferPool(const BufferPool& orig) = delete;
+        BufferPool& operator=(const BufferPool& orig) = delete;
+
+        uint64_t pageSize() const {
+            return _pageSize;
+        }
+
+        uint64_t size() const {
+            return _size;
+        }
+
+        /**
+         * @return true, if the memory is backed by reserved huge pages; false, if it uses regular or transparent huge pages
+         */
+        bool hasHugePages() const {
+            return _hugePages;
+        }
+
+        /**
+         * @param frameIndex the index of a frame in the buffer manager
+         * @return true, if the frame belongs to the pool; false, otherwise
+         */
+        bool containsFrame(uint64_t frameIndex) const {
+            return (frameIndex >= _firstFrame && frameIndex < _firstFrame + _size);
+        }
+
+        BufferReplacementManager& replacementManager() {
+            return *_replacementManager;
+        }
+
+        /**
+         * @return the background writer; or nullptr, if it's disabled or stopped
+         */
+        BackgroundWriter* backgroundWriter() {
+            return _backgroundWriter.get();
+        }
+
+        /**
+         * Reserves frames for a batch of pages, so concurrent batches can't fix all frames of the pool and wait for each other.
+         * This method is thread-safe.
+         * @param count the number of frames the batch fixes or loads
+         * @param budget the number of frames all batches of the pool together may fix or load
+         * @return true, if the frames were reserved; false, if the other batches leave too few frames of the budget
+         */
+        bool reserveBatchFrames(uint64_t count, uint64_t budget);
+
+        /**
+         * Returns the frames of a batch to the budget.
+         * This method is thread-safe.
+         * @param count the number of frames reserved for the batch
+         */
+        void releaseBatchFrames(uint64_t count) {
+            assert(_batchFrames.load() >= count);
+            _batchFrames.fetch_sub(count);
+        }
+
+        /**
+         * Stops the background writer, if it's running.
+         */
+        void stopBackgroundWriter() {
+            _backgroundWriter.reset();
+        }
+
+    private:
+        static constexpr uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // the size of a huge page in bytes
+
+        uint64_t _pageSize; // the size of a page in bytes
+        BufferFrame* _frames; // the frames of the pool
+        uint64_t _firstFrame; // the index of the first frame in the buffer manager
+        uint64_t _size; // the number of frames
+        uint64_t _nodes; // the number of NUMA nodes the frames are split across
+        uint64_t _bufferSize; // the size of the mapped memory region in bytes, a multiple of the huge page size
+        bool _hugePages; // true, if the memory region is backed by reserved huge pages
+        void *_buffer; // the mapped memory region
+        std::unique_ptr<BufferReplacementManager> _replacementManager; // implements page replacement strategy
+        std::unique_ptr<BackgroundWriter> _backgroundWriter; // writes dirty frames ahead of eviction, or nullptr
+        std::atomic<uint64_t> _batchFrames; // number of frames reserved by the batches fixing or loading pages of the pool
+
+        /**
+         * Maps memory to hold the frames, with reserved huge pages if possible, and binds the part of each node to it.
+         * Memory is aligned to the page size of the system, with reserved huge pages to the huge page size.
+         * @param hugePages true, to use huge pages; false, to use regular pages
+         * @return pointer to the mapped memory region
+         */
+        void* initBuffer(bool hugePages);
+
+        /**
+         * @param node a NUMA node
+         * @return the index of the first frame in the pool, that is placed on the node
+         */
+        uint64_t nodeBegin(uint64_t node) const {
+            return (node * _size / _nodes);
+        }
+
+        /**
+         * Creates the replacement manager for the frames.
+         * @param strategy the buffer frame replacement strategy
+         * @return the replacement manager
+         */
+        std::unique_ptr<BufferReplacementManager> initReplacementManager(ReplacementStrategy strategy);
+
+        /**
+         * Starts the background writer, if enabled.
+         * @param fileManager the file manager to write with
+         * @param statistics the statistics to count in
+         * @param options the tuning options
+         * @return the background writer; or nullptr, if it's disabled
+         */
+        std::unique_ptr<BackgroundWriter> initBackgroundWriter(FileManager& fileManager, Statistics& statistics, const BufferManagerOptions& options);
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_BUFFERPOOL_HPP */
+
@@ -3,78 +3,90 @@
 #define	SIMPLEDB_BUFFER_BUFFERREPLACEMENTMANAGER_HPP
 
 #include "BufferFrame.hpp"
-#include "BufferFrameNode.hpp"
-#include "PageId.hpp"
 
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/locks.hpp>
-#include <boost/thread/lock_types.hpp>
-
-#include <list>
-#include <memory>
+#include <cstdint>
+#include <vector>
 
 namespace simpledb {
 
     /**
-     * Implements the buffer frame replacement strategy: 2Q
-     * All operations are synchronized internally.
+     * Selects the buffer frame replacement strategy of a buffer manager:
+     * - twoQueue: 2Q with a fifo and a lru queue behind one mutex
+     * - clock: CLOCK with per-frame reference bits and partitioned clock hands, hits don't need any lock
+     */
+    enum class ReplacementStrategy {
+        twoQueue, clock
+    };
+
+    /**
+     * Interface for buffer frame replacement strategies.
+     * Initially all frames are free and can be evicted.
+     * All operations are thread-safe.
      */
     class BufferReplacementManager {
     public:
-
-        /**
-         * Creates a new buffer replacement manager.
-         * Initializes frame nodes for the supplied memory buffer.
-         * @param size number of frames
-         * @param pageSize the size of one frame in bytes
-         * @param buffer the memory region for the frames in memory
-         */
-        BufferReplacementManager(uint64_t size, long pageSize, void *buffer);
-
-        ~BufferReplacementManager() {
-        };
+        BufferReplacementManager() = default;
+        virtual ~BufferReplacementManager() = default;
 
         BufferReplacementManager(const BufferReplacementManager& orig) = delete;
         BufferReplacementManager& operator=(const BufferReplacementManager& orig) = delete;
 
         /**
-         * Evicts the next frame.
-         * Deletes the frame node from a queue and sets the queueState of the frame accordingly.
-         * This method is thread-safe.
-         * @return the frame node
+         * Selects the next frame to evict. Fixed frames are never selected.
+         * The caller must lock the frame exclusively before evicting it and
+         * hand it back with keepFrame, if that fails.
+         * @return the frame; or nullptr, if all frames are fixed or evicted by other threads
+         */
+        virtual BufferFrame* evictFrame() = 0;
+
+        /**
+         * Collects the frames that are likely evicted next, without evicting them.
+         * Fixed frames are skipped. The result may be stale, as frames are used concurrently.
+         * @param victims the vector to append the frames to
+         * @param count the maximum number of frames to collect
          */
-        BufferFrameNode evictFrame();
+        virtual void nextVictims(std::vector<BufferFrame*>& victims, uint64_t count) = 0;
 
         /**
-         * Inserts a new frame in the fifo queue.
-         * This method is thread-safe.
+         * Registers a frame that was just loaded with a new page.
          * @param frame the new frame
          */
-        void newFrame(BufferFrame* frame);
+        virtual void newFrame(BufferFrame* frame) = 0;
 
         /**
-         * Reprioritizes a frame.
-         * The frame is moved to the back of the lru queue.
-         * This method is thread-safe.
-         * @param frame the frame to reprioritize
+         * Registers a frame with a page that is unlikely to be used again, e.g. loaded by a sequential scan.
+         * It is evicted before the frames that were used since they were loaded.
+         * @param frame the cold frame
          */
-        void reprioritizeFrame(BufferFrame* frame);
+        virtual void coldFrame(BufferFrame* frame) = 0;
 
-    private:
-        std::list<BufferFrameNode> _fifoQueue; // the fifo queue
-        std::list<BufferFrameNode> _lruQueue; // the lru queue
+        /**
+         * Takes a frame registered with coldFrame out of the replacement strategy, so its owner can reuse it for another page.
+         * That fails, if the frame was used or selected by evictFrame since it was registered.
+         * The caller must lock the frame exclusively before and hand it back with keepFrame, if evicting it fails.
+         * @param frame the cold frame
+         * @return true, if the frame was taken; false, otherwise
+         */
+        virtual bool takeColdFrame(BufferFrame* frame) = 0;
 
-        boost::mutex _mutex; // mutex for concurrent access
+        /**
+         * Hands back a frame returned by evictFrame that is in use and couldn't be evicted.
+         * @param frame the frame in use
+         */
+        virtual void keepFrame(BufferFrame* frame) = 0;
 
         /**
-         * Checks if a frame is in the specified queue
-         * @param frame the frame to search for
-         * @param queue the check to use
-         * @return true, if the frame can be found in the queue; false, else
+         * Hands back a frame returned by evictFrame that holds no page, so it is evicted next.
+         * @param frame the free frame
          */
-        bool isFrameInQueue(BufferFrame* frame, std::list<BufferFrameNode>& queue);
+        virtual void freeFrame(BufferFrame* frame) = 0;
+
+        /**
+         * Reprioritizes a frame on a cache hit.
+         * @param frame the frame to reprioritize
+         */
+        virtual void reprioritizeFrame(BufferFrame* frame) = 0;
     };
 }
 
 #endif	/* SIMPLEDB_BUFFER_BUFFERREPLACEMENTMANAGER_HPP */
-
@@ -0,0 +1,7 @@
+
+#include "BufferRing.hpp"
+
+namespace simpledb {
+
+    constexpr uint64_t BufferRing::DEFAULT_SIZE;
+}
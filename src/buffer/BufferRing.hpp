@@ -0,0 +1,54 @@
+
+#ifndef SIMPLEDB_BUFFER_BUFFERRING_HPP
+#define	SIMPLEDB_BUFFER_BUFFERRING_HPP
+
+#include "PageId.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace simpledb {
+
+    /**
+     * Hints how a page is accessed:
+     * - random: the page is likely used again, it joins the pool and hits reprioritize it
+     * - sequential: the page is read by a large scan and unlikely used again, hits don't reprioritize it
+     */
+    enum class AccessPattern {
+        random, sequential
+    };
+
+    /**
+     * Small private ring of frames for a sequential scan.
+     * Pages the scan loads recycle the frames of the ring instead of evicting frames of the shared pool,
+     * so a scan over a segment larger than the pool doesn't flush the hot pages of other threads.
+     * The frames of the ring aren't fixed, they join the pool as cold frames and can be evicted by other threads.
+     * A frame is only recycled, if it still holds the page the ring loaded and no other thread used it in the meantime.
+     * A ring is used by one thread at a time.
+     */
+    class BufferRing {
+    public:
+        static constexpr uint64_t DEFAULT_SIZE = 32; // number of frames of a ring, at most an eighth of the pool is used
+
+        /**
+         * Constructs an empty ring.
+         * @param size the maximum number of frames of the ring; 0, for a ring that holds no frames
+         */
+        explicit BufferRing(uint64_t size = DEFAULT_SIZE) : _size(size), _frames() {
+        };
+
+        ~BufferRing() = default;
+
+        BufferRing(const BufferRing& orig) = delete;
+        BufferRing& operator=(const BufferRing& orig) = delete;
+
+    private:
+        friend class BufferManager;
+
+        uint64_t _size; // the maximum number of frames
+        std::deque<std::pair<uint64_t, PageId>> _frames; // the indexes of the frames of the ring and the pages loaded into them, the oldest first
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_BUFFERRING_HPP */
@@ -0,0 +1,100 @@
+
+#include "ClockReplacementManager.hpp"
+#include "Numa.hpp"
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+
+namespace simpledb {
+
+    ClockReplacementManager::ClockReplacementManager(BufferFrame* frames, uint64_t size, uint64_t nodes) : _frames(frames), _size(size), _nodes(nodes), _partitionsPerNode(), _partitions(), _hands(), _nextPartition(0) {
+        assert(size > 0);
+        assert(nodes > 0 && nodes <= size);
+
+        // one partition per hardware thread, but keep the partitions large enough to approximate a global clock
+        // the same number of partitions per node, so the partitions of a node cover exactly its frames
+        uint64_t threads = std::max(boost::thread::hardware_concurrency(), 1u);
+        uint64_t partitions = std::max<uint64_t>(std::min(threads, size / MIN_PARTITION_SIZE), 1);
+        _partitionsPerNode = std::max<uint64_t>(std::min((partitions + _nodes - 1) / _nodes, size / _nodes), 1);
+        _partitions = _partitionsPerNode * _nodes;
+
+        _hands.reset(new ClockHand[_partitions]);
+        for (uint64_t i = 0; i < _partitions; ++i) {
+            _hands[i].position.store(0);
+        }
+    }
+
+    BufferFrame* ClockReplacementManager::evictFrame() {
+        uint64_t node = (_nodes > 1) ? Numa::currentNode() % _nodes : 0;
+        uint64_t first = _nextPartition.fetch_add(1, std::memory_order_relaxed);
+
+        for (uint64_t i = 0; i < _partitions; ++i) {
+            // round robin over the partitions of the local node, then over those of the next nodes
+            uint64_t partition = ((node + i / _partitionsPerNode) % _nodes) * _partitionsPerNode + (first + i) % _partitionsPerNode;
+            uint64_t begin = partitionBegin(partition);
+            uint64_t partitionSize = partitionBegin(partition + 1) - begin;
+
+            // two rounds, so all reference bits are cleared once
+            for (uint64_t j = 0; j < 2 * partitionSize; ++j) {
+                uint64_t position = _hands[partition].position.fetch_add(1, std::memory_order_relaxed);
+                BufferFrame *frame = &_frames[begin + position % partitionSize];
+
+                if (frame->isFixed()) {
+                    continue;
+                }
+                if (frame->isReferenced()) {
+                    frame->setReferenced(false); // second chance
+                    continue;
+                }
+                return frame;
+            }
+        }
+
+        return nullptr; // all frames are fixed
+    }
+
+    void ClockReplacementManager::nextVictims(std::vector<BufferFrame*>& victims, uint64_t count) {
+        // the same number of frames ahead of each hand, the frames without reference bit are evicted next
+        uint64_t perPartition = (count + _partitions - 1) / _partitions;
+
+        for (uint64_t partition = 0; partition < _partitions; ++partition) {
+            uint64_t begin = partitionBegin(partition);
+            uint64_t partitionSize = partitionBegin(partition + 1) - begin;
+            uint64_t position = _hands[partition].position.load(std::memory_order_relaxed);
+
+            uint64_t found = 0;
+            for (uint64_t j = 0; j < partitionSize && found < perPartition; ++j) {
+                BufferFrame *frame = &_frames[begin + (position + j) % partitionSize];
+                if (!frame->isFixed() && !frame->isReferenced()) {
+                    victims.push_back(frame);
+                    ++found;
+                }
+            }
+        }
+    }
+
+    void ClockReplacementManager::newFrame(BufferFrame* frame) {
+        frame->setReferenced(true);
+    }
+
+    void ClockReplacementManager::coldFrame(BufferFrame* frame) {
+        frame->setReferenced(false);
+    }
+
+    bool ClockReplacementManager::takeColdFrame(BufferFrame* frame) {
+        return !frame->isReferenced();
+    }
+
+    void ClockReplacementManager::keepFrame(BufferFrame* frame) {
+        frame->setReferenced(true);
+    }
+
+    void ClockReplacementManager::freeFrame(BufferFrame* frame) {
+        frame->setReferenced(false);
+    }
+
+    void ClockReplacementManager::reprioritizeFrame(BufferFrame* frame) {
+        frame->setReferenced(true);
+    }
+}
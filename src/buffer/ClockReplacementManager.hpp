@@ -0,0 +1,128 @@
+
+#ifndef SIMPLEDB_BUFFER_CLOCKREPLACEMENTMANAGER_HPP
+#define	SIMPLEDB_BUFFER_CLOCKREPLACEMENTMANAGER_HPP
+
+#include "BufferFrame.hpp"
+#include "BufferReplacementManager.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace simpledb {
+
+    /**
+     * Implements the buffer frame replacement strategy: CLOCK (second chance)
+     * The frames are split into partitions with a clock hand each, so concurrent evictions don't contend on one hand.
+     * A hit only sets the reference bit of the frame, no operation takes a lock.
+     * With several NUMA nodes, each node has its own partitions, and evictions search the partitions of the evicting thread's node first.
+     */
+    class ClockReplacementManager : public BufferReplacementManager {
+    public:
+
+        /**
+         * Creates a new clock replacement manager.
+         * @param frames the frames of the buffer manager
+         * @param size number of frames
+         * @param nodes number of NUMA nodes, the frames are split into equal consecutive parts per node
+         */
+        ClockReplacementManager(BufferFrame* frames, uint64_t size, uint64_t nodes = 1);
+
+        virtual ~ClockReplacementManager() {
+        };
+
+        ClockReplacementManager(const ClockReplacementManager& orig) = delete;
+        ClockReplacementManager& operator=(const ClockReplacementManager& orig) = delete;
+
+        /**
+         * Advances the clock hand of a partition until it finds a frame that is neither fixed nor referenced.
+         * Reference bits are cleared on the way. If a partition has no such frame after two rounds, the next partition is searched.
+         * The partitions of the calling thread's NUMA node are searched before those of the other nodes.
+         * This method is thread-safe.
+         * @return the frame; or nullptr, if all frames are fixed
+         */
+        virtual BufferFrame* evictFrame();
+
+        /**
+         * Collects the frames without reference bit ahead of the clock hands.
+         * This method is thread-safe.
+         * @param victims the vector to append the frames to
+         * @param count the maximum number of frames to collect
+         */
+        virtual void nextVictims(std::vector<BufferFrame*>& victims, uint64_t count);
+
+        /**
+         * Sets the reference bit of a new frame.
+         * This method is thread-safe.
+         * @param frame the new frame
+         */
+        virtual void newFrame(BufferFrame* frame);
+
+        /**
+         * Clears the reference bit of a cold frame.
+         * This method is thread-safe.
+         * @param frame the cold frame
+         */
+        virtual void coldFrame(BufferFrame* frame);
+
+        /**
+         * Takes a cold frame, if its reference bit wasn't set since. The clock has no list of frames to remove it from.
+         * This method is thread-safe.
+         * @param frame the cold frame
+         * @return true, if the frame was taken; false, if it was used
+         */
+        virtual bool takeColdFrame(BufferFrame* frame);
+
+        /**
+         * Sets the reference bit of a frame in use.
+         * This method is thread-safe.
+         * @param frame the frame in use
+         */
+        virtual void keepFrame(BufferFrame* frame);
+
+        /**
+         * Clears the reference bit of a free frame.
+         * This method is thread-safe.
+         * @param frame the free frame
+         */
+        virtual void freeFrame(BufferFrame* frame);
+
+        /**
+         * Sets the reference bit of a frame.
+         * This method is thread-safe.
+         * @param frame the frame to reprioritize
+         */
+        virtual void reprioritizeFrame(BufferFrame* frame);
+
+    private:
+        static constexpr uint64_t MIN_PARTITION_SIZE = 64; // minimal number of frames per partition
+        static constexpr uint64_t CACHE_LINE_SIZE = 64; // size of a cache line in bytes
+
+        /**
+         * Clock hand of a partition, padded to a cache line to avoid false sharing.
+         */
+        struct ClockHand {
+            std::atomic<uint64_t> position; // position of the hand, increases monotonically
+            char padding[CACHE_LINE_SIZE - sizeof (std::atomic<uint64_t>)];
+        };
+
+        BufferFrame* _frames; // the frames of the buffer manager
+        uint64_t _size; // number of frames
+        uint64_t _nodes; // number of NUMA nodes
+        uint64_t _partitionsPerNode; // number of partitions of each node
+        uint64_t _partitions; // number of partitions
+        std::unique_ptr<ClockHand[]> _hands; // clock hand of each partition
+        std::atomic<uint64_t> _nextPartition; // round robin counter to distribute evictions across the partitions
+
+        /**
+         * @param partition the partition
+         * @return the index of the first frame of the partition
+         */
+        uint64_t partitionBegin(uint64_t partition) const {
+            return (partition * _size / _partitions);
+        }
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_CLOCKREPLACEMENTMANAGER_HPP */
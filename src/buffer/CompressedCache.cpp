@@ -0,0 +1,95 @@
+
+#include "CompressedCache.hpp"
+#include "PageCodec.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+namespace simpledb {
+
+    constexpr uint64_t CompressedCache::SHARDS;
+    constexpr uint64_t CompressedCache::MAX_COMPRESSED_SHARE;
+
+    CompressedCache::CompressedCache(uint64_t capacity, Statistics& statistics) : _shardCapacity(capacity / SHARDS), _shards(new Shard[SHARDS]), _pages(0), _bytes(0), _statistics(statistics) {
+        for (uint64_t i = 0; i < SHARDS; ++i) {
+            _shards[i].bytes = 0;
+        }
+    }
+
+    void CompressedCache::store(PageId pageId, const void* data, uint64_t pageSize) {
+        // compress without holding the lock, pages that don't compress well are read from disk again
+        uint64_t capacity = pageSize * MAX_COMPRESSED_SHARE / 100;
+        std::unique_ptr<char[]> buffer(new char[capacity]);
+        uint64_t length = PageCodec::compress(reinterpret_cast<const char*> (data), pageSize, buffer.get(), capacity);
+        if (length == 0 || length > _shardCapacity) {
+            erase(pageId);
+            _statistics.add(Counter::compressedRejects);
+            return;
+        }
+        std::unique_ptr<char[]> compressed(new char[length]);
+        memcpy(compressed.get(), buffer.get(), length);
+
+        Shard &pageShard = shard(pageId);
+        boost::lock_guard<boost::mutex> lock(pageShard.mutex);
+
+        std::unordered_map<PageId, Entry, PageIdHash>::iterator existing = pageShard.entries.find(pageId);
+        if (existing != pageShard.entries.end()) {
+            eraseEntry(pageShard, existing);
+        }
+
+        // drop the oldest pages until the page fits
+        while (pageShard.bytes + length > _shardCapacity) {
+            eraseEntry(pageShard, pageShard.entries.find(pageShard.order.front()));
+            _statistics.add(Counter::compressedDrops);
+        }
+
+        pageShard.order.push_back(pageId);
+        Entry &entry = pageShard.entries[pageId];
+        entry.data = std::move(compressed);
+        entry.length = length;
+        entry.age = std::prev(pageShard.order.end());
+        pageShard.bytes += length;
+        _pages.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(length, std::memory_order_relaxed);
+        _statistics.add(Counter::compressedStores);
+    }
+
+    bool CompressedCache::load(PageId pageId, void* data, uint64_t pageSize) {
+        uint64_t start = Statistics::now();
+        Shard &pageShard = shard(pageId);
+        boost::lock_guard<boost::mutex> lock(pageShard.mutex);
+
+        std::unordered_map<PageId, Entry, PageIdHash>::iterator entry = pageShard.entries.find(pageId);
+        if (entry == pageShard.entries.end()) {
+            return false;
+        }
+
+        bool res = PageCodec::decompress(entry->second.data.get(), entry->second.length, reinterpret_cast<char*> (data), pageSize);
+        assert(res);
+        // TODO: error handling
+        eraseEntry(pageShard, entry);
+
+        _statistics.record(Histogram::compressedLoadLatency, start);
+        _statistics.add(Counter::compressedHits);
+        return res;
+    }
+
+    void CompressedCache::erase(PageId pageId) {
+        Shard &pageShard = shard(pageId);
+        boost::lock_guard<boost::mutex> lock(pageShard.mutex);
+
+        std::unordered_map<PageId, Entry, PageIdHash>::iterator entry = pageShard.entries.find(pageId);
+        if (entry != pageShard.entries.end()) {
+            eraseEntry(pageShard, entry);
+        }
+    }
+
+    void CompressedCache::eraseEntry(Shard& shard, std::unordered_map<PageId, Entry, PageIdHash>::iterator entry) {
+        shard.bytes -= entry->second.length;
+        _pages.fetch_sub(1, std::memory_order_relaxed);
+        _bytes.fetch_sub(entry->second.length, std::memory_order_relaxed);
+        shard.order.erase(entry->second.age);
+        shard.entries.erase(entry);
+    }
+}
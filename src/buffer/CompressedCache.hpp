@@ -0,0 +1,128 @@
+
+#ifndef SIMPLEDB_BUFFER_COMPRESSEDCACHE_HPP
+#define	SIMPLEDB_BUFFER_COMPRESSEDCACHE_HPP
+
+#include "PageId.hpp"
+#include "Statistics.hpp"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace simpledb {
+
+    /**
+     * Second in-memory tier below the frames: clean pages evicted from the frames are kept compressed, so a miss that finds
+     * its page here is decompressed in microseconds instead of read from disk.
+     * The tier is exclusive, a page is removed when it's loaded into a frame and stored again when it's evicted. Pages that
+     * don't compress well are not stored. When the tier is full, the least recently stored pages are dropped.
+     * The cache is split into shards with a lock each, all methods are thread-safe.
+     */
+    class CompressedCache {
+    public:
+        static constexpr uint64_t SHARDS = 16; // number of shards, each holds an equal part of the capacity
+        static constexpr uint64_t MAX_COMPRESSED_SHARE = 75; // a page is stored, if it compresses to at most this percentage
+
+        /**
+         * @param capacity the maximum size of the compressed pages in bytes
+         * @param statistics the statistics to count the hits, stores and drops in
+         */
+        CompressedCache(uint64_t capacity, Statistics& statistics);
+
+        CompressedCache(const CompressedCache& orig) = delete;
+        CompressedCache& operator=(const CompressedCache& orig) = delete;
+
+        /**
+         * Compresses and stores a clean page, an older version of the page is replaced.
+         * @param pageId the page id
+         * @param data the page
+         * @param pageSize the size of the page in bytes
+         */
+        void store(PageId pageId, const void* data, uint64_t pageSize);
+
+        /**
+         * Decompresses a page and removes it from the cache.
+         * @param pageId the page id
+         * @param data the memory for the page
+         * @param pageSize the size of the page in bytes
+         * @return true, if the page was found; false, if it must be read from disk
+         */
+        bool load(PageId pageId, void* data, uint64_t pageSize);
+
+        /**
+         * Removes a page, e.g. because its frame is used again and the stored copy will be outdated.
+         * @param pageId the page id
+         */
+        void erase(PageId pageId);
+
+        /**
+         * @return the number of pages stored
+         */
+        uint64_t pages() const {
+            return _pages.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return the size of the compressed pages in bytes
+         */
+        uint64_t bytes() const {
+            return _bytes.load(std::memory_order_relaxed);
+        }
+
+    private:
+
+        /**
+         * A compressed page and its position in the order of the stores.
+         */
+        struct Entry {
+            std::unique_ptr<char[]> data; // the compressed page
+            uint64_t length; // the length of the compressed page in bytes
+            std::list<PageId>::iterator age; // the position in the order of the stores
+        };
+
+        struct PageIdHash {
+
+            std::size_t operator()(const PageId& pageId) const {
+                return pageId.segment * 0x9e3779b97f4a7c15ul ^ pageId.page;
+            }
+        };
+
+        /**
+         * The pages of one part of the page ids.
+         */
+        struct Shard {
+            boost::mutex mutex; // protects the entries and the order
+            std::unordered_map<PageId, Entry, PageIdHash> entries; // map: page id -> compressed page
+            std::list<PageId> order; // the pages from the oldest to the latest store
+            uint64_t bytes; // the size of the compressed pages of the shard in bytes
+        };
+
+        uint64_t _shardCapacity; // the maximum size of the compressed pages of a shard in bytes
+        std::unique_ptr<Shard[]> _shards; // the shards
+        std::atomic<uint64_t> _pages; // number of pages stored
+        std::atomic<uint64_t> _bytes; // size of the compressed pages in bytes
+        Statistics& _statistics; // counts hits, stores and drops
+
+        /**
+         * @param pageId the page id
+         * @return the shard of the page
+         */
+        Shard& shard(PageId pageId) {
+            return _shards[PageIdHash()(pageId) % SHARDS];
+        }
+
+        /**
+         * Removes an entry of a shard, the shard must be locked.
+         * @param shard the shard
+         * @param entry the entry
+         */
+        void eraseEntry(Shard& shard, std::unordered_map<PageId, Entry, PageIdHash>::iterator entry);
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_COMPRESSEDCACHE_HPP */
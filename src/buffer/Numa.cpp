@@ -0,0 +1,55 @@
+
+#include "Numa.hpp"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+namespace simpledb {
+
+    constexpr uint64_t Numa::MAX_NODES;
+
+    uint64_t Numa::nodes() {
+        static const uint64_t nodes = [] {
+            // the online nodes are a list of ranges, e.g. "0-1", the highest node is the last number
+            std::ifstream in("/sys/devices/system/node/online");
+            std::string online;
+            if (!(in >> online)) {
+                return static_cast<uint64_t> (1);
+            }
+            std::string::size_type start = online.find_last_of("-,");
+            start = (start == std::string::npos) ? 0 : start + 1;
+            return static_cast<uint64_t> (std::stoul(online.substr(start)) + 1);
+        }();
+        return nodes;
+    }
+
+    uint64_t Numa::currentNode() {
+        if (nodes() == 1) {
+            return 0;
+        }
+
+        unsigned cpu;
+        unsigned node;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) < 0) {
+            return 0;
+        }
+        return node;
+    }
+
+    bool Numa::bindMemory(void* address, size_t length, uint64_t node) {
+        if (nodes() == 1) {
+            return true;
+        }
+
+        unsigned long nodeMask[(MAX_NODES + 8 * sizeof (unsigned long) - 1) / (8 * sizeof (unsigned long))] = {0};
+        if (node >= MAX_NODES) {
+            return false;
+        }
+        nodeMask[node / (8 * sizeof (unsigned long))] = 1ul << (node % (8 * sizeof (unsigned long)));
+        return (syscall(SYS_mbind, address, length, MPOL_PREFERRED, nodeMask, MAX_NODES + 1, 0) == 0);
+    }
+}
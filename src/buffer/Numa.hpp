@@ -0,0 +1,45 @@
+
+#ifndef SIMPLEDB_BUFFER_NUMA_HPP
+#define	SIMPLEDB_BUFFER_NUMA_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simpledb {
+
+    /**
+     * Minimal NUMA support through the raw system calls, so libnuma isn't needed.
+     * On machines without NUMA, there is exactly one node and binding memory does nothing.
+     */
+    class Numa {
+    public:
+        Numa() = delete;
+
+        /**
+         * Reads the online nodes once.
+         * @return the number of NUMA nodes, at least 1
+         */
+        static uint64_t nodes();
+
+        /**
+         * @return the NUMA node of the CPU the calling thread runs on
+         */
+        static uint64_t currentNode();
+
+        /**
+         * Places the memory of a region on a node. Must be called before the memory is touched the first time.
+         * The node is only preferred, if it runs out of memory, other nodes are used.
+         * @param address the start of the region, aligned to the page size of the system
+         * @param length the length of the region in bytes
+         * @param node the NUMA node
+         * @return true, if the memory is placed on the node; false, otherwise
+         */
+        static bool bindMemory(void* address, size_t length, uint64_t node);
+
+    private:
+        static constexpr uint64_t MAX_NODES = 64; // maximum number of NUMA nodes memory can be bound to
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_NUMA_HPP */
+
@@ -0,0 +1,29 @@
+#include "PageBatch.hpp"
+
+#include "BufferManager.hpp"
+
+namespace simpledb {
+
+    PageBatch::~PageBatch() {
+        reset();
+    }
+
+    PageBatch& PageBatch::operator=(PageBatch&& orig) {
+        if (this != &orig) {
+            reset();
+
+            _bufferManager = orig._bufferManager;
+            _guards = std::move(orig._guards);
+            _guardIndexes = std::move(orig._guardIndexes);
+            _reservations = std::move(orig._reservations);
+            orig._bufferManager = nullptr;
+        }
+        return *this;
+    }
+
+    void PageBatch::reset() {
+        if (isValid()) {
+            _bufferManager->unfixPages(*this);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+
+#ifndef SIMPLEDB_BUFFER_PAGEBATCH_HPP
+#define	SIMPLEDB_BUFFER_PAGEBATCH_HPP
+
+#include "PageGuard.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace simpledb {
+
+    class BufferManager;
+    class BufferPool;
+
+    /**
+     * Move-only handle for the pages fixed together by BufferManager::fixPages.
+     * Each distinct page is fixed once, the batch maps each requested page to the guard of its frame.
+     * The frames count against the batch budget of their pools until the batch is unfixed.
+     * Pages still fixed when the batch is destructed are unfixed as not dirty.
+     * The batch must not outlive the buffer manager.
+     */
+    class PageBatch {
+    public:
+
+        /**
+         * Constructs an empty batch that doesn't hold any pages.
+         */
+        PageBatch() : _bufferManager(nullptr), _guards(), _guardIndexes(), _reservations() {
+        };
+
+        /**
+         * Unfixes the pages as not dirty, if they are still fixed.
+         */
+        ~PageBatch();
+
+        PageBatch(const PageBatch& orig) = delete;
+        PageBatch& operator=(const PageBatch& orig) = delete;
+
+        PageBatch(PageBatch&& orig) : _bufferManager(orig._bufferManager), _guards(std::move(orig._guards)), _guardIndexes(std::move(orig._guardIndexes)), _reservations(std::move(orig._reservations)) {
+            orig._bufferManager = nullptr;
+        };
+
+        PageBatch& operator=(PageBatch&& orig);
+
+        /**
+         * @return true, if the batch holds fixed pages; false, otherwise
+         */
+        bool isValid() const {
+            return (_bufferManager != nullptr);
+        }
+
+        explicit operator bool() const {
+            return isValid();
+        }
+
+        /**
+         * @return the number of requested pages, including repeated ones
+         */
+        uint64_t size() const {
+            return _guardIndexes.size();
+        }
+
+        /**
+         * @return the guards of the distinct pages, in page order
+         */
+        std::vector<PageGuard>& guards() {
+            return _guards;
+        }
+
+        /**
+         * @param index the index of a requested page
+         * @return the index of the guard of the page in guards()
+         */
+        uint64_t guardIndex(uint64_t index) const {
+            assert(index < _guardIndexes.size());
+            return _guardIndexes[index];
+        }
+
+        /**
+         * @param index the index of a requested page
+         * @return the guard of the page, shared by all requests of the same page
+         */
+        PageGuard& operator[](uint64_t index) {
+            return _guards[guardIndex(index)];
+        }
+
+        /**
+         * Unfixes the pages as not dirty, if the batch still holds them.
+         */
+        void reset();
+
+    private:
+        friend class BufferManager;
+
+        BufferManager* _bufferManager; // the buffer manager holding the frames, or nullptr for an empty batch
+        std::vector<PageGuard> _guards; // the guards of the distinct pages, in page order
+        std::vector<uint64_t> _guardIndexes; // requested page -> index of its guard
+        std::vector<std::pair<BufferPool*, uint64_t>> _reservations; // the pools of the pages and the number of frames reserved in each
+
+        /**
+         * Empties the batch after the buffer manager unfixed its pages.
+         */
+        void release() {
+            _bufferManager = nullptr;
+            _guards.clear();
+            _guardIndexes.clear();
+            _reservations.clear();
+        }
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_PAGEBATCH_HPP */
@@ -0,0 +1,185 @@
+
+#include "PageCodec.hpp"
+
+#include <cstring>
+
+namespace simpledb {
+
+    constexpr uint64_t PageCodec::MIN_MATCH;
+    constexpr uint64_t PageCodec::LAST_LITERALS;
+    constexpr uint64_t PageCodec::MATCH_LIMIT;
+    constexpr uint64_t PageCodec::MAX_OFFSET;
+    constexpr uint64_t PageCodec::HASH_BITS;
+
+    uint64_t PageCodec::compress(const char* source, uint64_t length, char* target, uint64_t capacity) {
+        // the last position + 1 each hash of 4 bytes was seen at, 0 if never
+        uint32_t positions[1 << HASH_BITS];
+        memset(positions, 0, sizeof (positions));
+
+        char *out = target;
+        const char *end = target + capacity;
+        uint64_t anchor = 0; // the first literal not written yet
+        uint64_t position = 0;
+        uint64_t matchStartLimit = (length > MATCH_LIMIT) ? length - MATCH_LIMIT : 0;
+
+        while (position < matchStartLimit) {
+            uint32_t value;
+            memcpy(&value, source + position, sizeof (value));
+            uint32_t slot = hash(value);
+            uint64_t candidate = positions[slot] - 1;
+            bool isMatch = false;
+            if (positions[slot] > 0 && position - candidate <= MAX_OFFSET) {
+                uint32_t candidateValue;
+                memcpy(&candidateValue, source + candidate, sizeof (candidateValue));
+                isMatch = (candidateValue == value);
+            }
+            positions[slot] = position + 1;
+            if (!isMatch) {
+                ++position;
+                continue;
+            }
+
+            // extend the match, it must end before the last literals
+            uint64_t matchLength = MIN_MATCH;
+            while (position + matchLength + sizeof (uint64_t) <= length - LAST_LITERALS) {
+                uint64_t a, b;
+                memcpy(&a, source + candidate + matchLength, sizeof (a));
+                memcpy(&b, source + position + matchLength, sizeof (b));
+                if (a != b) {
+                    break;
+                }
+                matchLength += sizeof (uint64_t);
+            }
+            while (position + matchLength < length - LAST_LITERALS && source[candidate + matchLength] == source[position + matchLength]) {
+                ++matchLength;
+            }
+
+            if (!writeSequence(source + anchor, position - anchor, position - candidate, matchLength, out, end)) {
+                return 0;
+            }
+            position += matchLength;
+            anchor = position;
+        }
+
+        if (!writeSequence(source + anchor, length - anchor, 0, 0, out, end)) {
+            return 0;
+        }
+        return (out - target);
+    }
+
+    bool PageCodec::decompress(const char* source, uint64_t compressedLength, char* target, uint64_t length) {
+        const char *in = source;
+        const char *inEnd = source + compressedLength;
+        char *out = target;
+        char *outEnd = target + length;
+
+        while (in < inEnd) {
+            uint8_t token = static_cast<uint8_t> (*in++);
+
+            // literals
+            uint64_t literalLength = token >> 4;
+            if (literalLength == 15) {
+                uint8_t byte;
+                do {
+                    if (in >= inEnd) {
+                        return false;
+                    }
+                    byte = static_cast<uint8_t> (*in++);
+                    literalLength += byte;
+                } while (byte == 255);
+            }
+            if (literalLength > static_cast<uint64_t> (inEnd - in) || literalLength > static_cast<uint64_t> (outEnd - out)) {
+                return false;
+            }
+            memcpy(out, in, literalLength);
+            in += literalLength;
+            out += literalLength;
+
+            // the last sequence has no back reference
+            if (in == inEnd) {
+                break;
+            }
+
+            // back reference, it may overlap the bytes it produces
+            if (inEnd - in < 2) {
+                return false;
+            }
+            uint64_t offset = static_cast<uint8_t> (in[0]) | (static_cast<uint64_t> (static_cast<uint8_t> (in[1])) << 8);
+            in += 2;
+            uint64_t matchLength = token & 15;
+            if (matchLength == 15) {
+                uint8_t byte;
+                do {
+                    if (in >= inEnd) {
+                        return false;
+                    }
+                    byte = static_cast<uint8_t> (*in++);
+                    matchLength += byte;
+                } while (byte == 255);
+            }
+            matchLength += MIN_MATCH;
+            if (offset == 0 || offset > static_cast<uint64_t> (out - target) || matchLength > static_cast<uint64_t> (outEnd - out)) {
+                return false;
+            }
+            // the copied bytes repeat with the offset as period, so any multiple of it is a source that doesn't overlap the chunk
+            uint64_t distance = offset;
+            while (matchLength > 0) {
+                uint64_t chunk = (matchLength < distance) ? matchLength : distance;
+                memcpy(out, out - distance, chunk);
+                out += chunk;
+                matchLength -= chunk;
+                distance *= 2;
+            }
+        }
+
+        return (out == outEnd);
+    }
+
+    bool PageCodec::writeLength(uint64_t length, char*& target, const char* end) {
+        while (length >= 255) {
+            if (target >= end) {
+                return false;
+            }
+            *target++ = static_cast<char> (255);
+            length -= 255;
+        }
+        if (target >= end) {
+            return false;
+        }
+        *target++ = static_cast<char> (length);
+        return true;
+    }
+
+    bool PageCodec::writeSequence(const char* literals, uint64_t literalLength, uint64_t offset, uint64_t matchLength, char*& target, const char* end) {
+        if (target >= end) {
+            return false;
+        }
+
+        // token: 4 bits literal length, 4 bits match length minus the minimum, 15 means the length continues
+        uint64_t matchCode = (offset > 0) ? matchLength - MIN_MATCH : 0;
+        char *token = target++;
+        *token = static_cast<char> (((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+        if (literalLength >= 15 && !writeLength(literalLength - 15, target, end)) {
+            return false;
+        }
+        if (literalLength > static_cast<uint64_t> (end - target)) {
+            return false;
+        }
+        memcpy(target, literals, literalLength);
+        target += literalLength;
+
+        if (offset == 0) {
+            return true;
+        }
+        if (end - target < 2) {
+            return false;
+        }
+        *target++ = static_cast<char> (offset & 0xff);
+        *target++ = static_cast<char> (offset >> 8);
+        if (matchCode >= 15 && !writeLength(matchCode - 15, target, end)) {
+            return false;
+        }
+        return true;
+    }
+}
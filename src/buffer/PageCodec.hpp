@@ -0,0 +1,73 @@
+
+#ifndef SIMPLEDB_BUFFER_PAGECODEC_HPP
+#define	SIMPLEDB_BUFFER_PAGECODEC_HPP
+
+#include <cstdint>
+
+namespace simpledb {
+
+    /**
+     * Fast compression of pages in the LZ4 block format: a sequence of tokens with literal runs and back references of
+     * at least 4 bytes into the last 64 KiB. It favours speed over ratio, a page is compressed or decompressed in microseconds.
+     */
+    class PageCodec {
+    public:
+        /**
+         * Compresses a memory region.
+         * @param source the memory region
+         * @param length the length of the region in bytes, less than 4 GiB
+         * @param target the memory for the compressed data
+         * @param capacity the capacity of the target in bytes
+         * @return the length of the compressed data; 0, if it doesn't fit into the target
+         */
+        static uint64_t compress(const char* source, uint64_t length, char* target, uint64_t capacity);
+
+        /**
+         * Decompresses data compressed by compress().
+         * @param source the compressed data
+         * @param compressedLength the length of the compressed data in bytes
+         * @param target the memory for the decompressed data
+         * @param length the length of the decompressed data in bytes
+         * @return true, if the data was decompressed to exactly length bytes; false, if it's corrupt
+         */
+        static bool decompress(const char* source, uint64_t compressedLength, char* target, uint64_t length);
+
+    private:
+        static constexpr uint64_t MIN_MATCH = 4; // the shortest back reference
+        static constexpr uint64_t LAST_LITERALS = 5; // the last bytes are always literals
+        static constexpr uint64_t MATCH_LIMIT = 12; // no back reference starts in the last bytes
+        static constexpr uint64_t MAX_OFFSET = 65535; // the longest distance of a back reference
+        static constexpr uint64_t HASH_BITS = 12; // the number of bits of the hash table of recent positions
+
+        /**
+         * @param value 4 bytes of the source
+         * @return the hash table slot of the bytes
+         */
+        static uint32_t hash(uint32_t value) {
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        /**
+         * Writes a length that doesn't fit into the 4 bits of a token, as a sequence of 255s and a remainder.
+         * @param length the length minus 15
+         * @param target the memory to write to, it's advanced
+         * @param end the end of the memory
+         * @return true, if the length fit; false, otherwise
+         */
+        static bool writeLength(uint64_t length, char*& target, const char* end);
+
+        /**
+         * Writes a sequence of literals followed by a back reference.
+         * @param literals the literals
+         * @param literalLength the number of literals
+         * @param offset the distance of the back reference; 0, for the last sequence that has no back reference
+         * @param matchLength the length of the back reference
+         * @param target the memory to write to, it's advanced
+         * @param end the end of the memory
+         * @return true, if the sequence fit; false, otherwise
+         */
+        static bool writeSequence(const char* literals, uint64_t literalLength, uint64_t offset, uint64_t matchLength, char*& target, const char* end);
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_PAGECODEC_HPP */
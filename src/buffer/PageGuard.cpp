@@ -0,0 +1,34 @@
+
+#include "PageGuard.hpp"
+
+#include "BufferManager.hpp"
+
+namespace simpledb {
+
+    PageGuard::~PageGuard() {
+        reset();
+    }
+
+    PageGuard& PageGuard::operator=(PageGuard&& orig) {
+        if (this != &orig) {
+            reset();
+
+            _bufferManager = orig._bufferManager;
+            _frameIndex = orig._frameIndex;
+            _exclusive = orig._exclusive;
+            orig._bufferManager = nullptr;
+        }
+        return *this;
+    }
+
+    BufferFrame* PageGuard::get() const {
+        assert(isValid());
+        return _bufferManager->frame(_frameIndex);
+    }
+
+    void PageGuard::reset() {
+        if (isValid()) {
+            _bufferManager->unfixPage(*this, false);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+
+#ifndef SIMPLEDB_BUFFER_PAGEGUARD_HPP
+#define	SIMPLEDB_BUFFER_PAGEGUARD_HPP
+
+#include "BufferFrame.hpp"
+
+#include <cstdint>
+
+namespace simpledb {
+
+    class BufferManager;
+
+    /**
+     * Move-only handle for a page fixed by the buffer manager.
+     * The guard pins the frame through its index in the buffer manager and holds a shared or exclusive lock on it.
+     * A page that is still fixed when the guard is destructed is unfixed as not dirty.
+     * The guard must not outlive the buffer manager.
+     */
+    class PageGuard {
+    public:
+
+        /**
+         * Constructs an empty guard that doesn't hold a page.
+         */
+        PageGuard() : _bufferManager(nullptr), _frameIndex(0), _exclusive(false) {
+        };
+
+        /**
+         * Constructs a guard for a frame that is already fixed and locked.
+         * @param bufferManager the buffer manager holding the frame
+         * @param frameIndex the index of the frame in the buffer manager
+         * @param exclusive true, if the frame is locked exclusively; false, if it's locked shared
+         */
+        PageGuard(BufferManager* bufferManager, uint64_t frameIndex, bool exclusive) : _bufferManager(bufferManager), _frameIndex(frameIndex), _exclusive(exclusive) {
+        };
+
+        /**
+         * Unfixes the page as not dirty, if it's still fixed.
+         */
+        ~PageGuard();
+
+        PageGuard(const PageGuard& orig) = delete;
+        PageGuard& operator=(const PageGuard& orig) = delete;
+
+        PageGuard(PageGuard&& orig) : _bufferManager(orig._bufferManager), _frameIndex(orig._frameIndex), _exclusive(orig._exclusive) {
+            orig._bufferManager = nullptr;
+        };
+
+        PageGuard& operator=(PageGuard&& orig);
+
+        /**
+         * @return true, if the guard holds a fixed page; false, otherwise
+         */
+        bool isValid() const {
+            return (_bufferManager != nullptr);
+        }
+
+        explicit operator bool() const {
+            return isValid();
+        }
+
+        /**
+         * @return true, if the page is locked exclusively; false, if it's locked shared
+         */
+        bool isExclusive() const {
+            return _exclusive;
+        }
+
+        /**
+         * @return the index of the frame in the buffer manager
+         */
+        uint64_t frameIndex() const {
+            return _frameIndex;
+        }
+
+        /**
+         * @return pointer to the fixed frame
+         */
+        BufferFrame* get() const;
+
+        BufferFrame* operator->() const {
+            return get();
+        }
+
+        /**
+         * Unfixes the page as not dirty, if the guard still holds it.
+         */
+        void reset();
+
+    private:
+        friend class BufferManager;
+
+        BufferManager* _bufferManager; // the buffer manager holding the frame, or nullptr for an empty guard
+        uint64_t _frameIndex; // index of the frame in the buffer manager
+        bool _exclusive; // true, if the frame is locked exclusively
+
+        /**
+         * Empties the guard without unfixing the page.
+         */
+        void release() {
+            _bufferManager = nullptr;
+        }
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_PAGEGUARD_HPP */
@@ -0,0 +1,38 @@
+
+#include "ReadAhead.hpp"
+#include "BufferManager.hpp"
+
+#include <algorithm>
+
+namespace simpledb {
+
+    constexpr uint64_t ReadAhead::MIN_WINDOW;
+    constexpr uint64_t ReadAhead::MAX_WINDOW;
+
+    void ReadAhead::access(PageId pageId) {
+        bool sequential = _lastPage.isValid() && pageId.segment == _lastPage.segment && pageId.page == _lastPage.page + 1;
+        _lastPage = pageId;
+        if (!sequential) { // reset
+            _prefetchedUntil = pageId.page + 1;
+            _window = 0;
+            return;
+        }
+        if (_bufferManager == nullptr) {
+            return;
+        }
+
+        // prefetch next window, when half of the previous one is consumed
+        if (_window > 0 && _prefetchedUntil > pageId.page + _window / 2) {
+            return;
+        }
+        _window = (_window == 0) ? MIN_WINDOW : std::min(_window * 2, MAX_WINDOW);
+
+        uint64_t firstPage = std::max(_prefetchedUntil, pageId.page + 1);
+        if (firstPage >= _segmentSize) {
+            return; // end of segment
+        }
+        uint64_t count = std::min(_window, _segmentSize - firstPage);
+        _bufferManager->prefetch(pageId.segment, firstPage, count, AccessPattern::sequential);
+        _prefetchedUntil = firstPage + count;
+    }
+}
@@ -0,0 +1,55 @@
+
+#ifndef SIMPLEDB_BUFFER_READAHEAD_HPP
+#define	SIMPLEDB_BUFFER_READAHEAD_HPP
+
+#include "PageId.hpp"
+
+#include <cstdint>
+
+namespace simpledb {
+
+    class BufferManager;
+
+    /**
+     * Detects sequential page accesses of a scan and prefetches the pages ahead of it.
+     * The window of prefetched pages starts small and doubles with each prefetch, as long as the accesses stay sequential.
+     * Any other access resets the window, so random accesses don't load unused pages.
+     * Each scan needs its own read-ahead, it isn't thread-safe.
+     */
+    class ReadAhead {
+    public:
+
+        /**
+         * Constructs a read-ahead that never prefetches.
+         */
+        ReadAhead() : ReadAhead(nullptr, 0) {
+        };
+
+        /**
+         * @param bufferManager the buffer manager loading the pages, it must outlive the read-ahead
+         * @param segmentSize number of pages of the scanned segment, no page behind it is prefetched
+         */
+        ReadAhead(BufferManager* bufferManager, uint64_t segmentSize) : _bufferManager(bufferManager), _segmentSize(segmentSize), _lastPage(), _prefetchedUntil(0), _window(0) {
+        };
+
+        /**
+         * Notes the access of a page, call it before the page is fixed.
+         * Prefetches the next window, if the access is sequential and the scan consumed half of the pages prefetched before.
+         * @param pageId the accessed page
+         */
+        void access(PageId pageId);
+
+    private:
+        static constexpr uint64_t MIN_WINDOW = 4; // number of pages prefetched, when a sequential access is detected
+        static constexpr uint64_t MAX_WINDOW = 64; // maximum number of pages prefetched at once
+
+        BufferManager* _bufferManager;
+        uint64_t _segmentSize;
+        PageId _lastPage; // the last accessed page; invalid, if there was no access yet
+        uint64_t _prefetchedUntil; // page ID behind the last prefetched page
+        uint64_t _window; // number of pages prefetched next; 0, if the accesses aren't sequential
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_READAHEAD_HPP */
+
@@ -0,0 +1,111 @@
+
+#include "Statistics.hpp"
+
+#include <iomanip>
+
+namespace simpledb {
+
+    constexpr uint64_t StatisticsSnapshot::COUNTERS;
+    constexpr uint64_t StatisticsSnapshot::HISTOGRAMS;
+    constexpr uint64_t StatisticsSnapshot::BUCKETS;
+    constexpr uint64_t Statistics::SHARDS;
+
+    StatisticsSnapshot::StatisticsSnapshot() : counters(), histograms(), durations(), frames(0), dirtyFrames(0), compressedPages(0), compressedBytes(0), residentPages() {
+    }
+
+    double StatisticsSnapshot::hitRate() const {
+        if (counter(Counter::fixes) == 0) {
+            return 1;
+        }
+        return 1 - static_cast<double> (counter(Counter::misses)) / counter(Counter::fixes);
+    }
+
+    uint64_t StatisticsSnapshot::count(Histogram histogram) const {
+        uint64_t count = 0;
+        for (uint64_t bucketCount : histograms[static_cast<uint64_t> (histogram)]) {
+            count += bucketCount;
+        }
+        return count;
+    }
+
+    uint64_t StatisticsSnapshot::mean(Histogram histogram) const {
+        uint64_t durationCount = count(histogram);
+        if (durationCount == 0) {
+            return 0;
+        }
+        return durations[static_cast<uint64_t> (histogram)] / durationCount;
+    }
+
+    uint64_t StatisticsSnapshot::percentile(Histogram histogram, double fraction) const {
+        uint64_t durationCount = count(histogram);
+        if (durationCount == 0) {
+            return 0;
+        }
+
+        // find the first bucket, up to which enough durations are counted
+        const std::array<uint64_t, BUCKETS> &buckets = histograms[static_cast<uint64_t> (histogram)];
+        uint64_t below = 0;
+        for (uint64_t i = 0; i < BUCKETS; ++i) {
+            below += buckets[i];
+            if (below >= fraction * durationCount) {
+                return (1ul << i);
+            }
+        }
+        return (1ul << (BUCKETS - 1));
+    }
+
+    void StatisticsSnapshot::print(std::ostream& out) const {
+        static const char *counterNames[COUNTERS] = {"fixes", "misses", "optimistic reads", "evictions", "eviction writes", "background writes", "frame waits", "batches declined", "lock waits", "reads", "writes", "bytes read", "bytes written", "compressed hits", "compressed stores", "compressed rejects", "compressed drops"};
+        static const char *histogramNames[HISTOGRAMS] = {"miss latency", "lock wait", "read latency", "write latency", "compressed load latency"};
+
+        out << "hit rate: " << std::fixed << std::setprecision(4) << hitRate() << std::endl;
+        for (uint64_t i = 0; i < COUNTERS; ++i) {
+            out << counterNames[i] << ": " << counters[i] << std::endl;
+        }
+        for (uint64_t i = 0; i < HISTOGRAMS; ++i) {
+            Histogram histogram = static_cast<Histogram> (i);
+            out << histogramNames[i] << ": count " << count(histogram) << ", mean " << mean(histogram) << " ns, p50 < " << percentile(histogram, 0.5) << " ns, p99 < " << percentile(histogram, 0.99) << " ns" << std::endl;
+        }
+        out << "frames: " << frames << ", dirty: " << dirtyFrames << std::endl;
+        out << "compressed pages: " << compressedPages << ", " << compressedBytes << " bytes" << std::endl;
+        for (const std::pair<const uint64_t, uint64_t> &segment : residentPages) {
+            out << "segment " << segment.first << ": " << segment.second << " pages in memory" << std::endl;
+        }
+    }
+
+    Statistics::Statistics() : _shards(new Shard[SHARDS]) {
+        for (uint64_t i = 0; i < SHARDS; ++i) {
+            for (std::atomic<uint64_t> &value : _shards[i].counters) {
+                value.store(0, std::memory_order_relaxed);
+            }
+            for (std::array<std::atomic<uint64_t>, StatisticsSnapshot::BUCKETS> &buckets : _shards[i].histograms) {
+                for (std::atomic<uint64_t> &value : buckets) {
+                    value.store(0, std::memory_order_relaxed);
+                }
+            }
+            for (std::atomic<uint64_t> &value : _shards[i].durations) {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Statistics::snapshot(StatisticsSnapshot& snapshot) const {
+        for (uint64_t i = 0; i < SHARDS; ++i) {
+            for (uint64_t j = 0; j < StatisticsSnapshot::COUNTERS; ++j) {
+                snapshot.counters[j] += _shards[i].counters[j].load(std::memory_order_relaxed);
+            }
+            for (uint64_t j = 0; j < StatisticsSnapshot::HISTOGRAMS; ++j) {
+                for (uint64_t k = 0; k < StatisticsSnapshot::BUCKETS; ++k) {
+                    snapshot.histograms[j][k] += _shards[i].histograms[j][k].load(std::memory_order_relaxed);
+                }
+                snapshot.durations[j] += _shards[i].durations[j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    uint64_t Statistics::threadShard() {
+        static std::atomic<uint64_t> nextShard(0);
+        static thread_local uint64_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return shard;
+    }
+}
@@ -0,0 +1,196 @@
+
+#ifndef SIMPLEDB_BUFFER_STATISTICS_HPP
+#define	SIMPLEDB_BUFFER_STATISTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+
+namespace simpledb {
+
+    /**
+     * Events counted by the buffer manager and the file manager.
+     */
+    enum class Counter : uint64_t {
+        fixes, // pages fixed with a lock
+        misses, // fixes that had to load the page
+        optimisticReads, // pages read optimistically
+        evictions, // frames evicted from the replacement strategy
+        evictionWrites, // dirty pages written by an eviction
+        backgroundWrites, // dirty pages written by a background writer
+        frameWaits, // waits for an unfixed frame, because all frames were fixed
+        batchesDeclined, // batches and prefetches declined, because other batches fixed the budget of frames of their pool
+        lockWaits, // fixes that had to wait for the frame lock
+        reads, // page reads
+        writes, // page writes
+        bytesRead, // bytes read from disk
+        bytesWritten, // bytes written to disk
+        compressedHits, // misses that found the page in the compressed tier
+        compressedStores, // evicted pages stored in the compressed tier
+        compressedRejects, // evicted pages that didn't compress well enough
+        compressedDrops // pages dropped from the full compressed tier
+    };
+
+    /**
+     * Durations recorded by the buffer manager and the file manager.
+     */
+    enum class Histogram : uint64_t {
+        missLatency, // time to load a page on a miss, including the eviction
+        lockWait, // time waited for a frame lock
+        readLatency, // time of a synchronous read
+        writeLatency, // time of a synchronous write
+        compressedLoadLatency // time to decompress a page from the compressed tier
+    };
+
+    /**
+     * Copy of all statistics at one point in time.
+     * The copy isn't atomic, counters of concurrent events might be off by a few.
+     */
+    struct StatisticsSnapshot {
+        static constexpr uint64_t COUNTERS = static_cast<uint64_t> (Counter::compressedDrops) + 1; // number of counters
+        static constexpr uint64_t HISTOGRAMS = static_cast<uint64_t> (Histogram::compressedLoadLatency) + 1; // number of histograms
+        static constexpr uint64_t BUCKETS = 40; // bucket i of a histogram counts durations in [2^(i-1), 2^i) ns
+
+        std::array<uint64_t, COUNTERS> counters; // the value of each counter
+        std::array<std::array<uint64_t, BUCKETS>, HISTOGRAMS> histograms; // the buckets of each histogram
+        std::array<uint64_t, HISTOGRAMS> durations; // the sum of all durations of each histogram in ns
+        uint64_t frames; // number of frames
+        uint64_t dirtyFrames; // number of frames holding a dirty page
+        uint64_t compressedPages; // number of pages in the compressed tier
+        uint64_t compressedBytes; // size of the pages in the compressed tier in bytes
+        std::map<uint64_t, uint64_t> residentPages; // map: segment id -> number of pages in memory
+
+        StatisticsSnapshot();
+
+        /**
+         * @param counter the counter
+         * @return the value of the counter
+         */
+        uint64_t counter(Counter counter) const {
+            return counters[static_cast<uint64_t> (counter)];
+        }
+
+        /**
+         * @return the fraction of fixes that found the page in memory; 1, if there were no fixes
+         */
+        double hitRate() const;
+
+        /**
+         * @param histogram the histogram
+         * @return the number of recorded durations
+         */
+        uint64_t count(Histogram histogram) const;
+
+        /**
+         * @param histogram the histogram
+         * @return the mean duration in ns; 0, if there are none
+         */
+        uint64_t mean(Histogram histogram) const;
+
+        /**
+         * @param histogram the histogram
+         * @param fraction the fraction of durations below the percentile, e.g. 0.99
+         * @return the upper bound of the bucket holding the percentile in ns; 0, if there are no durations
+         */
+        uint64_t percentile(Histogram histogram, double fraction) const;
+
+        /**
+         * Prints all statistics in a human readable form, one line each.
+         * @param out the stream to print to
+         */
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * Counters and histograms of the buffer manager, cheap enough to be updated on every fix.
+     * The values are sharded by thread, so threads don't contend on the same cache lines. A snapshot sums up all shards.
+     */
+    class Statistics {
+    public:
+        static constexpr uint64_t SHARDS = 64; // number of shards, threads beyond that share shards
+
+        Statistics();
+
+        Statistics(const Statistics& orig) = delete;
+        Statistics& operator=(const Statistics& orig) = delete;
+
+        /**
+         * Adds to a counter.
+         * This method is thread-safe.
+         * @param counter the counter
+         * @param value the value to add
+         */
+        void add(Counter counter, uint64_t value = 1) {
+            shard().counters[static_cast<uint64_t> (counter)].fetch_add(value, std::memory_order_relaxed);
+        }
+
+        /**
+         * Records a duration.
+         * This method is thread-safe.
+         * @param histogram the histogram
+         * @param start the start of the duration as returned by now()
+         */
+        void record(Histogram histogram, uint64_t start) {
+            uint64_t duration = now() - start;
+            Shard &threadShard = shard();
+            threadShard.histograms[static_cast<uint64_t> (histogram)][bucket(duration)].fetch_add(1, std::memory_order_relaxed);
+            threadShard.durations[static_cast<uint64_t> (histogram)].fetch_add(duration, std::memory_order_relaxed);
+        }
+
+        /**
+         * @return the current time in ns, to record a duration
+         */
+        static uint64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * Sums up the counters and histograms of all shards.
+         * This method is thread-safe.
+         * @param snapshot the snapshot to add the values to
+         */
+        void snapshot(StatisticsSnapshot& snapshot) const;
+
+    private:
+
+        /**
+         * The values of a group of threads, padded so no two shards share a cache line.
+         */
+        struct Shard {
+            std::array<std::atomic<uint64_t>, StatisticsSnapshot::COUNTERS> counters;
+            std::array<std::array<std::atomic<uint64_t>, StatisticsSnapshot::BUCKETS>, StatisticsSnapshot::HISTOGRAMS> histograms;
+            std::array<std::atomic<uint64_t>, StatisticsSnapshot::HISTOGRAMS> durations;
+            char padding[64];
+        };
+
+        std::unique_ptr<Shard[]> _shards; // the shards
+
+        /**
+         * @return the shard of the calling thread
+         */
+        Shard& shard() {
+            return _shards[threadShard()];
+        }
+
+        /**
+         * Assigns the threads round robin to the shards, when they first use any statistics.
+         * @return the shard index of the calling thread
+         */
+        static uint64_t threadShard();
+
+        /**
+         * @param duration a duration in ns
+         * @return the histogram bucket of the duration
+         */
+        static uint64_t bucket(uint64_t duration) {
+            uint64_t bits = (duration == 0) ? 0 : 64 - __builtin_clzl(duration);
+            return (bits < StatisticsSnapshot::BUCKETS) ? bits : StatisticsSnapshot::BUCKETS - 1;
+        }
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_STATISTICS_HPP */
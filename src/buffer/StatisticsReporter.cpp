@@ -0,0 +1,58 @@
+
+#include "StatisticsReporter.hpp"
+
+#include <cassert>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+namespace simpledb {
+
+    StatisticsReporter::StatisticsReporter(std::function<StatisticsSnapshot()> snapshot, uint64_t interval, std::string file) : _snapshot(snapshot), _interval(interval), _file(file), _mutex(), _condition(), _stop(false), _thread() {
+        assert(interval > 0);
+
+        _thread = boost::thread(&StatisticsReporter::run, this);
+    }
+
+    StatisticsReporter::~StatisticsReporter() {
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _stop = true;
+            _condition.notify_all();
+        }
+        _thread.join();
+    }
+
+    void StatisticsReporter::run() {
+        // dump after each interval, and a last time when stopped
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        bool stopped = false;
+        while (!stopped) {
+            if (!_stop) {
+                _condition.timed_wait(lock, boost::posix_time::milliseconds(_interval));
+            }
+            stopped = _stop;
+
+            lock.unlock();
+            dump();
+            lock.lock();
+        }
+    }
+
+    void StatisticsReporter::dump() {
+        StatisticsSnapshot snapshot = _snapshot();
+
+        // append to the file or print to stdout
+        std::ofstream file;
+        std::ostream *out = &std::cout;
+        if (!_file.empty()) {
+            file.open(_file, std::ios::app);
+            assert(file.good());
+            // TODO: error handling
+            out = &file;
+        }
+
+        *out << "--- statistics at " << std::time(nullptr) << std::endl;
+        snapshot.print(*out);
+    }
+}
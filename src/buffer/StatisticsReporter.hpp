@@ -0,0 +1,62 @@
+
+#ifndef SIMPLEDB_BUFFER_STATISTICSREPORTER_HPP
+#define	SIMPLEDB_BUFFER_STATISTICSREPORTER_HPP
+
+#include "Statistics.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace simpledb {
+
+    /**
+     * Thread that periodically dumps snapshots of the statistics, e.g. to watch the hit rate of a running workload.
+     */
+    class StatisticsReporter {
+    public:
+
+        /**
+         * Starts the reporter thread.
+         * @param snapshot takes the snapshots to dump
+         * @param interval time in ms between two dumps
+         * @param file the file to append the dumps to; empty, to print them to stdout
+         */
+        StatisticsReporter(std::function<StatisticsSnapshot()> snapshot, uint64_t interval, std::string file);
+
+        /**
+         * Stops the reporter thread, after it dumped a last snapshot.
+         */
+        ~StatisticsReporter();
+
+        StatisticsReporter(const StatisticsReporter& orig) = delete;
+        StatisticsReporter& operator=(const StatisticsReporter& orig) = delete;
+
+    private:
+        std::function<StatisticsSnapshot()> _snapshot; // takes the snapshots
+        uint64_t _interval; // time in ms between two dumps
+        std::string _file; // the file to append to; empty, for stdout
+
+        boost::mutex _mutex; // mutex for sleeping and stopping
+        boost::condition_variable _condition; // wakes up the reporter thread to stop
+        bool _stop; // true, if the reporter thread should terminate
+        boost::thread _thread; // the reporter thread
+
+        /**
+         * Main loop of the reporter thread.
+         */
+        void run();
+
+        /**
+         * Takes a snapshot and dumps it.
+         */
+        void dump();
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_STATISTICSREPORTER_HPP */
@@ -0,0 +1,124 @@
+
+#include "TwoQueueReplacementManager.hpp"
+
+namespace simpledb {
+
+    TwoQueueReplacementManager::TwoQueueReplacementManager(BufferFrame* frames, uint64_t size) : _fifoQueue(), _lruQueue(), _mutex() {
+        for (uint64_t i = 0; i < size; ++i) {
+            _fifoQueue.push_back(&frames[i]);
+            frames[i].setFifoQueue();
+            frames[i].setQueueNode(--_fifoQueue.end());
+        }
+    };
+
+    BufferFrame* TwoQueueReplacementManager::evictFrame() {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        // fixed frames in the fifo queue are in use -> move them to the lru queue
+        while (!_fifoQueue.empty()) {
+            BufferFrame *frame = _fifoQueue.front();
+            if (!frame->isFixed()) {
+                frame->setNoQueue();
+                _fifoQueue.pop_front();
+                // Remark: don't use queueNode() in the BufferFrame after this, it's invalid
+                return frame;
+            }
+
+            _lruQueue.splice(_lruQueue.end(), _fifoQueue, _fifoQueue.begin());
+            frame->setLruQueue();
+        }
+
+        // skip fixed frames in the lru queue
+        for (std::list<BufferFrame*>::iterator it = _lruQueue.begin(); it != _lruQueue.end(); ++it) {
+            BufferFrame *frame = *it;
+            if (!frame->isFixed()) {
+                frame->setNoQueue();
+                _lruQueue.erase(it);
+                return frame;
+            }
+        }
+
+        return nullptr; // all frames are fixed
+    }
+
+    void TwoQueueReplacementManager::nextVictims(std::vector<BufferFrame*>& victims, uint64_t count) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        for (std::list<BufferFrame*>* queue : {&_fifoQueue, &_lruQueue}) {
+            for (BufferFrame *frame : *queue) {
+                if (count == 0) {
+                    return;
+                }
+                if (!frame->isFixed()) {
+                    victims.push_back(frame);
+                    --count;
+                }
+            }
+        }
+    }
+
+    void TwoQueueReplacementManager::newFrame(BufferFrame* frame) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        assert(!frame->isInFifoQueue() && !frame->isInLruQueue());
+        _fifoQueue.push_back(frame);
+        frame->setFifoQueue();
+        frame->setQueueNode(--_fifoQueue.end());
+    }
+
+    void TwoQueueReplacementManager::coldFrame(BufferFrame* frame) {
+        newFrame(frame);
+    }
+
+    bool TwoQueueReplacementManager::takeColdFrame(BufferFrame* frame) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        if (!frame->isInFifoQueue()) {
+            return false;
+        }
+        assert(isFrameInQueue(frame, _fifoQueue));
+        _fifoQueue.erase(frame->queueNode());
+        frame->setNoQueue();
+        return true;
+    }
+
+    void TwoQueueReplacementManager::keepFrame(BufferFrame* frame) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        assert(!frame->isInFifoQueue() && !frame->isInLruQueue());
+        _lruQueue.push_back(frame);
+        frame->setLruQueue();
+        frame->setQueueNode(--_lruQueue.end());
+    }
+
+    void TwoQueueReplacementManager::freeFrame(BufferFrame* frame) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        assert(!frame->isInFifoQueue() && !frame->isInLruQueue());
+        _fifoQueue.push_front(frame);
+        frame->setFifoQueue();
+        frame->setQueueNode(_fifoQueue.begin());
+    }
+
+    void TwoQueueReplacementManager::reprioritizeFrame(BufferFrame* frame) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+
+        if (frame->isInFifoQueue()) {
+            assert(isFrameInQueue(frame, _fifoQueue));
+            _lruQueue.splice(_lruQueue.end(), _fifoQueue, frame->queueNode());
+            frame->setLruQueue();
+        } else if (frame->isInLruQueue()) {
+            assert(isFrameInQueue(frame, _lruQueue));
+            _lruQueue.splice(_lruQueue.end(), _lruQueue, frame->queueNode());
+        } // else: not in any queue
+    }
+
+    bool TwoQueueReplacementManager::isFrameInQueue(BufferFrame* frame, std::list<BufferFrame*>& queue) {
+        for (BufferFrame *i : queue) {
+            if (frame == i) {
+                return true;
+            }
+        }
+        return false;
+    };
+}
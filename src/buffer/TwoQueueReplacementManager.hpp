@@ -0,0 +1,117 @@
+
+#ifndef SIMPLEDB_BUFFER_TWOQUEUEREPLACEMENTMANAGER_HPP
+#define	SIMPLEDB_BUFFER_TWOQUEUEREPLACEMENTMANAGER_HPP
+
+#include "BufferFrame.hpp"
+#include "BufferReplacementManager.hpp"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/lock_types.hpp>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace simpledb {
+
+    /**
+     * Implements the buffer frame replacement strategy: 2Q
+     * All operations are synchronized internally.
+     */
+    class TwoQueueReplacementManager : public BufferReplacementManager {
+    public:
+
+        /**
+         * Creates a new 2Q replacement manager.
+         * Initially all frames are free and in the fifo queue.
+         * @param frames the frames of the buffer manager
+         * @param size number of frames
+         */
+        TwoQueueReplacementManager(BufferFrame* frames, uint64_t size);
+
+        virtual ~TwoQueueReplacementManager() {
+        };
+
+        TwoQueueReplacementManager(const TwoQueueReplacementManager& orig) = delete;
+        TwoQueueReplacementManager& operator=(const TwoQueueReplacementManager& orig) = delete;
+
+        /**
+         * Evicts the next frame that isn't fixed.
+         * Fixed frames are skipped, fixed frames in the fifo queue are moved to the lru queue as they are in use.
+         * Deletes the frame from a queue and sets the queueState of the frame accordingly.
+         * This method is thread-safe.
+         * @return the frame; or nullptr, if all frames are fixed or evicted by other threads
+         */
+        virtual BufferFrame* evictFrame();
+
+        /**
+         * Collects the frames at the front of the fifo queue and then the lru queue.
+         * This method is thread-safe.
+         * @param victims the vector to append the frames to
+         * @param count the maximum number of frames to collect
+         */
+        virtual void nextVictims(std::vector<BufferFrame*>& victims, uint64_t count);
+
+        /**
+         * Inserts a new frame in the fifo queue.
+         * This method is thread-safe.
+         * @param frame the new frame
+         */
+        virtual void newFrame(BufferFrame* frame);
+
+        /**
+         * Inserts a cold frame in the fifo queue like a new frame, pages in the fifo queue are evicted before those used again.
+         * This method is thread-safe.
+         * @param frame the cold frame
+         */
+        virtual void coldFrame(BufferFrame* frame);
+
+        /**
+         * Removes a cold frame from the fifo queue. A frame that was used since is in the lru queue, one selected by evictFrame is in no queue.
+         * This method is thread-safe.
+         * @param frame the cold frame
+         * @return true, if the frame was taken; false, if it was used or evicted
+         */
+        virtual bool takeColdFrame(BufferFrame* frame);
+
+        /**
+         * Reinserts an evicted frame that is in use (e.g. fixed after eviction) at the back of the lru queue.
+         * This method is thread-safe.
+         * @param frame the frame in use
+         */
+        virtual void keepFrame(BufferFrame* frame);
+
+        /**
+         * Inserts a free frame at the front of the fifo queue, so it is evicted next.
+         * This method is thread-safe.
+         * @param frame the free frame
+         */
+        virtual void freeFrame(BufferFrame* frame);
+
+        /**
+         * Reprioritizes a frame.
+         * The frame is moved to the back of the lru queue.
+         * This method is thread-safe.
+         * @param frame the frame to reprioritize
+         */
+        virtual void reprioritizeFrame(BufferFrame* frame);
+
+    private:
+        std::list<BufferFrame*> _fifoQueue; // the fifo queue
+        std::list<BufferFrame*> _lruQueue; // the lru queue
+
+        boost::mutex _mutex; // mutex for concurrent access
+
+        /**
+         * Checks if a frame is in the specified queue
+         * @param frame the frame to search for
+         * @param queue the check to use
+         * @return true, if the frame can be found in the queue; false, else
+         */
+        bool isFrameInQueue(BufferFrame* frame, std::list<BufferFrame*>& queue);
+    };
+}
+
+#endif	/* SIMPLEDB_BUFFER_TWOQUEUEREPLACEMENTMANAGER_HPP */
+
@@ -2,7 +2,9 @@
 #ifndef SIMPLEDB_DATA_HPP
 #define SIMPLEDB_DATA_HPP
 
+#include "data/RecordView.hpp"
 #include "data/SPSegment.hpp"
+#include "data/SPVacuum.hpp"
 #include "data/TID.hpp"
 
 #endif  /* SIMPLEDB_DATA_HPP */
@@ -0,0 +1,17 @@
+
+#include "FSIPage.hpp"
+
+namespace simpledb {
+
+    constexpr uint64_t FSIPage::CLASSES;
+    constexpr uint64_t FSIPage::SEGMENT_VERSION;
+
+    int64_t FSIPage::find(uint8_t neededClass, uint64_t first, uint64_t count) const {
+        const uint8_t* begin = classes() + first;
+        const uint8_t* end = begin + count;
+        const uint8_t* found = std::find_if(begin, end, [neededClass](uint8_t spaceClass) {
+            return (spaceClass >= neededClass);
+        });
+        return (found == end ? -1 : found - classes());
+    }
+}
@@ -0,0 +1,126 @@
+
+#ifndef SIMPLEDB_DATA_FSIPAGE_HPP
+#define	SIMPLEDB_DATA_FSIPAGE_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace simpledb {
+
+    /**
+     * Free space inventory page of a slotted pages segment.
+     * It stores one byte per data page, the free space class of the page. The first page of the segment and
+     * every (entries + 1)-th page after it is an inventory page, it covers the data pages following it.
+     * The class of a page is the largest record that can be inserted on it in 1/256 of the page size, rounded down,
+     * so a page of a class found for a record always has enough space.
+     * Segments created before the inventory existed (an older segment version) have no inventory pages.
+     */
+    class FSIPage {
+    public:
+        static constexpr uint64_t CLASSES = 256; // number of free space classes
+        static constexpr uint64_t SEGMENT_VERSION = 1; // first segment version with inventory pages
+
+        FSIPage() = delete;
+        ~FSIPage() = delete;
+
+        FSIPage(const FSIPage& orig) = delete;
+        FSIPage& operator=(const FSIPage& orig) = delete;
+
+        /**
+         * @param pageSize the size of the page
+         * @return the number of data pages covered by an inventory page
+         */
+        static uint64_t entries(uint64_t pageSize) {
+            return pageSize;
+        }
+
+        /**
+         * @param pageId the page id
+         * @param pageSize the size of the pages
+         * @return true, if the page is an inventory page; false, if it's a data page
+         */
+        static bool isFSIPage(uint64_t pageId, uint64_t pageSize) {
+            return (pageId % (entries(pageSize) + 1) == 0);
+        }
+
+        /**
+         * @param pageId the page id of a data page
+         * @param pageSize the size of the pages
+         * @return the page id of the inventory page covering the data page
+         */
+        static uint64_t fsiPage(uint64_t pageId, uint64_t pageSize) {
+            return (pageId - pageId % (entries(pageSize) + 1));
+        }
+
+        /**
+         * @param pageId the page id of a data page
+         * @param pageSize the size of the pages
+         * @return the entry of the data page on its inventory page
+         */
+        static uint64_t entry(uint64_t pageId, uint64_t pageSize) {
+            assert(!isFSIPage(pageId, pageSize));
+            return (pageId % (entries(pageSize) + 1) - 1);
+        }
+
+        /**
+         * @param freeSpace the length of the largest record that can be inserted on a page
+         * @param pageSize the size of the page
+         * @return the free space class of the page
+         */
+        static uint8_t spaceClass(uint64_t freeSpace, uint64_t pageSize) {
+            return static_cast<uint8_t> (std::min(freeSpace * CLASSES / pageSize, CLASSES - 1));
+        }
+
+        /**
+         * @param size the length of a record
+         * @param pageSize the size of the page
+         * @return the lowest free space class of pages that have enough space for the record, at least 1
+         */
+        static uint8_t neededClass(uint64_t size, uint64_t pageSize) {
+            return static_cast<uint8_t> (std::max<uint64_t>(std::min((size * CLASSES + pageSize - 1) / pageSize, CLASSES - 1), 1));
+        }
+
+        /**
+         * Initializes the page, all data pages are full.
+         * @param pageSize the size of the page
+         */
+        void init(uint64_t pageSize) {
+            memset(this, 0, entries(pageSize));
+        }
+
+        /**
+         * @param entry the entry of a data page
+         * @return the free space class of the data page
+         */
+        uint8_t get(uint64_t entry) const {
+            return classes()[entry];
+        }
+
+        /**
+         * @param entry the entry of a data page
+         * @param spaceClass the free space class of the data page
+         */
+        void set(uint64_t entry, uint8_t spaceClass) {
+            const_cast<uint8_t*> (classes())[entry] = spaceClass;
+        }
+
+        /**
+         * Searches for the first data page of at least the supplied class.
+         * @param neededClass the needed free space class
+         * @param first the entry to start with
+         * @param count the number of entries to search
+         * @return the entry of the data page; or -1, if no page has enough space
+         */
+        int64_t find(uint8_t neededClass, uint64_t first, uint64_t count) const;
+
+    private:
+        const uint8_t* classes() const {
+            return reinterpret_cast<const uint8_t*> (this);
+        }
+    };
+}
+
+#endif	/* SIMPLEDB_DATA_FSIPAGE_HPP */
+
@@ -15,4 +15,11 @@ namespace simpledb {
     Record::Record(Record&& orig) : _length(orig._length), _data(std::forward<Record>(orig)._data) {
         orig._length = 0;
     }
+
+    Record& Record::operator=(Record&& orig) {
+        _length = orig._length;
+        _data = std::move(orig._data);
+        orig._length = 0;
+        return *this;
+    }
 }
\ No newline at end of file
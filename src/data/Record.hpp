@@ -32,6 +32,13 @@ namespace simpledb {
          */
         Record(Record&& orig);
 
+        /**
+         * Move assigns a record from another record.
+         * @param orig the original record
+         * @return this record
+         */
+        Record& operator=(Record&& orig);
+
         ~Record() = default;
 
         Record(const Record& orig) = delete;
@@ -51,6 +58,13 @@ namespace simpledb {
             return _data.get();
         }
 
+        /**
+         * @return a pointer the data of the record, e.g. to read it from disk
+         */
+        char* getData() {
+            return _data.get();
+        }
+
 
     private:
         uint64_t _length; // the length of the data
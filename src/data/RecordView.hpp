@@ -0,0 +1,58 @@
+
+#ifndef SIMPLEDB_DATA_RECORDVIEW_HPP
+#define SIMPLEDB_DATA_RECORDVIEW_HPP
+
+#include "Record.hpp"
+
+#include <cstdint>
+
+namespace simpledb {
+
+    /**
+     * Read-only view of the data of a record that is owned by someone else, e.g. a fixed page or a record.
+     * The view doesn't copy the data, so it's only valid as long as the owner keeps it in place.
+     */
+    class RecordView {
+    public:
+        /**
+         * Constructs an empty view.
+         */
+        RecordView() : _length(0), _data(nullptr) {
+        }
+
+        /**
+         * Constructs a view of data.
+         * @param length the length of the data in bytes
+         * @param data a pointer to the data
+         */
+        RecordView(uint64_t length, const char* data) : _length(length), _data(data) {
+        }
+
+        /**
+         * Constructs a view of the data of a record.
+         * @param record the record, it must outlive the view
+         */
+        RecordView(const Record& record) : _length(record.length()), _data(record.getData()) {
+        }
+
+        /**
+         * @return the length of the record in bytes
+         */
+        uint64_t length() const {
+            return _length;
+        }
+
+        /**
+         * @return a pointer to the data of the record
+         */
+        const char* getData() const {
+            return _data;
+        }
+
+    private:
+        uint64_t _length; // the length of the data
+        const char* _data; // pointer to the data, it's not owned by the view
+    };
+}
+
+#endif	/* SIMPLEDB_DATA_RECORDVIEW_HPP */
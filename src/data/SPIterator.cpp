@@ -3,20 +3,25 @@
 
 namespace simpledb {
 
-    SPIterator::SPIterator(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager) : _segmentId(segmentId), _segmentSize(segmentManager->retrieve(segmentId)->size()), _page(0), _slot(-1), _bufferManager(bufferManager), _bufferFrame() {
+    constexpr uint64_t SPIterator::MAPPED_READ_AHEAD;
+
+    SPIterator::SPIterator(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager, const MappedFile* mapping) : _segmentId(segmentId), _segmentSize(segmentManager->retrieve(segmentId)->size()), _pageSize(segmentManager->retrieve(segmentId)->pageSize()), _inventory(segmentManager->retrieve(segmentId)->version() >= FSIPage::SEGMENT_VERSION), _page(0), _slot(-1), _segmentManager(segmentManager), _bufferManager(bufferManager), _bufferFrame(), _readAhead(bufferManager.get(), _segmentSize), _ring(), _mapping(mapping), _buffer() {
+        if (_inventory) {
+            _page = 1; // the first page is a free space inventory page
+        }
         if (!isValid()) {
             return;
         }
-        _bufferFrame = _bufferManager->fixPage(_segmentId, _page, false);
+        fixPage();
         operator++();
     }
     
-    SPIterator::SPIterator(): _segmentId(0), _segmentSize(0), _page(0), _slot(-1), _bufferManager(), _bufferFrame() {
+    SPIterator::SPIterator(): _segmentId(0), _segmentSize(0), _pageSize(0), _inventory(false), _page(0), _slot(-1), _segmentManager(), _bufferManager(), _bufferFrame(), _readAhead(), _ring(0), _mapping(nullptr), _buffer() {
         assert(!isValid());
     }
 
     SPIterator::~SPIterator() {
-        if (isValid()) {
+        if (_bufferFrame.isValid()) {
             _bufferManager->unfixPage(_bufferFrame, false);
         }
     }
@@ -30,12 +35,41 @@ namespace simpledb {
 
         assert(_slot > -1);
         assert(_slot < static_cast<int64_t> (page()->firstFreeSlot()));
-        SPSlot *slot = page()->getSlot(_slot);
-        assert(!slot->isFree() && slot->isOnPage());
+        SPSlot slot = page()->getSlot(_slot);
+        assert(!slot.isFree() && slot.isOnPage());
+
+        // large record? -> read it from its extent
+        if (slot.isExtent()) {
+            Extent extent;
+            memcpy(&extent, page()->getItem(slot), sizeof (Extent));
+            Record record(extent.length, nullptr);
+            _segmentManager->readExtent(_segmentId, extent, record.getData());
+            return record;
+        }
 
         return Record(page()->getLength(slot), page()->getItem(slot));
     }
 
+    RecordView SPIterator::view() {
+        assert(isValid());
+
+        assert(_slot > -1);
+        assert(_slot < static_cast<int64_t> (page()->firstFreeSlot()));
+        SPSlot slot = page()->getSlot(_slot);
+        assert(!slot.isFree() && slot.isOnPage());
+
+        // large record? -> read it from its extent into the buffer
+        if (slot.isExtent()) {
+            Extent extent;
+            memcpy(&extent, page()->getItem(slot), sizeof (Extent));
+            _buffer = Record(extent.length, nullptr);
+            _segmentManager->readExtent(_segmentId, extent, _buffer.getData());
+            return RecordView(_buffer);
+        }
+
+        return RecordView(page()->getLength(slot), page()->getItem(slot));
+    }
+
     SPIterator& SPIterator::operator++() {
         if (!isValid()) {
             return *this;
@@ -43,36 +77,53 @@ namespace simpledb {
 
         while (true) {
             // invariants:
-            assert(_bufferFrame.get() != nullptr);
+            assert(_mapping || _bufferFrame.isValid());
             assert(isValid());
             assert(_slot < static_cast<int64_t> (page()->firstFreeSlot()));
 
             // next slot on page?
             if (_slot + 1 < static_cast<int64_t> (page()->firstFreeSlot())) {
                 ++_slot;
-                SPSlot *slot = page()->getSlot(_slot);
-                if (slot->isFree() || !slot->isOnPage()) {
+                SPSlot slot = page()->getSlot(_slot);
+                if (slot.isFree() || !slot.isOnPage()) {
                     continue; // skip free or redirected slots
                 } else {
                     break; // next element found
                 }
             } else { // no more slots on current page
                 // unfix old page
-                _bufferManager->unfixPage(_bufferFrame, false);
-                _bufferFrame.reset();
+                if (!_mapping) {
+                    _bufferManager->unfixPage(_bufferFrame, false);
+                }
 
-                // go to next page
+                // go to next page, free space inventory pages don't hold records
                 ++_page;
+                if (_inventory && FSIPage::isFSIPage(_page, _pageSize)) {
+                    ++_page;
+                }
                 _slot = -1;
                 if (!isValid()) {
                     break; // no more elements
                 }
 
                 // fix new page
-                _bufferFrame = _bufferManager->fixPage(_segmentId, _page, false);
+                fixPage();
             }
         }
 
         return *this;
     }
+
+    void SPIterator::fixPage() {
+        // mapped pages aren't fixed, but the kernel doesn't detect the scan of a mapping with random access
+        if (_mapping) {
+            if (_page == 1 || _page % MAPPED_READ_AHEAD == 0) {
+                _mapping->willNeed(_page * _pageSize, MAPPED_READ_AHEAD * _pageSize);
+            }
+            return;
+        }
+
+        _readAhead.access(PageId(_segmentId, _page));
+        _bufferFrame = _bufferManager->fixPage(_segmentId, _page, false, AccessPattern::sequential, &_ring);
+    }
 }
@@ -2,11 +2,14 @@
 #ifndef SIMPLEDB_DATA_SPITERATOR_HPP
 #define SIMPLEDB_DATA_SPITERATOR_HPP
 
+#include "FSIPage.hpp"
 #include "Record.hpp"
+#include "RecordView.hpp"
 #include "SPPage.hpp"
 #include "SPSlot.hpp"
 
 #include "buffer.hpp"
+#include "file.hpp"
 #include "segment.hpp"
 
 #include <cassert>
@@ -18,7 +21,7 @@ namespace simpledb {
     class SPIterator {
     public:
         SPIterator();
-        SPIterator(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager);
+        SPIterator(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager, const MappedFile* mapping = nullptr);
         ~SPIterator();
 
         SPIterator(const SPIterator& orig) = delete;
@@ -26,20 +29,44 @@ namespace simpledb {
 
         bool isValid() const;
         Record operator*() const;
+
+        /**
+         * Returns the current record without copying it, the view borrows the record from the fixed page.
+         * The view is valid until the iterator is advanced or destructed, a large record is read into a buffer of the iterator.
+         * @return the view of the current record
+         */
+        RecordView view();
         SPIterator& operator++();
 
     private:
+        static constexpr uint64_t MAPPED_READ_AHEAD = 64; // number of pages of a mapped segment requested from the kernel at once
+
         uint64_t _segmentId;
         uint64_t _segmentSize;
+        uint64_t _pageSize;
+        bool _inventory; // true, if the segment has free space inventory pages, they are skipped
         uint64_t _page;
         int64_t _slot;
 
+        std::shared_ptr<SegmentManager> _segmentManager;
         std::shared_ptr<BufferManager> _bufferManager;
-        std::shared_ptr<BufferFrame> _bufferFrame;
+        PageGuard _bufferFrame;
+        ReadAhead _readAhead;
+        BufferRing _ring;
+        const MappedFile* _mapping; // the mapping of a read-only segment; nullptr, if the pages are fixed
+        Record _buffer; // the current large record read by view
 
         SPPage* page() const {
+            if (_mapping) { // the page is only read
+                return reinterpret_cast<SPPage*> (const_cast<char*> (_mapping->page(_page, _pageSize)));
+            }
             return reinterpret_cast<SPPage*> (_bufferFrame->getData());
         }
+
+        /**
+         * Fixes the current page, or asks the kernel to read ahead in mapped mode.
+         */
+        void fixPage();
     };
 }
 
@@ -3,131 +3,325 @@
 
 namespace simpledb {
 
+    constexpr uint64_t SPPage::COMPACT_MAX_PAGE_SIZE;
     constexpr uint64_t SPPage::MINIMAL_RECORD_LENGTH;
+    constexpr uint8_t SPPage::COMPACT_FORMAT;
 
-    void SPPage::init(uint64_t pageSize) {
-        _slotCount = 0;
-        _firstFreeSlot = 0;
-        _dataStart = pageSize;
-        _freeSpace = pageSize - sizeof (SPPage);
+    void SPPage::init(uint64_t pageSize, bool compact) {
+        static_assert(sizeof (WideHeader) == 4 * sizeof (uint64_t), "the wide format must stay readable");
+        static_assert(offsetof(CompactHeader, format) == sizeof (uint64_t) - 1, "the format version must overlap the most significant byte of the wide slot count");
+        assert(!compact || compactFormat(pageSize));
+
+        if (compact) {
+            memset(compactHeader(), 0, sizeof (CompactHeader));
+            compactHeader()->format = COMPACT_FORMAT;
+        }
+        setSlotCount(compact, 0);
+        setFirstFreeSlot(compact, 0);
+        setDataStart(compact, pageSize);
+        setFreeSpace(compact, pageSize - headerSize(compact));
     }
 
-    bool SPPage::hasFreeSpace(uint64_t size) {
-        if (_freeSpace < std::max(size, MINIMAL_RECORD_LENGTH) + sizeof (SPSlot)) {
+    bool SPPage::upgrade(uint64_t pageSize) {
+        if (isCompact() || !compactFormat(pageSize)) {
             return false;
         }
-        if (_dataStart - sizeof (SPPage) - _firstFreeSlot * sizeof (SPSlot) < std::max(size, MINIMAL_RECORD_LENGTH) + sizeof (SPSlot)) {
-            return false;
+
+        // rebuild the page from a copy, the items are packed at the end of the page like in compact
+        std::vector<char> copy(reinterpret_cast<char *> (this), reinterpret_cast<char *> (this) + pageSize);
+        SPPage *wide = reinterpret_cast<SPPage *> (copy.data());
+        uint64_t firstFreeSlot = wide->firstFreeSlot(false);
+
+        init(pageSize, true);
+        setSlotCount(true, wide->slotCount(false));
+        setFirstFreeSlot(true, firstFreeSlot);
+        memset(reinterpret_cast<char*> (this) + headerSize(true), 0, firstFreeSlot * SPSlot::size(true));
+        uint64_t dataStart = pageSize;
+        uint64_t freeSpace = pageSize - headerSize(true) - wide->slotCount(false) * SPSlot::size(true);
+        for (SlotId slotId = 0; slotId < firstFreeSlot; ++slotId) {
+            SPSlot wideSlot = wide->slot(slotId, false);
+            SPSlot compactSlot = slot(slotId, true);
+            compactSlot.setOnPage(wideSlot.isOnPage());
+            compactSlot.setRedirected(wideSlot.isRedirected());
+            compactSlot.setExtent(wideSlot.isExtent());
+            if (wideSlot.isFree()) {
+                continue;
+            }
+
+            uint64_t prefix = wideSlot.isRedirected() ? sizeof (TID) : 0; // original TID of a redirected record
+            uint64_t size = prefix + std::max(wideSlot.length(), MINIMAL_RECORD_LENGTH);
+            dataStart -= size;
+            freeSpace -= size;
+            memcpy(reinterpret_cast<char*> (this) + dataStart, copy.data() + wideSlot.offset() - prefix, size);
+            compactSlot.setOffset(dataStart + prefix);
+            compactSlot.setLength(wideSlot.length());
         }
+        setDataStart(true, dataStart);
+        setFreeSpace(true, freeSpace);
+
         return true;
     }
 
+    bool SPPage::hasFreeSpace(uint64_t size) {
+        return (std::max(size, MINIMAL_RECORD_LENGTH) <= insertSpace());
+    }
+
+    uint64_t SPPage::insertSpace() const {
+        // free slots are reused, the data space is contiguous after a compaction
+        bool compact = isCompact();
+        uint64_t freeSlots = firstFreeSlot(compact) - slotCount(compact);
+        uint64_t space = freeSpace(compact) - freeSlots * SPSlot::size(compact);
+        uint64_t slotSpace = freeSlots > 0 ? 0 : SPSlot::size(compact);
+        return (space < MINIMAL_RECORD_LENGTH + slotSpace ? 0 : space - slotSpace);
+    }
+
     bool SPPage::hasUpdateSpace(uint64_t size) {
-        if (_dataStart - sizeof (SPPage) - _firstFreeSlot * sizeof (SPSlot) < std::max(size, MINIMAL_RECORD_LENGTH)) {
-            return false;
+        bool compact = isCompact();
+        return (std::max(size, MINIMAL_RECORD_LENGTH) <= freeSpace(compact) - (firstFreeSlot(compact) - slotCount(compact)) * SPSlot::size(compact));
+    }
+
+    std::tuple<uint64_t, SPSlot> SPPage::nextSlot() {
+        bool compact = isCompact();
+
+        // reuse the first free slot, or append one
+        uint64_t slotId = 0;
+        if (slotCount(compact) < firstFreeSlot(compact)) {
+            while (!slot(slotId, compact).isFree()) {
+                ++slotId;
+            }
+        } else {
+            slotId = firstFreeSlot(compact);
+            setFirstFreeSlot(compact, slotId + 1);
         }
-        return true;
+
+        setSlotCount(compact, slotCount(compact) + 1);
+        setFreeSpace(compact, freeSpace(compact) - SPSlot::size(compact));
+
+        return std::make_tuple(slotId, slot(slotId, compact));
     }
 
-    std::tuple<uint64_t, SPSlot*> SPPage::nextSlot() {
-        uint64_t slotId = _firstFreeSlot;
+    void SPPage::compact(uint64_t pageSize) {
+        // move the items to the end of the page, the one with the highest offset first, so none is overwritten before it's moved
+        bool compact = isCompact();
+        std::vector<SPSlot> slots;
+        for (SlotId slotId = 0; slotId < firstFreeSlot(compact); ++slotId) {
+            if (!slot(slotId, compact).isFree()) {
+                slots.push_back(slot(slotId, compact));
+            }
+        }
+        std::sort(slots.begin(), slots.end(), [](const SPSlot& a, const SPSlot& b) {
+            return (a.offset() > b.offset());
+        });
+
+        uint64_t dataStart = pageSize;
+        for (SPSlot& slot : slots) {
+            uint64_t prefix = slot.isRedirected() ? sizeof (TID) : 0; // original TID of a redirected record
+            uint64_t size = prefix + std::max(getLength(slot), MINIMAL_RECORD_LENGTH);
+            dataStart -= size;
+            memmove(reinterpret_cast<char*> (this) + dataStart, reinterpret_cast<char*> (this) + slot.offset() - prefix, size);
+            slot.setOffset(dataStart + prefix);
+        }
+        setDataStart(compact, dataStart);
+    }
 
-        ++_firstFreeSlot;
-        ++_slotCount;
-        _freeSpace -= sizeof (SPSlot);
+    bool SPPage::needsVacuum(uint64_t pageSize) const {
+        // the fields might be modified concurrently, so they are read once and bounds checked
+        bool compact = isCompact();
+        if (!compact && compactFormat(pageSize)) {
+            return true; // upgrade to the compact format
+        }
+        uint64_t slotCount = this->slotCount(compact);
+        uint64_t firstFreeSlot = this->firstFreeSlot(compact);
+        uint64_t dataStart = this->dataStart(compact);
+        uint64_t freeSpace = this->freeSpace(compact);
+        uint64_t header = headerSize(compact);
+        uint64_t slotSize = SPSlot::size(compact);
+        if (slotCount > firstFreeSlot || header + firstFreeSlot * slotSize > std::min(dataStart, pageSize)) {
+            return false; // inconsistent
+        }
 
-        SPSlot *slot = getSlot(slotId);
+        // holes in the data space?
+        if (freeSpace - (firstFreeSlot - slotCount) * slotSize > dataStart - header - firstFreeSlot * slotSize) {
+            return true;
+        }
 
-        return std::make_tuple(slotId, slot);
+        // redirected records?
+        for (uint64_t slotId = 0; slotId < firstFreeSlot; ++slotId) {
+            SPSlot slot = this->slot(slotId, compact);
+            if (!slot.isFree() && !slot.isOnPage()) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    SlotId SPPage::insert(const Record& record, bool redirected, TID originalTid) {
+    SlotId SPPage::insert(const Record& record, uint64_t pageSize, bool redirected, TID originalTid) {
         assert(hasFreeSpace(std::max(record.length(), MINIMAL_RECORD_LENGTH) + (redirected ? sizeof (TID) : 0)));
 
+        // enough free space, but not in one piece? -> compact the page first
+        bool compact = isCompact();
+        uint64_t space = std::max(record.length(), MINIMAL_RECORD_LENGTH) + (redirected ? sizeof (TID) : 0);
+        if (contiguousSpace(compact) < space + (slotCount(compact) < firstFreeSlot(compact) ? 0 : SPSlot::size(compact))) {
+            this->compact(pageSize);
+        }
+
         SlotId slotId;
-        SPSlot *slot;
+        SPSlot slot(nullptr, compact);
         std::tie(slotId, slot) = nextSlot();
 
         uint64_t length = record.length();
-        uint64_t offset = _dataStart - std::max(length, MINIMAL_RECORD_LENGTH);
-        slot->setLength(length);
-        slot->setOffset(offset);
-        slot->setOnPage(true);
-        slot->setRedirected(redirected);
+        uint64_t offset = dataStart(compact) - std::max(length, MINIMAL_RECORD_LENGTH);
+        slot.setLength(length);
+        slot.setOffset(offset);
+        slot.setOnPage(true);
+        slot.setRedirected(redirected);
+        slot.setExtent(false);
 
         if (record.getData()) {
             memcpy(reinterpret_cast<char*> (this) + offset, record.getData(), length);
         }
-        _dataStart -= std::max(length, MINIMAL_RECORD_LENGTH);
-        _freeSpace -= std::max(length, MINIMAL_RECORD_LENGTH);
+        setDataStart(compact, offset);
+        setFreeSpace(compact, freeSpace(compact) - std::max(length, MINIMAL_RECORD_LENGTH));
 
         if (redirected) {
             memcpy(reinterpret_cast<char*> (this) + offset - sizeof (TID), &originalTid, sizeof (TID));
-            _dataStart -= sizeof (TID);
-            _freeSpace -= sizeof (TID);
+            setDataStart(compact, offset - sizeof (TID));
+            setFreeSpace(compact, freeSpace(compact) - sizeof (TID));
         }
 
         return slotId;
     }
 
     void SPPage::remove(SlotId slotId) {
-        SPSlot* slot = getSlot(slotId);
+        bool compact = isCompact();
+        SPSlot slot = getSlot(slotId);
 
-        --_slotCount;
-        _freeSpace += sizeof (SPSlot);
-        _freeSpace += std::max(getLength(slot), MINIMAL_RECORD_LENGTH);
-        if (slot->isRedirected()) {
-            _freeSpace += sizeof (TID);
+        uint64_t freeSpace = this->freeSpace(compact) + SPSlot::size(compact) + std::max(getLength(slot), MINIMAL_RECORD_LENGTH);
+        if (slot.isRedirected()) {
+            freeSpace += sizeof (TID);
         }
+        setSlotCount(compact, slotCount(compact) - 1);
+        setFreeSpace(compact, freeSpace);
 
-        slot->setOffset(0);
-        slot->setLength(0);
+        slot.setOffset(0);
+        slot.setLength(0);
+
+        // free slots at the end are given back to the data space
+        uint64_t firstFreeSlot = this->firstFreeSlot(compact);
+        while (firstFreeSlot > 0 && this->slot(firstFreeSlot - 1, compact).isFree()) {
+            --firstFreeSlot;
+        }
+        setFirstFreeSlot(compact, firstFreeSlot);
     }
 
     void SPPage::updateInPlace(SlotId slotId, const Record& record) {
-        SPSlot *slot = getSlot(slotId);
-        assert(slot->isOnPage());
+        bool compact = isCompact();
+        SPSlot slot = getSlot(slotId);
+        assert(slot.isOnPage());
 
         uint64_t oldLength = getLength(slot);
         uint64_t newLength = record.length();
         assert(std::max(newLength, MINIMAL_RECORD_LENGTH) <= oldLength);
-        uint64_t oldOffset = slot->offset();
+        uint64_t oldOffset = slot.offset();
         uint64_t newOffset = oldOffset + (oldLength - std::max(newLength, MINIMAL_RECORD_LENGTH));
 
-        slot->setOffset(newOffset);
-        slot->setLength(newLength);
+        slot.setOffset(newOffset);
+        slot.setLength(newLength);
 
         if (record.getData()) {
             memcpy(reinterpret_cast<char*> (this) + newOffset, record.getData(), newLength);
         }
-        _freeSpace += oldLength - std::max(newLength, MINIMAL_RECORD_LENGTH);
+        setFreeSpace(compact, freeSpace(compact) + oldLength - std::max(newLength, MINIMAL_RECORD_LENGTH));
 
-        if (slot->isRedirected()) {
+        if (slot.isRedirected()) {
             memmove(reinterpret_cast<char*> (this) + newOffset - sizeof (TID), reinterpret_cast<char*> (this) + oldOffset - sizeof (TID), sizeof (TID));
         }
     }
 
-    void SPPage::updateOnPage(SlotId slotId, const Record& record) {
-        SPSlot *slot = getSlot(slotId);
-        assert(slot->isOnPage());
+    void SPPage::updateOnPage(SlotId slotId, const Record& record, uint64_t pageSize) {
+        bool compact = isCompact();
+        SPSlot slot = getSlot(slotId);
+        assert(slot.isOnPage());
 
-        _freeSpace += std::max(getLength(slot), MINIMAL_RECORD_LENGTH);
+        TID originalTid(PageId(0, 0), 0);
+        if (slot.isRedirected()) {
+            originalTid = getOriginalTID(slot);
+        }
 
-        uint64_t oldOffset = slot->offset();
+        setFreeSpace(compact, freeSpace(compact) + std::max(getLength(slot), MINIMAL_RECORD_LENGTH));
+
+        // enough free space, but not in one piece? -> compact the page without the old item
         uint64_t length = record.length();
-        uint64_t offset = _dataStart - std::max(length, MINIMAL_RECORD_LENGTH);
-        slot->setLength(length);
-        slot->setOffset(offset);
+        if (contiguousSpace(compact) < std::max(length, MINIMAL_RECORD_LENGTH) + (slot.isRedirected() ? sizeof (TID) : 0)) {
+            slot.setOffset(0);
+            slot.setLength(0);
+            this->compact(pageSize);
+        }
+
+        uint64_t offset = dataStart(compact) - std::max(length, MINIMAL_RECORD_LENGTH);
+        slot.setLength(length);
+        slot.setOffset(offset);
 
         if (record.getData()) {
             memcpy(reinterpret_cast<char*> (this) + offset, record.getData(), length);
         }
-        _dataStart -= std::max(length, MINIMAL_RECORD_LENGTH);
-        _freeSpace -= std::max(length, MINIMAL_RECORD_LENGTH);
+        setDataStart(compact, offset);
+        setFreeSpace(compact, freeSpace(compact) - std::max(length, MINIMAL_RECORD_LENGTH));
+
+        if (slot.isRedirected()) {
+            memcpy(reinterpret_cast<char*> (this) + offset - sizeof (TID), &originalTid, sizeof (TID));
+            setDataStart(compact, offset - sizeof (TID));
+        }
+    }
+
+    std::tuple<SPPage::ItemState, RecordView, TID> SPPage::readOptimistic(SlotId slotId, uint64_t pageSize) const {
+        const TID invalidTid(PageId(0, 0), 0);
+
+        bool compact = isCompact();
+        uint64_t header = headerSize(compact);
+        if (header + (slotId + 1) * SPSlot::size(compact) > pageSize) {
+            return std::make_tuple(ItemState::inconsistent, RecordView(), invalidTid);
+        }
+        if (slotId >= firstFreeSlot(compact)) { // free slots at the end are removed
+            return std::make_tuple(ItemState::free, RecordView(), invalidTid);
+        }
+
+        const SPSlot slot = this->slot(slotId, compact);
+        bool onPage = slot.isOnPage();
+        bool extent = slot.isExtent();
+        uint64_t offset = slot.offset();
+        uint64_t length = slot.length();
+
+        if (offset == 0 && length == 0) {
+            return std::make_tuple(ItemState::free, RecordView(), invalidTid);
+        }
+        if (offset < header || offset > pageSize || length > pageSize - offset) {
+            return std::make_tuple(ItemState::inconsistent, RecordView(), invalidTid);
+        }
+
+        const char *item = reinterpret_cast<const char *> (this) + offset;
+        TID originalTid(invalidTid);
+        if (onPage && slot.isRedirected()) {
+            if (offset < header + sizeof (TID)) {
+                return std::make_tuple(ItemState::inconsistent, RecordView(), invalidTid);
+            }
+            memcpy(&originalTid, item - sizeof (TID), sizeof (TID));
+        }
+        if (onPage && extent) {
+            if (length != sizeof (Extent)) {
+                return std::make_tuple(ItemState::inconsistent, RecordView(), invalidTid);
+            }
+            return std::make_tuple(ItemState::extent, RecordView(length, item), originalTid);
+        }
+        if (onPage) {
+            return std::make_tuple(ItemState::record, RecordView(length, item), originalTid);
+        }
 
-        if (slot->isRedirected()) {
-            memmove(reinterpret_cast<char*> (this) + offset - sizeof (TID), reinterpret_cast<char*> (this) + oldOffset - sizeof (TID), sizeof (TID));
-            _dataStart -= sizeof (TID);
+        if (length != sizeof (TID)) {
+            return std::make_tuple(ItemState::inconsistent, RecordView(), invalidTid);
         }
+        TID redirectedTid(invalidTid);
+        memcpy(&redirectedTid, item, sizeof (TID));
+        return std::make_tuple(ItemState::redirect, RecordView(), redirectedTid);
     }
 }
@@ -3,20 +3,29 @@
 #define	SIMPLEDB_DATA_SPPAGE_HPP
 
 #include "Record.hpp"
+#include "RecordView.hpp"
 #include "SlotId.hpp"
 #include "SPSlot.hpp"
 #include "TID.hpp"
 
+#include "segment/Extent.hpp"
+
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 //#include <iostream>
 #include <tuple>
+#include <vector>
 
 namespace simpledb {
 
     /**
      * Slotted page implementation.
+     * New pages of up to COMPACT_MAX_PAGE_SIZE bytes use the compact format with 16 bit header fields and slots,
+     * larger pages and pages written before the compact format existed use the wide format with 64 bit fields.
+     * The format version of a page is in the byte that is the most significant byte of the slot count in the wide format, so it's 0 there.
      */
     class SPPage {
     public:
@@ -26,35 +35,88 @@ namespace simpledb {
         SPPage(const SPPage& orig) = delete;
         SPPage& operator=(const SPPage& orig) = delete;
 
+        static constexpr uint64_t COMPACT_MAX_PAGE_SIZE = uint64_t(1) << SPSlot::COMPACT_BITS; // offsets and lengths must fit into the compact slots
+
+        /**
+         * @param pageSize the size of the page
+         * @return true, if new pages of the size use the compact format; false, if they use the wide format
+         */
+        static bool compactFormat(uint64_t pageSize) {
+            return (pageSize <= COMPACT_MAX_PAGE_SIZE);
+        }
+
+        /**
+         * @param compact true, for the compact format; false, for the wide format
+         * @return the size of the page header in bytes
+         */
+        static uint64_t headerSize(bool compact) {
+            return (compact ? sizeof (CompactHeader) : sizeof (WideHeader));
+        }
+
+        /**
+         * Longer records don't fit on an empty page, not even with the original TID of a redirected record.
+         * @param pageSize the size of the page
+         * @return the maximum length of a record on a new page in bytes
+         */
+        static uint64_t maxRecordLength(uint64_t pageSize) {
+            bool compact = compactFormat(pageSize);
+            return (pageSize - headerSize(compact) - SPSlot::size(compact) - sizeof (TID));
+        }
+
+        /**
+         * Initializes the page in the format for its size.
+         * @param pageSize the size of the page
+         */
+        void init(uint64_t pageSize) {
+            init(pageSize, compactFormat(pageSize));
+        }
+
         /**
          * Initializes the page.
          * @param pageSize the size of the page
+         * @param compact true, for the compact format (only for pages up to COMPACT_MAX_PAGE_SIZE); false, for the wide format
+         */
+        void init(uint64_t pageSize, bool compact);
+
+        /**
+         * @return true, if the page is in the compact format; false, if it's in the wide format
          */
-        void init(uint64_t pageSize);
+        bool isCompact() const {
+            return (reinterpret_cast<const uint8_t *> (this)[offsetof(CompactHeader, format)] == COMPACT_FORMAT);
+        }
+
+        /**
+         * Converts a page in the wide format to the compact format, if its size allows it.
+         * The slot ids stay the same, but slots retrieved before are invalid afterwards.
+         * @param pageSize the size of the page
+         * @return true, if the page was converted; false, if it's already in the compact format or too large for it
+         */
+        bool upgrade(uint64_t pageSize);
 
         /**
          * @param slotId the slot id
-         * @return the pointer to the slot identified by the supplied slot id
+         * @return the slot identified by the supplied slot id
          */
-        SPSlot* getSlot(SlotId slotId) {
-            assert(slotId < _firstFreeSlot);
-            return (reinterpret_cast<SPSlot *> (reinterpret_cast<char *> (this) + sizeof (SPPage) + slotId * sizeof (SPSlot)));
+        SPSlot getSlot(SlotId slotId) {
+            bool compact = isCompact();
+            assert(slotId < firstFreeSlot(compact));
+            return slot(slotId, compact);
         }
 
         /**
          * @param slot the slot
          * @return the pointer to the data of a slot
          */
-        char* getItem(SPSlot* slot) {
-            return (reinterpret_cast<char *> (this) + slot->offset());
+        char* getItem(const SPSlot& slot) {
+            return (reinterpret_cast<char *> (this) + slot.offset());
         }
 
         /**
          * @param slot the slot
          * @return the length of the data of a slot
          */
-        uint64_t getLength(SPSlot* slot) {
-            return (slot->length());
+        uint64_t getLength(const SPSlot& slot) {
+            return (slot.length());
         }
 
         /**
@@ -62,22 +124,39 @@ namespace simpledb {
          * @param slot the slot
          * @return the TID of the redirected record of a slot
          */
-        TID getRedirectedTID(SPSlot* slot) {
-            assert(!slot->isOnPage() && !slot->isRedirected());
-            assert(slot->length() == sizeof (TID));
+        TID getRedirectedTID(const SPSlot& slot) {
+            assert(!slot.isOnPage() && !slot.isRedirected());
+            assert(slot.length() == sizeof (TID));
 
             return (*(reinterpret_cast<TID *> (getItem(slot))));
         }
 
         /**
-         * Checks for free space for a new entry on the page.
+         * Must only be called if the slot holds a redirected record (isRedirected == true).
+         * @param slot the slot
+         * @return the TID of the slot redirecting to the record
+         */
+        TID getOriginalTID(const SPSlot& slot) {
+            assert(slot.isOnPage() && slot.isRedirected());
+
+            return (*(reinterpret_cast<TID *> (getItem(slot) - sizeof (TID))));
+        }
+
+        /**
+         * Checks for free space for a new entry on the page, the page might have to be compacted for it.
          * @param size the needed space in bytes
          * @return true, if there is a enough space to insert the new entry on the page; false, otherwise
          */
         bool hasFreeSpace(uint64_t size);
 
         /**
-         * Checks if the page has enough free space to update an entry on page.
+         * @return the length of the largest record that can be inserted on the page in bytes
+         */
+        uint64_t insertSpace() const;
+
+        /**
+         * Checks if the page has enough free space to update an entry on page, the page might have to be compacted for it.
+         * The space of the old entry isn't counted.
          * @param size the needed space in bytes
          * @return true, if there is enough free space to update an entry on page; false, otherwise
          */
@@ -85,21 +164,24 @@ namespace simpledb {
 
         /**
          * Reserves the next free slot and returns information about it.
-         * @return a tuple of the slot id and slot pointer
+         * Free slots between used ones are reused first.
+         * @return a tuple of the slot id and the slot
          */
-        std::tuple<uint64_t, SPSlot*> nextSlot();
+        std::tuple<uint64_t, SPSlot> nextSlot();
 
         /**
          * Insert a new entry into the page.
          * @param record the new record
+         * @param pageSize the size of the page, to compact it if the free space isn't contiguous
          * @param redirected indicates if the entry is a redirected entry
          * @param originalTid if the entry is a redirected entry, the original TID
          * @return the slot id where the entry was inserted
          */
-        SlotId insert(const Record& record, bool redirected = false, TID originalTid = TID(PageId(0, 0), 0));
+        SlotId insert(const Record& record, uint64_t pageSize, bool redirected = false, TID originalTid = TID(PageId(0, 0), 0));
 
         /**
          * Removes an entry from the page by updating the slot accordingly.
+         * Free slots at the end of the slot array are removed.
          * @param slotId the slot id
          */
         void remove(SlotId slotId);
@@ -115,21 +197,171 @@ namespace simpledb {
          * Updates a record on page by copying the data to new space on the page and updating the slot.
          * @param slotId the slot id
          * @param record the new record
+         * @param pageSize the size of the page, to compact it if the free space isn't contiguous
+         */
+        void updateOnPage(SlotId slotId, const Record& record, uint64_t pageSize);
+
+        /**
+         * Moves the items to the end of the page, so the free space between them becomes contiguous.
+         * The slot ids stay the same.
+         * @param pageSize the size of the page
+         */
+        void compact(uint64_t pageSize);
+
+        /**
+         * @return true, if there is free space between the items; false, if all free space is contiguous
          */
-        void updateOnPage(SlotId slotId, const Record& record);
+        bool isFragmented() const {
+            bool compact = isCompact();
+            return (freeSpace(compact) - (firstFreeSlot(compact) - slotCount(compact)) * SPSlot::size(compact) > contiguousSpace(compact));
+        }
+
+        /**
+         * Checks without a lock on the page, if the page has space between its items, redirects to other pages or could be upgraded to the compact format.
+         * The result must be discarded, if the version of the frame can't be validated afterwards.
+         * @param pageSize the size of the page
+         * @return true, if the page should be compacted or its redirected records moved back; false, otherwise
+         */
+        bool needsVacuum(uint64_t pageSize) const;
+
+        /**
+         * State of an item read by readOptimistic.
+         * - inconsistent: the page is inconsistent, it was modified while reading or the slot id is invalid
+         * - free: the slot is free
+         * - record: the record is on the page
+         * - redirect: the record was redirected to another page
+         * - extent: the record is stored in an extent, the item is its header
+         */
+        enum class ItemState {
+            inconsistent, free, record, redirect, extent
+        };
+
+        /**
+         * Reads an item without a lock on the page.
+         * The page may be modified concurrently, so every field is read only once and bounds checked before use.
+         * The result must be discarded, if the version of the frame can't be validated afterwards.
+         * The item isn't copied, so without a lock it must be copied before the version is validated.
+         * @param slotId the slot id
+         * @param pageSize the size of the page
+         * @return a tuple of the item state, a view of the record or extent header on the page (if it's on the page) and the TID of the redirected record (if redirected)
+         * or the original TID (if the record on the page was redirected from another page)
+         */
+        std::tuple<ItemState, RecordView, TID> readOptimistic(SlotId slotId, uint64_t pageSize) const;
 
         uint64_t firstFreeSlot() const {
-            return _firstFreeSlot;
+            return firstFreeSlot(isCompact());
         }
 
     private:
         static constexpr uint64_t MINIMAL_RECORD_LENGTH = sizeof (TID); // minimal record length
+        static constexpr uint8_t COMPACT_FORMAT = 1; // format version of the compact format, the wide format is version 0
+
+        /**
+         * Page header in the wide format.
+         */
+        struct WideHeader {
+            // uint64_t lsn;
+            uint64_t slotCount; // the number of used slots on the page
+            uint64_t firstFreeSlot; // the number of the next free slot
+            uint64_t dataStart; // offset to the beginning of the data block
+            uint64_t freeSpace; // the free space on the page in bytes
+        };
+
+        /**
+         * Page header in the compact format.
+         */
+        struct CompactHeader {
+            uint16_t slotCount; // the number of used slots on the page
+            uint16_t firstFreeSlot; // the number of the next free slot
+            uint16_t dataStart; // offset to the beginning of the data block
+            uint8_t reserved;
+            uint8_t format; // the format version, at the most significant byte of the slot count in the wide format
+            uint16_t freeSpace; // the free space on the page in bytes
+        };
+
+        WideHeader* wideHeader() {
+            return reinterpret_cast<WideHeader *> (this);
+        }
+
+        const WideHeader* wideHeader() const {
+            return reinterpret_cast<const WideHeader *> (this);
+        }
+
+        CompactHeader* compactHeader() {
+            return reinterpret_cast<CompactHeader *> (this);
+        }
+
+        const CompactHeader* compactHeader() const {
+            return reinterpret_cast<const CompactHeader *> (this);
+        }
+
+        // the header fields are accessed for the format of the page, it's read once by the caller
 
-        // uint64_t _lsn;
-        uint64_t _slotCount; // the number of used slots on the page
-        uint64_t _firstFreeSlot; // the number of the next free slot
-        uint64_t _dataStart; // offset to the beginning of the data block
-        uint64_t _freeSpace; // the free space on the page in bytes
+        uint64_t slotCount(bool compact) const {
+            return (compact ? compactHeader()->slotCount : wideHeader()->slotCount);
+        }
+
+        uint64_t firstFreeSlot(bool compact) const {
+            return (compact ? compactHeader()->firstFreeSlot : wideHeader()->firstFreeSlot);
+        }
+
+        uint64_t dataStart(bool compact) const {
+            return (compact ? compactHeader()->dataStart : wideHeader()->dataStart);
+        }
+
+        uint64_t freeSpace(bool compact) const {
+            return (compact ? compactHeader()->freeSpace : wideHeader()->freeSpace);
+        }
+
+        void setSlotCount(bool compact, uint64_t slotCount) {
+            if (compact) {
+                compactHeader()->slotCount = static_cast<uint16_t> (slotCount);
+            } else {
+                wideHeader()->slotCount = slotCount;
+            }
+        }
+
+        void setFirstFreeSlot(bool compact, uint64_t firstFreeSlot) {
+            if (compact) {
+                compactHeader()->firstFreeSlot = static_cast<uint16_t> (firstFreeSlot);
+            } else {
+                wideHeader()->firstFreeSlot = firstFreeSlot;
+            }
+        }
+
+        void setDataStart(bool compact, uint64_t dataStart) {
+            if (compact) {
+                compactHeader()->dataStart = static_cast<uint16_t> (dataStart);
+            } else {
+                wideHeader()->dataStart = dataStart;
+            }
+        }
+
+        void setFreeSpace(bool compact, uint64_t freeSpace) {
+            if (compact) {
+                compactHeader()->freeSpace = static_cast<uint16_t> (freeSpace);
+            } else {
+                wideHeader()->freeSpace = freeSpace;
+            }
+        }
+
+        /**
+         * @param slotId the slot id
+         * @param compact the format of the page
+         * @return the slot identified by the supplied slot id, without checking the slot id
+         */
+        SPSlot slot(SlotId slotId, bool compact) const {
+            char *slots = const_cast<char *> (reinterpret_cast<const char *> (this)) + headerSize(compact);
+            return SPSlot(slots + slotId * SPSlot::size(compact), compact);
+        }
+
+        /**
+         * @param compact the format of the page
+         * @return the free space between the slots and the data in bytes
+         */
+        uint64_t contiguousSpace(bool compact) const {
+            return (dataStart(compact) - headerSize(compact) - firstFreeSlot(compact) * SPSlot::size(compact));
+        }
     };
 }
 
@@ -1,20 +1,38 @@
 
 #include "SPSegment.hpp"
 
+#include <algorithm>
+
 namespace simpledb {
 
-    SPSegment::SPSegment(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager) : _segmentId(segmentId), _segmentManager(segmentManager), _bufferManager(bufferManager) {
+    constexpr uint64_t SPSegment::BULK_PAGES;
 
+    SPSegment::SPSegment(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager, SegmentAccess access) : _segmentId(segmentId), _pageSize(segmentManager->retrieve(segmentId)->pageSize()), _inventory(segmentManager->retrieve(segmentId)->version() >= FSIPage::SEGMENT_VERSION), _segmentManager(segmentManager), _bufferManager(bufferManager), _mapping(), _searchHints() {
+        for (std::atomic<uint64_t>& hint : _searchHints) {
+            hint.store(0);
+        }
+        if (access == SegmentAccess::mapped) {
+            _mapping = _segmentManager->map(_segmentId, MapAdvice::random);
+        }
     }
 
     TID SPSegment::insert(const Record& record) {
+        assert(!_mapping); // mapped segments are read-only
+
+        // large record? -> store it in an extent, the page holds the header
+        bool isExtent = isLarge(record);
+        Record header = isExtent ? writeExtent(record) : Record();
+        const Record& item = isExtent ? header : record;
+
         uint64_t pageId;
-        std::shared_ptr<BufferFrame> bufferFrame;
+        PageGuard bufferFrame;
         SPPage *page;
 
-        std::tie(pageId, bufferFrame, page) = searchFreeSpace(record.length());
+        std::tie(pageId, bufferFrame, page) = searchFreeSpace(item.length());
 
-        SlotId slotId = page->insert(record);
+        SlotId slotId = page->insert(item, _pageSize);
+        page->getSlot(slotId).setExtent(isExtent);
+        updateFreeSpace(pageId, page);
 
         _bufferManager->unfixPage(bufferFrame, true);
 
@@ -22,37 +40,132 @@ namespace simpledb {
         return (TID(PageId(_segmentId, pageId), slotId));
     }
 
+    std::vector<TID> SPSegment::insertBatch(const std::vector<Record>& records) {
+        assert(!_mapping); // mapped segments are read-only
+
+        std::vector<TID> tids;
+        tids.reserve(records.size());
+        if (records.empty()) {
+            return tids;
+        }
+
+        // grow the segment at once by the pages the records need at least
+        bool compact = SPPage::compactFormat(_pageSize);
+        uint64_t length = 0;
+        for (const Record& record : records) {
+            length += std::max<uint64_t>(isLarge(record) ? sizeof (Extent) : record.length(), sizeof (TID)) + SPSlot::size(compact);
+        }
+        uint64_t dataPages = (length + _pageSize - SPPage::headerSize(compact) - 1) / (_pageSize - SPPage::headerSize(compact));
+        uint64_t pageId = _segmentManager->retrieve(_segmentId)->size();
+        _segmentManager->allocate(_segmentId, pageId + dataPages + dataPages / FSIPage::entries(_pageSize) + 1, pageId + dataPages);
+        uint64_t segmentSize = _segmentManager->retrieve(_segmentId)->size();
+
+        // the pages are filled in memory, up to BULK_PAGES at a time, then the rest of the segment is initialized the same way
+        std::unique_ptr<char, void (*)(void*)> buffer = FileManager::alignedBuffer(BULK_PAGES * _pageSize);
+        uint64_t next = 0;
+        while (next < records.size() || pageId < segmentSize) {
+            uint64_t firstPage = pageId;
+            uint64_t count = 0;
+            for (; count < BULK_PAGES && (next < records.size() || pageId < segmentSize); ++count, ++pageId) {
+                char *data = buffer.get() + count * _pageSize;
+                if (isFSIPage(pageId)) {
+                    reinterpret_cast<FSIPage *> (data)->init(_pageSize);
+                    continue;
+                }
+
+                SPPage *page = reinterpret_cast<SPPage *> (data);
+                page->init(_pageSize);
+                for (; next < records.size(); ++next) {
+                    bool isExtent = isLarge(records[next]);
+                    if (!page->hasFreeSpace(isExtent ? sizeof (Extent) : records[next].length())) {
+                        break;
+                    }
+                    Record header = isExtent ? writeExtent(records[next]) : Record();
+                    SlotId slotId = page->insert(isExtent ? header : records[next], _pageSize);
+                    page->getSlot(slotId).setExtent(isExtent);
+                    tids.push_back(TID(PageId(_segmentId, pageId), slotId));
+                }
+            }
+
+            // the records might not have fit on the pages allocated at first
+            _segmentManager->allocate(_segmentId, pageId, pageId);
+            segmentSize = _segmentManager->retrieve(_segmentId)->size();
+
+            // the classes of pages covered by an inventory page in the buffer are written with it
+            for (uint64_t i = firstPage; i < pageId && _inventory; ++i) {
+                uint64_t fsiPageId = FSIPage::fsiPage(i, _pageSize);
+                if (i != fsiPageId && fsiPageId >= firstPage) {
+                    const SPPage *page = reinterpret_cast<const SPPage *> (buffer.get() + (i - firstPage) * _pageSize);
+                    FSIPage *fsiPage = reinterpret_cast<FSIPage *> (buffer.get() + (fsiPageId - firstPage) * _pageSize);
+                    fsiPage->set(FSIPage::entry(i, _pageSize), FSIPage::spaceClass(page->insertSpace(), _pageSize));
+                }
+            }
+
+            _bufferManager->writePages(_segmentId, firstPage, count, buffer.get());
+
+            // the classes of the first pages are set on the inventory page before them, once the pages are written
+            uint64_t fsiPageId = FSIPage::fsiPage(firstPage, _pageSize);
+            if (_inventory && fsiPageId < firstPage) {
+                PageGuard fsiGuard = _bufferManager->fixPage(_segmentId, fsiPageId, true);
+                FSIPage *fsiPage = reinterpret_cast<FSIPage *> (fsiGuard->getData());
+                for (uint64_t i = firstPage; i < pageId && FSIPage::fsiPage(i, _pageSize) == fsiPageId; ++i) {
+                    const SPPage *page = reinterpret_cast<const SPPage *> (buffer.get() + (i - firstPage) * _pageSize);
+                    fsiPage->set(FSIPage::entry(i, _pageSize), FSIPage::spaceClass(page->insertSpace(), _pageSize));
+                }
+                _bufferManager->unfixPage(fsiGuard, true);
+            }
+
+            for (uint64_t i = firstPage; i < pageId; ++i) {
+                if (!isFSIPage(i)) {
+                    const SPPage *page = reinterpret_cast<const SPPage *> (buffer.get() + (i - firstPage) * _pageSize);
+                    lowerSearchHints(i, FSIPage::spaceClass(page->insertSpace(), _pageSize));
+                }
+            }
+        }
+
+        return tids;
+    }
+
     bool SPSegment::remove(TID tid) {
         assert(tid.pageId().segment == _segmentId);
+        assert(!_mapping); // mapped segments are read-only
 
-        std::shared_ptr<BufferFrame> bufferFrame = _bufferManager->fixPage(tid.pageId().segment, tid.pageId().page, true);
+        PageGuard bufferFrame = _bufferManager->fixPage(tid.pageId().segment, tid.pageId().page, true);
         SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
-        SPSlot *slot = page->getSlot(tid.slotId());
 
         // record doesn't exist
-        if (slot->isFree()) {
+        if (tid.slotId() >= page->firstFreeSlot() || page->getSlot(tid.slotId()).isFree()) {
             _bufferManager->unfixPage(bufferFrame, false);
             return false;
         }
+        SPSlot slot = page->getSlot(tid.slotId());
 
-        assert(!slot->isRedirected()); // use a redirected TID for remove?
-
-        page->remove(tid.slotId());
+        assert(!slot.isRedirected()); // use a redirected TID for remove?
 
-        // record is a redirect
-        if (!slot->isOnPage()) {
-            TID redirectedTid = page->getRedirectedTID(slot);
+        // record is on page
+        if (slot.isOnPage()) {
+            freeExtent(page, slot);
+            page->remove(tid.slotId());
+            updateFreeSpace(tid.pageId().page, page);
             _bufferManager->unfixPage(bufferFrame, true);
+            return true;
+        }
 
+        // record is a redirect
+        TID redirectedTid = page->getRedirectedTID(slot);
+        page->remove(tid.slotId());
+        updateFreeSpace(tid.pageId().page, page);
+        _bufferManager->unfixPage(bufferFrame, true);
 
-            bufferFrame = _bufferManager->fixPage(redirectedTid.pageId().segment, redirectedTid.pageId().page, false);
-            page = reinterpret_cast<SPPage *> (bufferFrame->getData());
-            slot = page->getSlot(redirectedTid.slotId());
+        bufferFrame = _bufferManager->fixPage(redirectedTid.pageId().segment, redirectedTid.pageId().page, true);
+        page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+        slot = page->getSlot(redirectedTid.slotId());
 
-            assert(!slot->isFree() && slot->isOnPage() && slot->isRedirected());
+        assert(!slot.isFree() && slot.isOnPage() && slot.isRedirected());
 
-            page->remove(redirectedTid.slotId());
-        }
+        freeExtent(page, slot);
+        page->remove(redirectedTid.slotId());
+        updateFreeSpace(redirectedTid.pageId().page, page);
 
         _bufferManager->unfixPage(bufferFrame, true);
 
@@ -62,66 +175,246 @@ namespace simpledb {
     Record SPSegment::lookup(TID tid) {
         assert(tid.pageId().segment == _segmentId);
 
-        std::shared_ptr<BufferFrame> bufferFrame = _bufferManager->fixPage(tid.pageId().segment, tid.pageId().page, false);
-        SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
-        SPSlot *slot = page->getSlot(tid.slotId());
+        if (_mapping) {
+            return lookupMapped(tid);
+        }
 
-        // record doesn't exist
-        if (slot->isFree()) {
-            _bufferManager->unfixPage(bufferFrame, false);
-            return Record();
+        // pages are read optimistically without locks, restart if the page was modified while reading
+        TID currentTid = tid;
+        while (true) {
+            BufferFrame *bufferFrame;
+            uint64_t version;
+            std::tie(bufferFrame, version) = _bufferManager->fixPageOptimistic(currentTid.pageId().segment, currentTid.pageId().page);
+            SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+
+            std::tuple<SPPage::ItemState, RecordView, TID> item = page->readOptimistic(currentTid.slotId(), _pageSize);
+
+            // the item on the page is copied before the version is validated
+            Record record;
+            Extent extent;
+            if (std::get<0>(item) == SPPage::ItemState::record) {
+                record = Record(std::get<1>(item).length(), std::get<1>(item).getData());
+            } else if (std::get<0>(item) == SPPage::ItemState::extent) {
+                memcpy(&extent, std::get<1>(item).getData(), sizeof (Extent));
+            }
+
+            if (!_bufferManager->unfixPageOptimistic(bufferFrame, version)) {
+                continue; // page modified while reading
+            }
+
+            switch (std::get<0>(item)) {
+                case SPPage::ItemState::inconsistent: // page is consistent, so the slot id is invalid
+                case SPPage::ItemState::free: // record doesn't exist
+                    if (!(currentTid == tid)) { // redirected record was moved concurrently
+                        currentTid = tid;
+                        continue;
+                    }
+                    assert(std::get<0>(item) == SPPage::ItemState::free); // lookup with an invalid TID?
+                    return Record();
+                case SPPage::ItemState::record: // record is on page
+                    if (!(currentTid == tid) && !(std::get<2>(item) == tid)) { // redirected record was moved and its slot reused concurrently
+                        currentTid = tid;
+                        continue;
+                    }
+                    return record;
+                case SPPage::ItemState::extent: // record is in an extent
+                {
+                    if (!(currentTid == tid) && !(std::get<2>(item) == tid)) { // redirected record was moved and its slot reused concurrently
+                        currentTid = tid;
+                        continue;
+                    }
+                    record = Record(extent.length, nullptr);
+                    _segmentManager->readExtent(_segmentId, extent, record.getData());
+
+                    // the extent might have been freed and reused while reading, then the header was removed
+                    if (!_bufferManager->unfixPageOptimistic(bufferFrame, version)) {
+                        continue;
+                    }
+                    return record;
+                }
+                case SPPage::ItemState::redirect: // record is a redirect
+                    if (!(currentTid == tid)) { // redirected record was moved concurrently
+                        currentTid = tid;
+                        continue;
+                    }
+                    currentTid = std::get<2>(item);
+                    continue;
+            }
         }
+    }
 
-        // record is on page
-        if (slot->isOnPage()) {
-            Record record(page->getLength(slot), page->getItem(slot));
-            _bufferManager->unfixPage(bufferFrame, false);
-            return record;
+    RecordView SPSegment::lookup(TID tid, PageGuard& bufferFrame, Record& buffer) {
+        assert(tid.pageId().segment == _segmentId);
+
+        if (_mapping) {
+            if (bufferFrame.isValid()) {
+                _bufferManager->unfixPage(bufferFrame, false);
+            }
+            return lookupMapped(tid, buffer);
         }
 
-        // record is a redirect
-        TID redirectedTid = page->getRedirectedTID(slot);
-        _bufferManager->unfixPage(bufferFrame, false);
+        // the page of the record stays fixed for the view, the pages of redirects are unfixed
+        TID currentTid = tid;
+        while (true) {
+            // the page of the previous view is kept, if it's the page of the record, only one page is held at a time
+            if (!bufferFrame.isValid() || !(bufferFrame->pageId() == currentTid.pageId())) {
+                if (bufferFrame.isValid()) {
+                    _bufferManager->unfixPage(bufferFrame, false);
+                }
+                bufferFrame = _bufferManager->fixPage(currentTid.pageId().segment, currentTid.pageId().page, false);
+            }
+            const SPPage *page = reinterpret_cast<const SPPage *> (bufferFrame->getData());
+
+            // the page is locked, so the item is consistent
+            std::tuple<SPPage::ItemState, RecordView, TID> item = page->readOptimistic(currentTid.slotId(), _pageSize);
+
+            switch (std::get<0>(item)) {
+                case SPPage::ItemState::inconsistent: // the slot id is invalid
+                case SPPage::ItemState::free: // record doesn't exist
+                    _bufferManager->unfixPage(bufferFrame, false);
+                    if (!(currentTid == tid)) { // redirected record was moved concurrently
+                        currentTid = tid;
+                        continue;
+                    }
+                    assert(std::get<0>(item) == SPPage::ItemState::free); // lookup with an invalid TID?
+                    return RecordView();
+                case SPPage::ItemState::record: // record is on page
+                    if (!(currentTid == tid) && !(std::get<2>(item) == tid)) { // redirected record was moved and its slot reused concurrently
+                        _bufferManager->unfixPage(bufferFrame, false);
+                        currentTid = tid;
+                        continue;
+                    }
+                    return std::get<1>(item);
+                case SPPage::ItemState::extent: // record is in an extent, it can't be freed while the header is locked
+                {
+                    if (!(currentTid == tid) && !(std::get<2>(item) == tid)) { // redirected record was moved and its slot reused concurrently
+                        _bufferManager->unfixPage(bufferFrame, false);
+                        currentTid = tid;
+                        continue;
+                    }
+                    Extent extent;
+                    memcpy(&extent, std::get<1>(item).getData(), sizeof (Extent));
+                    buffer = Record(extent.length, nullptr);
+                    _segmentManager->readExtent(_segmentId, extent, buffer.getData());
+                    _bufferManager->unfixPage(bufferFrame, false);
+                    return RecordView(buffer);
+                }
+                case SPPage::ItemState::redirect: // record is a redirect
+                    _bufferManager->unfixPage(bufferFrame, false);
+                    if (!(currentTid == tid)) { // redirected record was moved concurrently
+                        currentTid = tid;
+                        continue;
+                    }
+                    currentTid = std::get<2>(item);
+                    continue;
+            }
+        }
+    }
 
+    std::vector<Record> SPSegment::lookup(const std::vector<TID>& tids) {
+        std::vector<Record> records(tids.size());
 
-        bufferFrame = _bufferManager->fixPage(redirectedTid.pageId().segment, redirectedTid.pageId().page, false);
-        page = reinterpret_cast<SPPage *> (bufferFrame->getData());
-        slot = page->getSlot(redirectedTid.slotId());
+        // mapped pages don't need to be loaded into frames in batches
+        if (_mapping) {
+            for (uint64_t i = 0; i < tids.size(); ++i) {
+                assert(tids[i].pageId().segment == _segmentId);
+                records[i] = lookupMapped(tids[i]);
+            }
+            return records;
+        }
 
-        assert(!slot->isFree() && slot->isOnPage() && slot->isRedirected());
+        // reads served by the page cache are faster one by one, a batch only pays off, if the device is read
+        if (!_bufferManager->isDirectIO()) {
+            for (uint64_t i = 0; i < tids.size(); ++i) {
+                records[i] = lookup(tids[i]);
+            }
+            return records;
+        }
 
-        Record record(page->getLength(slot), page->getItem(slot));
-        _bufferManager->unfixPage(bufferFrame, false);
-        return record;
+        std::vector<uint64_t> redirected;
+        uint64_t batchSize = _bufferManager->maxBatchSize(_segmentId);
+
+        for (uint64_t begin = 0; begin < tids.size(); begin += batchSize) {
+            uint64_t end = std::min<uint64_t>(begin + batchSize, tids.size());
+
+            // fix the pages of the batch, TIDs on the same page share its guard
+            std::vector<PageId> pages;
+            pages.reserve(end - begin);
+            for (uint64_t i = begin; i < end; ++i) {
+                assert(tids[i].pageId().segment == _segmentId);
+                pages.push_back(tids[i].pageId());
+            }
+            PageBatch batch = _bufferManager->fixPages(pages, false);
+
+            // other batches fix the budget of frames? -> look up the records one at a time
+            if (!batch) {
+                for (uint64_t i = begin; i < end; ++i) {
+                    records[i] = lookup(tids[i]);
+                }
+                continue;
+            }
+
+            for (uint64_t i = begin; i < end; ++i) {
+                SPPage *page = reinterpret_cast<SPPage *> (batch[i - begin]->getData());
+
+                // the pages are locked, so the item is consistent
+                std::tuple<SPPage::ItemState, RecordView, TID> item = page->readOptimistic(tids[i].slotId(), _pageSize);
+                if (std::get<0>(item) == SPPage::ItemState::record) {
+                    records[i] = Record(std::get<1>(item).length(), std::get<1>(item).getData());
+                } else if (std::get<0>(item) != SPPage::ItemState::free) {
+                    redirected.push_back(i); // redirect or extent, read it after the batch is unfixed
+                }
+            }
+
+            _bufferManager->unfixPages(batch);
+        }
+
+        for (uint64_t i : redirected) {
+            records[i] = lookup(tids[i]);
+        }
+
+        return records;
     }
 
     bool SPSegment::update(TID tid, const Record& record) {
         assert(tid.pageId().segment == _segmentId);
+        assert(!_mapping); // mapped segments are read-only
 
-        std::shared_ptr<BufferFrame> bufferFrame = _bufferManager->fixPage(tid.pageId().segment, tid.pageId().page, true);
+        PageGuard bufferFrame = _bufferManager->fixPage(tid.pageId().segment, tid.pageId().page, true);
         SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
-        SPSlot *slot = page->getSlot(tid.slotId());
 
         // record doesn't exist
-        if (slot->isFree()) {
+        if (tid.slotId() >= page->firstFreeSlot() || page->getSlot(tid.slotId()).isFree()) {
             _bufferManager->unfixPage(bufferFrame, false);
             return false;
         }
+        SPSlot slot = page->getSlot(tid.slotId());
+
+        assert(!slot.isRedirected()); // use a redirected TID for update?
 
-        assert(!slot->isRedirected()); // use a redirected TID for update?
+        // large record? -> store it in a new extent, the header replaces the old item
+        bool isExtent = isLarge(record);
+        Record header = isExtent ? writeExtent(record) : Record();
+        const Record& item = isExtent ? header : record;
 
         // record is on page
-        if (slot->isOnPage()) {
-            // new record not longer than old one -> update in place
-            if (record.length() <= page->getLength(slot)) {
-                page->updateInPlace(tid.slotId(), record);
+        if (slot.isOnPage()) {
+            // new item not longer than old one -> update in place
+            if (item.length() <= page->getLength(slot)) {
+                freeExtent(page, slot);
+                page->updateInPlace(tid.slotId(), item);
+                slot.setExtent(isExtent);
+                updateFreeSpace(tid.pageId().page, page);
                 _bufferManager->unfixPage(bufferFrame, true);
                 return true;
             }
 
-            // new record has enough space on page -> update on page
-            if (page->hasUpdateSpace(record.length())) {
-                page->updateOnPage(tid.slotId(), record);
+            // new item has enough space on page -> update on page
+            if (page->hasUpdateSpace(item.length())) {
+                freeExtent(page, slot);
+                page->updateOnPage(tid.slotId(), item, _pageSize);
+                slot.setExtent(isExtent);
+                updateFreeSpace(tid.pageId().page, page);
                 _bufferManager->unfixPage(bufferFrame, true);
                 return true;
             }
@@ -129,13 +422,14 @@ namespace simpledb {
             // not enough space on page -> redirect to new page
             {
                 _bufferManager->unfixPage(bufferFrame, false);
-                slot = nullptr;
 
                 // find a redirected entry
                 uint64_t redirectedPageId;
-                std::tie(redirectedPageId, bufferFrame, page) = searchFreeSpace(record.length() + sizeof (TID));
+                std::tie(redirectedPageId, bufferFrame, page) = searchFreeSpace(item.length() + sizeof (TID));
 
-                SlotId redirectedSlotId = page->insert(record, true, tid);
+                SlotId redirectedSlotId = page->insert(item, _pageSize, true, tid);
+                page->getSlot(redirectedSlotId).setExtent(isExtent);
+                updateFreeSpace(redirectedPageId, page);
                 _bufferManager->unfixPage(bufferFrame, true);
 
                 // set redirect on original page
@@ -144,8 +438,10 @@ namespace simpledb {
                 slot = page->getSlot(tid.slotId());
                 TID redirectedTid = TID(PageId(_segmentId, redirectedPageId), redirectedSlotId);
 
+                freeExtent(page, slot);
                 page->updateInPlace(tid.slotId(), Record(sizeof (TID), reinterpret_cast<char*> (&redirectedTid)));
-                slot->setOnPage(false);
+                slot.setOnPage(false);
+                updateFreeSpace(tid.pageId().page, page);
 
                 _bufferManager->unfixPage(bufferFrame, true);
                 return true;
@@ -158,20 +454,35 @@ namespace simpledb {
 
         bufferFrame = _bufferManager->fixPage(redirectedTid.pageId().segment, redirectedTid.pageId().page, true);
         page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+
+        // the vacuum might have moved the record back to its page in the meantime -> start over
+        if (!isRedirectedFrom(page, redirectedTid.slotId(), tid)) {
+            _bufferManager->unfixPage(bufferFrame, false);
+            if (isExtent) {
+                Extent extent;
+                memcpy(&extent, header.getData(), sizeof (Extent));
+                _segmentManager->freeExtent(_segmentId, extent);
+            }
+            return update(tid, record);
+        }
         slot = page->getSlot(redirectedTid.slotId());
 
-        assert(!slot->isFree() && slot->isOnPage() && slot->isRedirected());
+        freeExtent(page, slot);
 
-        // new record not longer than old one -> update in place
-        if (record.length() <= page->getLength(slot)) {
-            page->updateInPlace(redirectedTid.slotId(), record);
+        // new item not longer than old one -> update in place
+        if (item.length() <= page->getLength(slot)) {
+            page->updateInPlace(redirectedTid.slotId(), item);
+            slot.setExtent(isExtent);
+            updateFreeSpace(redirectedTid.pageId().page, page);
             _bufferManager->unfixPage(bufferFrame, true);
             return true;
         }
 
-        // new record has enough space on page -> update on page
-        if (page->hasUpdateSpace(record.length() + sizeof (TID))) {
-            page->updateOnPage(redirectedTid.slotId(), record);
+        // new item has enough space on page -> update on page
+        if (page->hasUpdateSpace(item.length() + sizeof (TID))) {
+            page->updateOnPage(redirectedTid.slotId(), item, _pageSize);
+            slot.setExtent(isExtent);
+            updateFreeSpace(redirectedTid.pageId().page, page);
             _bufferManager->unfixPage(bufferFrame, true);
             return true;
         }
@@ -180,16 +491,18 @@ namespace simpledb {
         {
             // delete old redirected entry
             page->remove(redirectedTid.slotId());
+            updateFreeSpace(redirectedTid.pageId().page, page);
             _bufferManager->unfixPage(bufferFrame, true);
-            slot = nullptr;
 
             // TODO: try to insert on original page first
 
             // find new redirected entry
             uint64_t newRedirectedPageId;
-            std::tie(newRedirectedPageId, bufferFrame, page) = searchFreeSpace(record.length() + sizeof (TID));
+            std::tie(newRedirectedPageId, bufferFrame, page) = searchFreeSpace(item.length() + sizeof (TID));
 
-            SlotId newRedirectedSlotId = page->insert(record, true, tid);
+            SlotId newRedirectedSlotId = page->insert(item, _pageSize, true, tid);
+            page->getSlot(newRedirectedSlotId).setExtent(isExtent);
+            updateFreeSpace(newRedirectedPageId, page);
             _bufferManager->unfixPage(bufferFrame, true);
 
             // set redirect on original page
@@ -198,48 +511,316 @@ namespace simpledb {
             slot = page->getSlot(tid.slotId());
             TID newRedirectedTid = TID(PageId(_segmentId, newRedirectedPageId), newRedirectedSlotId);
 
-            slot->setOnPage(true);
+            slot.setOnPage(true);
             page->updateInPlace(tid.slotId(), Record(sizeof (TID), reinterpret_cast<char*> (&newRedirectedTid)));
-            slot->setOnPage(false);
+            slot.setOnPage(false);
 
             _bufferManager->unfixPage(bufferFrame, true);
             return true;
         }
     }
 
+    std::tuple<uint64_t, uint64_t> SPSegment::vacuum(uint64_t firstPage, uint64_t count) {
+        assert(!_mapping); // mapped segments are read-only
+
+        // the vacuum holds two pages at a time, so only one may run
+        boost::lock_guard<boost::mutex> lock(_vacuumMutex);
+
+        uint64_t segmentSize = _segmentManager->retrieve(_segmentId)->size();
+        uint64_t end = (firstPage > segmentSize || count > segmentSize - firstPage) ? segmentSize : firstPage + count;
+        uint64_t vacuumedPages = 0;
+
+        for (uint64_t pageId = firstPage; pageId < end; ++pageId) {
+            if (isFSIPage(pageId)) {
+                continue;
+            }
+
+            // most pages don't need a vacuum, check them without locking
+            BufferFrame *frame;
+            uint64_t version;
+            std::tie(frame, version) = _bufferManager->fixPageOptimistic(_segmentId, pageId);
+            bool needsVacuum = reinterpret_cast<SPPage *> (frame->getData())->needsVacuum(_pageSize);
+            if (_bufferManager->unfixPageOptimistic(frame, version) && !needsVacuum) {
+                continue;
+            }
+
+            PageGuard bufferFrame = _bufferManager->fixPage(_segmentId, pageId, true);
+            SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+            bool modified = false;
+
+            for (SlotId slotId = 0; slotId < page->firstFreeSlot(); ++slotId) {
+                SPSlot slot = page->getSlot(slotId);
+                if (!slot.isFree() && !slot.isOnPage()) {
+                    modified |= moveBack(TID(PageId(_segmentId, pageId), slotId), bufferFrame, modified);
+                    page = reinterpret_cast<SPPage *> (bufferFrame->getData()); // the page might have been fixed again
+                }
+            }
+
+            // pages in the wide format are converted to the compact format, which compacts them as well
+            if (page->upgrade(_pageSize)) {
+                modified = true;
+            } else if (page->isFragmented()) {
+                page->compact(_pageSize);
+                modified = true;
+            }
+
+            if (modified) {
+                updateFreeSpace(pageId, page);
+                ++vacuumedPages;
+            }
+            _bufferManager->unfixPage(bufferFrame, modified);
+        }
+
+        return std::make_tuple(end < segmentSize ? end : 0, vacuumedPages);
+    }
+
     std::unique_ptr<SPSegment::iterator> SPSegment::range() {
-        return std::unique_ptr<SPSegment::iterator>(new iterator(_segmentId, _segmentManager, _bufferManager));
+        return std::unique_ptr<SPSegment::iterator>(new iterator(_segmentId, _segmentManager, _bufferManager, _mapping.get()));
     }
 
-    std::tuple<uint64_t, std::shared_ptr<BufferFrame>, SPPage*> SPSegment::searchFreeSpace(uint64_t size) {
-        uint64_t segmentSize = _segmentManager->retrieve(_segmentId)->size();
+    Record SPSegment::lookupMapped(TID tid) {
+        Record buffer;
+        RecordView record = lookupMapped(tid, buffer);
 
-        uint64_t pageId;
-        std::shared_ptr<BufferFrame> bufferFrame;
-        SPPage *page;
+        // a large record was read into the buffer already
+        return (buffer.length() > 0 ? std::move(buffer) : Record(record.length(), record.getData()));
+    }
 
-        for (pageId = 0; pageId < segmentSize; ++pageId) {
-            bufferFrame = _bufferManager->fixPage(_segmentId, pageId, true);
-            // TODO: don't use exclusive access to search for free space
-            page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+    RecordView SPSegment::lookupMapped(TID tid, Record& buffer) {
+        TID currentTid = tid;
+        while (true) {
+            const SPPage *page = reinterpret_cast<const SPPage *> (_mapping->page(currentTid.pageId().page, _pageSize));
+            std::tuple<SPPage::ItemState, RecordView, TID> item = page->readOptimistic(currentTid.slotId(), _pageSize);
+
+            switch (std::get<0>(item)) {
+                case SPPage::ItemState::inconsistent: // page is consistent, so the slot id is invalid
+                case SPPage::ItemState::free: // record doesn't exist
+                    assert(std::get<0>(item) == SPPage::ItemState::free); // lookup with an invalid TID?
+                    return RecordView();
+                case SPPage::ItemState::record: // record is on page
+                    return std::get<1>(item);
+                case SPPage::ItemState::extent: // record is in an extent
+                {
+                    Extent extent;
+                    memcpy(&extent, std::get<1>(item).getData(), sizeof (Extent));
+                    buffer = Record(extent.length, nullptr);
+                    _segmentManager->readExtent(_segmentId, extent, buffer.getData());
+                    return RecordView(buffer);
+                }
+                case SPPage::ItemState::redirect: // record is a redirect, the redirected record is on another page
+                    assert(currentTid == tid);
+                    currentTid = std::get<2>(item);
+                    continue;
+            }
+        }
+    }
+
+    std::tuple<uint64_t, PageGuard, SPPage*> SPSegment::searchFreeSpace(uint64_t size) {
+        assert(size <= SPPage::maxRecordLength(_pageSize) + sizeof (TID)); // a new page must have enough space, use an extent otherwise
+        if (!_inventory) {
+            return searchPages(size);
+        }
 
-            if (!page->hasFreeSpace(size)) { // no free space on page
+        uint8_t neededClass = FSIPage::neededClass(size, _pageSize);
+        uint64_t entries = FSIPage::entries(_pageSize);
+        uint64_t segmentSize = _segmentManager->retrieve(_segmentId)->size();
+        uint64_t pageId = _searchHints[neededClass].load();
+
+        while (true) {
+            while (pageId < segmentSize) {
+                // search the inventory page of the group, it's unfixed before the data page is fixed
+                uint64_t fsiPageId = FSIPage::fsiPage(pageId, _pageSize);
+                uint64_t first = isFSIPage(pageId) ? 0 : FSIPage::entry(pageId, _pageSize);
+                uint64_t count = std::min(entries, segmentSize - fsiPageId - 1) - first;
+
+                PageGuard fsiFrame = _bufferManager->fixPage(_segmentId, fsiPageId, false);
+                int64_t entry = reinterpret_cast<FSIPage *> (fsiFrame->getData())->find(neededClass, first, count);
+                _bufferManager->unfixPage(fsiFrame, false);
+
+                if (entry < 0) { // no page of the group has enough space
+                    pageId = fsiPageId + entries + 1;
+                    raiseSearchHints(pageId, neededClass);
+                    continue;
+                }
+
+                pageId = fsiPageId + entry + 1;
+                PageGuard bufferFrame = _bufferManager->fixPage(_segmentId, pageId, true);
+                SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+
+                // the page might have been filled since the inventory page was read
+                if (page->hasFreeSpace(size)) {
+                    raiseSearchHints(pageId, neededClass);
+                    return std::make_tuple(pageId, std::move(bufferFrame), page);
+                }
                 _bufferManager->unfixPage(bufferFrame, false);
+                ++pageId;
+            }
+
+            // no free space found => allocate new pages and search them
+            pageId = segmentSize;
+            allocate(segmentSize + 1);
+            segmentSize = _segmentManager->retrieve(_segmentId)->size();
+        }
+    }
+
+    std::tuple<uint64_t, PageGuard, SPPage*> SPSegment::searchPages(uint64_t size) {
+        uint64_t segmentSize = _segmentManager->retrieve(_segmentId)->size();
+
+        for (uint64_t pageId = 0; ; ++pageId) {
+            if (pageId == segmentSize) { // no free space found => allocate a new page
+                allocate(segmentSize + 1);
+                segmentSize = _segmentManager->retrieve(_segmentId)->size();
+            }
+
+            // most pages are full, check them without locking
+            BufferFrame *frame;
+            uint64_t version;
+            std::tie(frame, version) = _bufferManager->fixPageOptimistic(_segmentId, pageId);
+            bool hasFreeSpace = reinterpret_cast<SPPage *> (frame->getData())->hasFreeSpace(size);
+            if (_bufferManager->unfixPageOptimistic(frame, version) && !hasFreeSpace) {
                 continue;
-            } else { // page with free space found
-                break;
             }
+
+            PageGuard bufferFrame = _bufferManager->fixPage(_segmentId, pageId, true);
+            SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+            if (page->hasFreeSpace(size)) {
+                return std::make_tuple(pageId, std::move(bufferFrame), page);
+            }
+            _bufferManager->unfixPage(bufferFrame, false);
         }
+    }
 
-        // no free space found => allocate new page
-        if (pageId == segmentSize) {
-            allocate(segmentSize + 1);
+    void SPSegment::updateFreeSpace(uint64_t pageId, const SPPage* page) {
+        if (!_inventory) {
+            return;
+        }
+
+        uint8_t spaceClass = FSIPage::spaceClass(page->insertSpace(), _pageSize);
+        uint64_t fsiPageId = FSIPage::fsiPage(pageId, _pageSize);
+        uint64_t entry = FSIPage::entry(pageId, _pageSize);
+
+        // most modifications don't change the class, check it without locking the inventory page
+        BufferFrame *fsiFrame;
+        uint64_t version;
+        std::tie(fsiFrame, version) = _bufferManager->fixPageOptimistic(_segmentId, fsiPageId);
+        uint8_t oldClass = reinterpret_cast<FSIPage *> (fsiFrame->getData())->get(entry);
+        if (_bufferManager->unfixPageOptimistic(fsiFrame, version) && oldClass == spaceClass) {
+            return;
+        }
+
+        PageGuard fsiGuard = _bufferManager->fixPage(_segmentId, fsiPageId, true);
+        FSIPage *fsiPage = reinterpret_cast<FSIPage *> (fsiGuard->getData());
+        oldClass = fsiPage->get(entry);
+        fsiPage->set(entry, spaceClass);
+        _bufferManager->unfixPage(fsiGuard, true);
+
+        if (spaceClass > oldClass) {
+            lowerSearchHints(pageId, spaceClass);
+        }
+    }
+
+    void SPSegment::lowerSearchHints(uint64_t pageId, uint8_t spaceClass) {
+        // the page can be found again by searches for the classes up to its class
+        for (uint64_t neededClass = 1; neededClass <= spaceClass; ++neededClass) {
+            uint64_t hint = _searchHints[neededClass].load();
+            while (hint > pageId && !_searchHints[neededClass].compare_exchange_weak(hint, pageId)) {
+            }
+        }
+    }
 
-            bufferFrame = _bufferManager->fixPage(_segmentId, pageId, true);
+    void SPSegment::raiseSearchHints(uint64_t pageId, uint8_t spaceClass) {
+        // the pages before the page id have a lower class, so searches for the class or above can skip them
+        for (uint64_t neededClass = spaceClass; neededClass < FSIPage::CLASSES; ++neededClass) {
+            uint64_t hint = _searchHints[neededClass].load();
+            if (hint >= pageId) { // the hints of the higher classes are at least as high
+                return;
+            }
+            while (hint < pageId && !_searchHints[neededClass].compare_exchange_weak(hint, pageId)) {
+            }
+        }
+    }
+
+    bool SPSegment::isRedirectedFrom(SPPage* page, SlotId slotId, TID tid) {
+        if (slotId >= page->firstFreeSlot()) {
+            return false;
+        }
+        SPSlot slot = page->getSlot(slotId);
+        return (!slot.isFree() && slot.isOnPage() && slot.isRedirected() && page->getOriginalTID(slot) == tid);
+    }
+
+    bool SPSegment::moveBack(TID tid, PageGuard& bufferFrame, bool isDirty) {
+        SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+        SPSlot slot = page->getSlot(tid.slotId());
+        TID redirectedTid = page->getRedirectedTID(slot);
+        if (redirectedTid.pageId() == tid.pageId()) {
+            return false;
+        }
+
+        PageGuard redirectedFrame;
+        if (redirectedTid.pageId().page > tid.pageId().page) {
+            redirectedFrame = _bufferManager->fixPage(_segmentId, redirectedTid.pageId().page, true);
+        } else {
+            // batches fix their pages in page order, so the lower page is fixed first, or a batch holding it waits for us
+            _bufferManager->unfixPage(bufferFrame, isDirty);
+            redirectedFrame = _bufferManager->fixPage(_segmentId, redirectedTid.pageId().page, true);
+            bufferFrame = _bufferManager->fixPage(_segmentId, tid.pageId().page, true);
             page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+
+            // the record might have been updated or removed, while the page wasn't fixed
+            if (tid.slotId() >= page->firstFreeSlot()) {
+                _bufferManager->unfixPage(redirectedFrame, false);
+                return false;
+            }
+            slot = page->getSlot(tid.slotId());
+            if (slot.isFree() || slot.isOnPage() || !(page->getRedirectedTID(slot) == redirectedTid)) {
+                _bufferManager->unfixPage(redirectedFrame, false);
+                return false;
+            }
+        }
+        SPPage *redirectedPage = reinterpret_cast<SPPage *> (redirectedFrame->getData());
+
+        // an update might be moving the record right now, or the page has no space for it
+        uint64_t length = isRedirectedFrom(redirectedPage, redirectedTid.slotId(), tid) ? redirectedPage->getSlot(redirectedTid.slotId()).length() : 0;
+        if (length == 0 || (length > page->getLength(slot) && !page->hasUpdateSpace(length))) {
+            _bufferManager->unfixPage(redirectedFrame, false);
+            return false;
+        }
+
+        // the record replaces the redirect, an extent header takes its extent along
+        SPSlot redirectedSlot = redirectedPage->getSlot(redirectedTid.slotId());
+        Record item(length, redirectedPage->getItem(redirectedSlot));
+        bool isExtent = redirectedSlot.isExtent();
+
+        slot.setOnPage(true);
+        if (length <= page->getLength(slot)) {
+            page->updateInPlace(tid.slotId(), item);
+        } else {
+            page->updateOnPage(tid.slotId(), item, _pageSize);
         }
+        slot.setExtent(isExtent);
+
+        redirectedPage->remove(redirectedTid.slotId());
+        updateFreeSpace(redirectedTid.pageId().page, redirectedPage);
+        _bufferManager->unfixPage(redirectedFrame, true);
+
+        return true;
+    }
 
-        return std::make_tuple(pageId, bufferFrame, page);
+    Record SPSegment::writeExtent(const Record& record) {
+        Extent extent = _segmentManager->allocateExtent(_segmentId, record.length());
+        _segmentManager->writeExtent(_segmentId, extent, record.getData());
+        return Record(sizeof (Extent), reinterpret_cast<char*> (&extent));
+    }
+
+    void SPSegment::freeExtent(SPPage* page, SPSlot& slot) {
+        if (!slot.isExtent()) {
+            return;
+        }
+
+        Extent extent;
+        memcpy(&extent, page->getItem(slot), sizeof (Extent));
+        slot.setExtent(false);
+        _segmentManager->freeExtent(_segmentId, extent);
     }
 
     void SPSegment::allocate(uint64_t size) {
@@ -248,10 +829,16 @@ namespace simpledb {
         _segmentManager->allocate(_segmentId, size, size);
         uint64_t newSize = _segmentManager->retrieve(_segmentId)->size();
 
+        // the inventory page of a group precedes its data pages, so it's initialized first
         for (uint64_t i = oldSize; i < newSize; ++i) {
-            std::shared_ptr<BufferFrame> bufferFrame = _bufferManager->fixPage(_segmentId, i, true);
-            SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
-            page->init(_bufferManager->pageSize());
+            PageGuard bufferFrame = _bufferManager->fixPage(_segmentId, i, true);
+            if (isFSIPage(i)) {
+                reinterpret_cast<FSIPage *> (bufferFrame->getData())->init(_pageSize);
+            } else {
+                SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+                page->init(_pageSize);
+                updateFreeSpace(i, page);
+            }
             _bufferManager->unfixPage(bufferFrame, true);
         }
     }
@@ -2,7 +2,9 @@
 #ifndef SIMPLEDB_DATA_SPSEGMENT_HPP
 #define SIMPLEDB_DATA_SPSEGMENT_HPP
 
+#include "FSIPage.hpp"
 #include "Record.hpp"
+#include "RecordView.hpp"
 #include "SlotId.hpp"
 #include "SPIterator.hpp"
 #include "SPPage.hpp"
@@ -10,16 +12,27 @@
 #include "TID.hpp"
 
 #include "buffer.hpp"
+#include "file.hpp"
 #include "segment.hpp"
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <tuple>
+#include <vector>
 
 namespace simpledb {
 
     /**
      * Slotted pages segment implementation.
+     * Records that don't fit on a page are stored in extents of consecutive pages, the slot holds the extent header.
+     * The free space of the pages is tracked in free space inventory pages, so an insert doesn't search the pages.
+     * Segments of an older version have no inventory pages, their inserts search the pages and all pages hold records.
+     * In mapped mode the segment is read-only, records are read from a memory mapping of the segment file instead of frames.
      */
     class SPSegment {
     public:
@@ -30,8 +43,9 @@ namespace simpledb {
          * @param segmentId the segment id
          * @param segmentManager the segment manager
          * @param bufferManager the buffer manager
+         * @param access buffered, to read and write the pages in frames; mapped, to read the pages of an immutable segment from a mapping
          */
-        SPSegment(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager);
+        SPSegment(uint64_t segmentId, std::shared_ptr<SegmentManager> segmentManager, std::shared_ptr<BufferManager> bufferManager, SegmentAccess access = SegmentAccess::buffered);
         ~SPSegment() = default;
 
         SPSegment(const SPSegment& orig) = delete;
@@ -44,6 +58,15 @@ namespace simpledb {
          */
         TID insert(const Record& record);
 
+        /**
+         * Inserts many records at once, e.g. to load a table.
+         * The records are stored on new pages at the end of the segment, the pages are filled in memory and written with large writes
+         * without fixing them in the buffer. The segment must not be modified concurrently.
+         * @param records the records to insert
+         * @return the TIDs identifying the locations where the records were stored, in the order of the records
+         */
+        std::vector<TID> insertBatch(const std::vector<Record>& records);
+
         /**
          * Deletes a record from the slotted page segment.
          * @param tid the TID identifying the record to delete.
@@ -58,6 +81,29 @@ namespace simpledb {
          */
         Record lookup(TID tid);
 
+        /**
+         * Looks up the read-only record identified by the supplied TID without copying it, the view borrows the record from its page.
+         * The page stays fixed shared by the supplied guard, the view is valid until the guard is unfixed or used for another lookup.
+         * A large record is read from its extent into the supplied buffer and the view refers to the buffer.
+         * In mapped mode, the view borrows the record from the mapping and the guard stays empty.
+         * A guard already holding the page of the record keeps it without fixing it again, so lookups in page order fix each page once.
+         * Random point lookups are faster with the copying lookup, it reads the page optimistically instead of fixing it.
+         * @param tid the TID identifying the record to look up
+         * @param bufferFrame the guard holding the page of the record, a different page it held before is unfixed
+         * @param buffer the buffer for a large record
+         * @return the view of the record identified by the supplied TID; an empty view, if it doesn't exist
+         */
+        RecordView lookup(TID tid, PageGuard& bufferFrame, Record& buffer);
+
+        /**
+         * Looks up the read-only records identified by many TIDs, e.g. the TIDs of an index range.
+         * With direct I/O, the pages of the TIDs are fixed in batches, so the pages that aren't in memory are read at once.
+         * Otherwise the records are looked up one by one, the page cache serves single reads faster than a batch.
+         * @param tids the TIDs identifying the records to look up
+         * @return the records in the order of the TIDs; empty records for TIDs that don't exist
+         */
+        std::vector<Record> lookup(const std::vector<TID>& tids);
+
         /**
          * Updates the record identified by the supplied TID with the data of the supplied record.
          * @param tid the TID identifying the record.
@@ -66,22 +112,137 @@ namespace simpledb {
          */
         bool update(TID tid, const Record& record);
 
+        /**
+         * Vacuums pages of the segment: redirected records are moved back to the pages of their TIDs, if they have enough space again,
+         * and pages with space between their items are compacted, pages in the wide format of older segments are converted to the compact format.
+         * Only pages that need it are locked.
+         * This method is thread-safe.
+         * @param firstPage the first page
+         * @param count the maximum number of pages
+         * @return a tuple of the page to continue with, or 0 at the end of the segment, and the number of modified pages
+         */
+        std::tuple<uint64_t, uint64_t> vacuum(uint64_t firstPage, uint64_t count);
+
         /**
          * @return iterator to iterate over all slotted page records
          */
         std::unique_ptr<iterator> range();
 
     private:
+        static constexpr uint64_t BULK_PAGES = 256; // number of pages written with one write by a bulk load
+
         uint64_t _segmentId; // the segment id
+        uint64_t _pageSize; // the size of a page in bytes
+        bool _inventory; // true, if the segment has free space inventory pages; false, if it's of an older version
         std::shared_ptr<SegmentManager> _segmentManager; // the segment manager
         std::shared_ptr<BufferManager> _bufferManager; // the buffer manager
+        std::unique_ptr<MappedFile> _mapping; // the mapping of the segment file in mapped mode; nullptr, if the pages are fixed
+        std::array<std::atomic<uint64_t>, FSIPage::CLASSES> _searchHints; // per free space class, the pages before the hint have a lower class; never decreasing with the class
+        boost::mutex _vacuumMutex; // mutex for vacuuming, so only one vacuum holds two pages at a time
+
+        /**
+         * Looks up a record in mapped mode. The pages don't change, so they are read without validation.
+         * @param tid the TID identifying the record
+         * @return the record; an empty record, if it doesn't exist
+         */
+        Record lookupMapped(TID tid);
+
+        /**
+         * Looks up a record in mapped mode without copying it, the view borrows the record from the mapping.
+         * @param tid the TID identifying the record
+         * @param buffer the buffer for a large record, it's read from its extent
+         * @return the view of the record; an empty view, if it doesn't exist
+         */
+        RecordView lookupMapped(TID tid, Record& buffer);
 
         /**
-         * Searches for a page with enough space to store a record with the supplied size.
+         * Searches for a page with enough space to store a record with the supplied size in the free space inventory.
+         * The segment is extended, if no page has enough space.
          * @param size the needed size in bytes
-         * @return a tuple of page id, buffer frame pointer and page pointer
+         * @return a tuple of page id, buffer frame pointer and page pointer, the page is fixed exclusively
+         */
+        std::tuple<uint64_t, PageGuard, SPPage*> searchFreeSpace(uint64_t size);
+
+        /**
+         * Searches the pages of a segment without inventory for a page with enough space to store a record with the supplied size.
+         * The segment is extended, if no page has enough space.
+         * @param size the needed size in bytes
+         * @return a tuple of page id, buffer frame pointer and page pointer, the page is fixed exclusively
+         */
+        std::tuple<uint64_t, PageGuard, SPPage*> searchPages(uint64_t size);
+
+        /**
+         * Updates the free space class of a modified page in the free space inventory.
+         * The page must be fixed exclusively, the inventory page is fixed after it.
+         * @param pageId the page id
+         * @param page the page
+         */
+        void updateFreeSpace(uint64_t pageId, const SPPage* page);
+
+        /**
+         * Lowers the search hints of the classes up to the class of a page, after the page got more free space.
+         * @param pageId the page id
+         * @param spaceClass the free space class of the page
+         */
+        void lowerSearchHints(uint64_t pageId, uint8_t spaceClass);
+
+        /**
+         * Raises the search hints of a class and the classes above it, after a search didn't find a page before a page id.
+         * A page that gets free space concurrently may be skipped until it is modified again, that only wastes space.
+         * @param pageId the page id
+         * @param spaceClass the class, the pages before the page id have a lower class
+         */
+        void raiseSearchHints(uint64_t pageId, uint8_t spaceClass);
+
+        /**
+         * @param pageId the page id
+         * @return true, if the page is a free space inventory page; false, if it holds records
+         */
+        bool isFSIPage(uint64_t pageId) const {
+            return (_inventory && FSIPage::isFSIPage(pageId, _pageSize));
+        }
+
+        /**
+         * @param record the record
+         * @return true, if the record doesn't fit on a page and must be stored in an extent; false, otherwise
+         */
+        bool isLarge(const Record& record) {
+            return (record.length() > SPPage::maxRecordLength(_pageSize));
+        }
+
+        /**
+         * @param page the page, fixed exclusively
+         * @param slotId the slot id
+         * @param tid the original TID
+         * @return true, if the slot holds the record redirected from the TID; false, otherwise
+         */
+        bool isRedirectedFrom(SPPage* page, SlotId slotId, TID tid);
+
+        /**
+         * Moves a redirected record back to the page of its TID, if the page has enough space again.
+         * The page of the TID must be fixed exclusively. The pages are fixed in page order like a batch does,
+         * so if the record is on a lower page, the page of the TID is unfixed and fixed again after it.
+         * @param tid the TID of the redirect
+         * @param bufferFrame the guard of the page of the TID, it might hold another frame afterwards
+         * @param isDirty true, if the page of the TID was modified before; false, otherwise
+         * @return true, if the record was moved; false, otherwise
+         */
+        bool moveBack(TID tid, PageGuard& bufferFrame, bool isDirty);
+
+        /**
+         * Stores a large record in a new extent.
+         * @param record the record
+         * @return the extent header to store on the page
+         */
+        Record writeExtent(const Record& record);
+
+        /**
+         * Frees the extent of a large record, if the slot holds an extent header.
+         * The page must be fixed exclusively.
+         * @param page the page
+         * @param slot the slot
          */
-        std::tuple<uint64_t, std::shared_ptr<BufferFrame>, SPPage*> searchFreeSpace(uint64_t size);
+        void freeExtent(SPPage* page, SPSlot& slot);
 
         /**
          * Extends a segment to the supplied size.
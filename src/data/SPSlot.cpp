@@ -2,4 +2,10 @@
 #include "SPSlot.hpp"
 
 namespace simpledb {
+
+    constexpr uint64_t SPSlot::COMPACT_BITS;
+    constexpr uint16_t SPSlot::VALUE_MASK;
+    constexpr uint16_t SPSlot::ON_PAGE;
+    constexpr uint16_t SPSlot::REDIRECTED;
+    constexpr uint16_t SPSlot::EXTENT;
 }
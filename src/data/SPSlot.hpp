@@ -2,27 +2,41 @@
 #ifndef SIMPLEDB_DATA_SPSLOT_HPP
 #define	SIMPLEDB_DATA_SPSLOT_HPP
 
+#include <cassert>
 #include <cstdint>
 
 namespace simpledb {
 
     /**
-     * Slot implementation for slotted pages.
+     * Slot implementation for slotted pages, refers to a slot in the slot array of a page.
+     * Pages in the compact format pack the offset and the length into 16 bits each, with the flags in their upper bits.
+     * Pages in the wide format (written before the compact format existed, or larger than the compact format allows) use 64 bits each.
      */
     class SPSlot {
     public:
-        SPSlot() = delete;
-        ~SPSlot() = delete;
+        static constexpr uint64_t COMPACT_BITS = 14; // bits of the offset and the length in the compact format
 
-        SPSlot(const SPSlot& orig) = delete;
-        SPSlot& operator=(const SPSlot& orig) = delete;
+        /**
+         * @param slot the slot in the slot array of the page
+         * @param compact true, if the page is in the compact format; false, if it's in the wide format
+         */
+        SPSlot(char* slot, bool compact) : _slot(slot), _compact(compact) {
+        }
+
+        /**
+         * @param compact true, for the compact format; false, for the wide format
+         * @return the size of a slot in the slot array in bytes
+         */
+        static uint64_t size(bool compact) {
+            return (compact ? sizeof (CompactSlot) : sizeof (WideSlot));
+        }
 
         /**
          * @return true, if the item addressed by the slot is on the current page;
          * false, if it was redirected (then the data of the item contains the TID of the redirect)
          */
         bool isOnPage() const {
-            return _onPage;
+            return (_compact ? (compactSlot()->offset & ON_PAGE) != 0 : wideSlot()->onPage);
         }
 
         /**
@@ -30,51 +44,118 @@ namespace simpledb {
          * (then the original TID is prepended to the data item); false, otherwise
          */
         bool isRedirected() const {
-            return _redirected;
+            return (_compact ? (compactSlot()->offset & REDIRECTED) != 0 : wideSlot()->redirected);
+        }
+
+        /**
+         * @return true, if the item is the header of a large record stored in an extent; false, if it's the record itself
+         */
+        bool isExtent() const {
+            return (_compact ? (compactSlot()->length & EXTENT) != 0 : wideSlot()->extent);
         }
 
         /**
          * @return true, if the slot is free and doesn't point to a data item
          */
         bool isFree() const {
-            return _offset == 0 && _length == 0;
+            return offset() == 0 && length() == 0;
         }
 
         /**
          * @return the offset of the data item relative to the beginning of the page
          */
         uint64_t offset() const {
-            return _offset;
+            return (_compact ? compactSlot()->offset & VALUE_MASK : wideSlot()->offset);
         }
 
         /**
          * @return the length of the data item
          */
         uint64_t length() const {
-            return _length;
+            return (_compact ? compactSlot()->length & VALUE_MASK : wideSlot()->length);
         }
 
         void setOnPage(bool onPage) {
-            _onPage = onPage;
+            if (_compact) {
+                setFlag(compactSlot()->offset, ON_PAGE, onPage);
+            } else {
+                wideSlot()->onPage = onPage;
+            }
         }
 
         void setRedirected(bool redirected) {
-            _redirected = redirected;
+            if (_compact) {
+                setFlag(compactSlot()->offset, REDIRECTED, redirected);
+            } else {
+                wideSlot()->redirected = redirected;
+            }
+        }
+
+        void setExtent(bool extent) {
+            if (_compact) {
+                setFlag(compactSlot()->length, EXTENT, extent);
+            } else {
+                wideSlot()->extent = extent;
+            }
         }
 
         void setOffset(uint64_t offset) {
-            _offset = offset;
+            if (_compact) {
+                assert(offset <= VALUE_MASK);
+                compactSlot()->offset = static_cast<uint16_t> ((compactSlot()->offset & ~VALUE_MASK) | offset);
+            } else {
+                wideSlot()->offset = offset;
+            }
         }
 
         void setLength(uint64_t length) {
-            _length = length;
+            if (_compact) {
+                assert(length <= VALUE_MASK);
+                compactSlot()->length = static_cast<uint16_t> ((compactSlot()->length & ~VALUE_MASK) | length);
+            } else {
+                wideSlot()->length = length;
+            }
         }
 
     private:
-        bool _onPage;
-        bool _redirected;
-        uint64_t _offset;
-        uint64_t _length;
+        static constexpr uint16_t VALUE_MASK = (1 << COMPACT_BITS) - 1;
+        static constexpr uint16_t ON_PAGE = 1 << COMPACT_BITS; // flag in the offset
+        static constexpr uint16_t REDIRECTED = 1 << (COMPACT_BITS + 1); // flag in the offset
+        static constexpr uint16_t EXTENT = 1 << COMPACT_BITS; // flag in the length
+
+        /**
+         * Slot in the wide format.
+         */
+        struct WideSlot {
+            bool onPage;
+            bool redirected;
+            bool extent;
+            uint64_t offset;
+            uint64_t length;
+        };
+
+        /**
+         * Slot in the compact format, the flags are in the upper bits of the offset and the length.
+         */
+        struct CompactSlot {
+            uint16_t offset;
+            uint16_t length;
+        };
+
+        static void setFlag(uint16_t& field, uint16_t flag, bool value) {
+            field = static_cast<uint16_t> (value ? (field | flag) : (field & ~flag));
+        }
+
+        WideSlot* wideSlot() const {
+            return reinterpret_cast<WideSlot *> (_slot);
+        }
+
+        CompactSlot* compactSlot() const {
+            return reinterpret_cast<CompactSlot *> (_slot);
+        }
+
+        char* _slot;
+        bool _compact;
     };
 }
 
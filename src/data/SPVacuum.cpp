@@ -0,0 +1,36 @@
+
+#include "SPVacuum.hpp"
+
+namespace simpledb {
+
+    constexpr uint64_t SPVacuum::VACUUM_INTERVAL;
+    constexpr uint64_t SPVacuum::VACUUM_BATCH;
+
+    SPVacuum::SPVacuum(SPSegment& segment, uint64_t interval) : _segment(segment), _interval(interval), _vacuumedPages(0), _mutex(), _condition(), _stop(false), _thread(&SPVacuum::run, this) {
+    }
+
+    SPVacuum::~SPVacuum() {
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _stop = true;
+            _condition.notify_all();
+        }
+        _thread.join();
+    }
+
+    void SPVacuum::run() {
+        uint64_t page = 0;
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (!_stop) {
+            lock.unlock();
+            uint64_t vacuumedPages;
+            std::tie(page, vacuumedPages) = _segment.vacuum(page, VACUUM_BATCH);
+            _vacuumedPages.fetch_add(vacuumedPages);
+            lock.lock();
+
+            if (!_stop) {
+                _condition.timed_wait(lock, boost::posix_time::milliseconds(_interval));
+            }
+        }
+    }
+}
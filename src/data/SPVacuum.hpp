@@ -0,0 +1,68 @@
+
+#ifndef SIMPLEDB_DATA_SPVACUUM_HPP
+#define	SIMPLEDB_DATA_SPVACUUM_HPP
+
+#include "SPSegment.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace simpledb {
+
+    /**
+     * Thread that vacuums a slotted pages segment in the background.
+     * It walks over the segment in batches of pages and sleeps between them, so it doesn't compete with the queries for the pages.
+     */
+    class SPVacuum {
+    public:
+
+        /**
+         * Starts the vacuum thread.
+         * @param segment the segment, it must outlive the vacuum
+         * @param interval time in ms to sleep between two batches
+         */
+        explicit SPVacuum(SPSegment& segment, uint64_t interval = VACUUM_INTERVAL);
+
+        /**
+         * Stops the vacuum thread and waits for it to finish its current batch.
+         */
+        ~SPVacuum();
+
+        SPVacuum(const SPVacuum& orig) = delete;
+        SPVacuum& operator=(const SPVacuum& orig) = delete;
+
+        /**
+         * This method is thread-safe.
+         * @return the number of pages modified by the vacuum so far
+         */
+        uint64_t vacuumedPages() const {
+            return _vacuumedPages.load();
+        }
+
+    private:
+        static constexpr uint64_t VACUUM_INTERVAL = 100; // time in ms the vacuum thread sleeps between two batches
+        static constexpr uint64_t VACUUM_BATCH = 64; // number of pages vacuumed in one batch
+
+        SPSegment& _segment; // the segment
+        uint64_t _interval; // time in ms to sleep between two batches
+        std::atomic<uint64_t> _vacuumedPages; // number of pages modified so far
+
+        boost::mutex _mutex; // mutex for sleeping and stopping
+        boost::condition_variable _condition; // wakes up the vacuum thread to stop
+        bool _stop; // true, if the vacuum thread should terminate
+        boost::thread _thread; // the vacuum thread
+
+        /**
+         * Main loop of the vacuum thread.
+         */
+        void run();
+    };
+}
+
+#endif	/* SIMPLEDB_DATA_SPVACUUM_HPP */
+
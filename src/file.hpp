@@ -3,5 +3,7 @@
 #define	SIMPLEDB_FILE_HPP
 
 #include "file/FileManager.hpp"
+#include "file/IOBatch.hpp"
+#include "file/MappedFile.hpp"
 
 #endif	/* SIMPLEDB_FILE_HPP */
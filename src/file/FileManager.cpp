@@ -1,33 +1,225 @@
 
 #include "FileManager.hpp"
 
+#include "IOUringBackend.hpp"
+#include "ThreadPoolBackend.hpp"
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
 namespace simpledb {
 
+    constexpr uint64_t FileManager::DIRECT_IO_ALIGNMENT;
+    constexpr uint64_t FileManager::MAX_WRITE_RUN;
+    constexpr uint64_t FileManager::MAX_FILES;
+
+    FileManager::FileManager(std::string path, IOBackendType backendType, bool directIO, Statistics* statistics) : _path(path), _fileHandles(new FileHandle[MAX_FILES]), _mutex(), _backend(initBackend(backendType)), _directIO(directIO), _statistics(statistics) {
+        for (uint64_t i = 0; i < MAX_FILES; ++i) {
+            _fileHandles[i].fd.store(-1, std::memory_order_relaxed);
+            _fileHandles[i].users.store(0, std::memory_order_relaxed);
+        }
+    }
+
     FileManager::~FileManager() {
-        for (auto i : _fileHandles) {
-            ::close(i.second);
-            // TODO: error handling
+        for (uint64_t i = 0; i < MAX_FILES; ++i) {
+            if (isOpen(i)) {
+                ::close(_fileHandles[i].fd.load());
+                // TODO: error handling
+            }
         }
     }
 
     void FileManager::read(PageId pageId, const uint64_t PAGE_SIZE, void *data) {
-        if (!isOpen(pageId.segment)) {
-            open(pageId.segment);
+        FileHandleGuard file(*this, pageId.segment);
+
+        // unaligned memory in direct mode? -> read through an aligned buffer
+        std::unique_ptr<char, void (*)(void*)> buffer(nullptr, free);
+        if (!isAligned(data, PAGE_SIZE, pageId.page * PAGE_SIZE)) {
+            buffer = alignedBuffer(PAGE_SIZE);
         }
 
-        int res = ::pread(_fileHandles.at(pageId.segment), data, PAGE_SIZE, pageId.page * PAGE_SIZE);
+        uint64_t start = _statistics ? Statistics::now() : 0;
+        int res = ::pread(file.fd(), buffer ? buffer.get() : data, PAGE_SIZE, pageId.page * PAGE_SIZE);
         assert(res > -1);
         // TODO: error handling
+
+        if (buffer) {
+            memcpy(data, buffer.get(), PAGE_SIZE);
+        }
+
+        if (_statistics) {
+            _statistics->record(Histogram::readLatency, start);
+            _statistics->add(Counter::reads);
+            _statistics->add(Counter::bytesRead, PAGE_SIZE);
+        }
     }
 
     void FileManager::write(PageId pageId, const uint64_t PAGE_SIZE, void *data) {
-        if (!isOpen(pageId.segment)) {
-            open(pageId.segment);
+        FileHandleGuard file(*this, pageId.segment);
+
+        // unaligned memory in direct mode? -> write through an aligned buffer
+        std::unique_ptr<char, void (*)(void*)> buffer(nullptr, free);
+        if (!isAligned(data, PAGE_SIZE, pageId.page * PAGE_SIZE)) {
+            buffer = alignedBuffer(PAGE_SIZE);
+            memcpy(buffer.get(), data, PAGE_SIZE);
         }
 
-        int res = ::pwrite(_fileHandles.at(pageId.segment), data, PAGE_SIZE, pageId.page * PAGE_SIZE);
+        uint64_t start = _statistics ? Statistics::now() : 0;
+        int res = ::pwrite(file.fd(), buffer ? buffer.get() : data, PAGE_SIZE, pageId.page * PAGE_SIZE);
         assert(res > -1);
         // TODO: error handling
+
+        if (_statistics) {
+            _statistics->record(Histogram::writeLatency, start);
+            _statistics->add(Counter::writes);
+            _statistics->add(Counter::bytesWritten, PAGE_SIZE);
+        }
+    }
+
+    void FileManager::readPages(PageId firstPage, const uint64_t PAGE_SIZE, uint64_t length, void *data) {
+        FileHandleGuard file(*this, firstPage.segment);
+
+        // unaligned memory or length in direct mode? -> read whole blocks through an aligned buffer
+        std::unique_ptr<char, void (*)(void*)> buffer(nullptr, free);
+        uint64_t ioLength = length;
+        if (!isAligned(data, length, firstPage.page * PAGE_SIZE)) {
+            ioLength = (length + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+            buffer = alignedBuffer(ioLength);
+        }
+        char *target = buffer ? buffer.get() : reinterpret_cast<char*> (data);
+
+        // the kernel might transfer less than requested, continue until everything is read or the file ends
+        uint64_t start = _statistics ? Statistics::now() : 0;
+        uint64_t done = 0;
+        while (done < ioLength) {
+            ssize_t res = ::pread(file.fd(), target + done, ioLength - done, firstPage.page * PAGE_SIZE + done);
+            assert(res > -1);
+            // TODO: error handling
+            if (res <= 0) {
+                break;
+            }
+            done += res;
+        }
+        done = std::min(done, length);
+
+        if (buffer) {
+            memcpy(data, buffer.get(), done);
+        }
+
+        if (_statistics) {
+            _statistics->record(Histogram::readLatency, start);
+            _statistics->add(Counter::reads);
+            _statistics->add(Counter::bytesRead, done);
+        }
+    }
+
+    void FileManager::writePages(PageId firstPage, const uint64_t PAGE_SIZE, uint64_t length, const void *data) {
+        FileHandleGuard file(*this, firstPage.segment);
+
+        // unaligned memory or length in direct mode? -> write whole blocks through an aligned buffer, padded with zeros
+        std::unique_ptr<char, void (*)(void*)> buffer(nullptr, free);
+        uint64_t ioLength = length;
+        if (!isAligned(data, length, firstPage.page * PAGE_SIZE)) {
+            ioLength = (length + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+            buffer = alignedBuffer(ioLength);
+            memcpy(buffer.get(), data, length);
+            memset(buffer.get() + length, 0, ioLength - length);
+        }
+        const char *source = buffer ? buffer.get() : reinterpret_cast<const char*> (data);
+
+        uint64_t start = _statistics ? Statistics::now() : 0;
+        uint64_t done = 0;
+        while (done < ioLength) {
+            ssize_t res = ::pwrite(file.fd(), source + done, ioLength - done, firstPage.page * PAGE_SIZE + done);
+            assert(res > 0);
+            // TODO: error handling
+            done += res;
+        }
+
+        if (_statistics) {
+            _statistics->record(Histogram::writeLatency, start);
+            _statistics->add(Counter::writes);
+            _statistics->add(Counter::bytesWritten, length);
+        }
+    }
+
+    void FileManager::submit(IOBatch& batch) {
+        for (IORequest &request : batch.requests()) {
+            request.fd = acquire(request.pageId.segment); // released on completion
+            assert(isAligned(request.data, request.size, request.pageId.page * request.size)); // batches are never copied
+
+            // batched requests complete asynchronously, they are counted but not timed
+            if (_statistics) {
+                _statistics->add(request.write ? Counter::writes : Counter::reads);
+                _statistics->add(request.write ? Counter::bytesWritten : Counter::bytesRead, request.size);
+            }
+        }
+
+        _backend->submit(batch);
+    }
+
+    void FileManager::writeCoalesced(IOBatch& batch) {
+        std::vector<IORequest> &requests = batch.requests();
+        std::sort(requests.begin(), requests.end(), [](const IORequest & a, const IORequest & b) {
+            return (a.pageId.segment < b.pageId.segment || (a.pageId.segment == b.pageId.segment && a.pageId.page < b.pageId.page));
+        });
+
+        std::vector<iovec> regions;
+        uint64_t begin = 0;
+        while (begin < requests.size()) {
+            const IORequest &first = requests[begin];
+            assert(first.write);
+            assert(isAligned(first.data, first.size, first.pageId.page * first.size)); // batches are never copied
+
+            // collect the run of adjacent pages following the first one
+            regions.clear();
+            regions.push_back(iovec{first.data, first.size});
+            uint64_t end = begin + 1;
+            while (end < requests.size() && end - begin < MAX_WRITE_RUN && requests[end].pageId.segment == first.pageId.segment && requests[end].pageId.page == first.pageId.page + (end - begin) && requests[end].size == first.size) {
+                assert(requests[end].write);
+                assert(isAligned(requests[end].data, requests[end].size, requests[end].pageId.page * requests[end].size));
+                regions.push_back(iovec{requests[end].data, requests[end].size});
+                ++end;
+            }
+
+            FileHandleGuard file(*this, first.pageId.segment);
+            uint64_t start = _statistics ? Statistics::now() : 0;
+            uint64_t written = writeVectored(file.fd(), regions, first.pageId.page * first.size);
+
+            if (_statistics) {
+                _statistics->record(Histogram::writeLatency, start);
+                _statistics->add(Counter::writes, end - begin);
+                _statistics->add(Counter::bytesWritten, written);
+            }
+            begin = end;
+        }
+    }
+
+    void FileManager::complete(IOBatch& batch) {
+        _backend->complete(batch);
+
+        for (IORequest &request : batch.requests()) {
+            release(request.pageId.segment);
+        }
+    }
+
+    void FileManager::sync() {
+        for (uint64_t i = 0; i < MAX_FILES; ++i) {
+            sync(i);
+        }
+    }
+
+    void FileManager::sync(uint64_t segmentId) {
+        if (isOpen(segmentId)) {
+            FileHandleGuard file(*this, segmentId);
+            int res = ::fdatasync(file.fd());
+            assert(res > -1);
+            // TODO: error handling
+        }
     }
 
     void FileManager::create(uint64_t segmentId) {
@@ -36,11 +228,7 @@ namespace simpledb {
         assert(!isOpen(segmentId));
         assert(true /* TODO: assert file doesn't exist */);
 
-        int fd = ::open(getFileName(segmentId).c_str(), O_RDWR | O_CREAT | O_SYNC, S_IRUSR | S_IWUSR);
-        assert(fd > -1);
-        // TODO: error handling
-
-        _fileHandles[segmentId] = fd;
+        _fileHandles[segmentId].fd.store(openFile(segmentId, true));
     }
 
     void FileManager::remove(uint64_t segmentId) {
@@ -54,17 +242,39 @@ namespace simpledb {
     }
 
     void FileManager::truncate(uint64_t segmentId, const uint64_t PAGE_SIZE, uint64_t size) {
-        boost::lock_guard<boost::mutex> lock(_mutex);
+        FileHandleGuard file(*this, segmentId);
+        int res = ::ftruncate(file.fd(), size * PAGE_SIZE);
+        assert(res > -1);
+        // TODO: error handling
+    }
 
-        if (isOpen(segmentId)) {
-            int res = ::ftruncate(_fileHandles.at(segmentId), size * PAGE_SIZE);
-            assert(res > -1);
-            // TODO: error handling
+    std::unique_ptr<MappedFile> FileManager::map(uint64_t segmentId, uint64_t length, MapAdvice advice) {
+        FileHandleGuard file(*this, segmentId);
+        return std::unique_ptr<MappedFile>(new MappedFile(file.fd(), length, advice));
+    }
+
+    std::unique_ptr<IOBackend> FileManager::initBackend(IOBackendType backendType) {
+        if (backendType == IOBackendType::uring || (backendType == IOBackendType::automatic && IOUringBackend::isSupported())) {
+            assert(IOUringBackend::isSupported());
+            return std::unique_ptr<IOBackend>(new IOUringBackend());
         }
-        else {
-            int res = ::truncate(getFileName(segmentId).c_str(), size * PAGE_SIZE);
-            assert(res > -1);
-            // TODO: error handling
+        return std::unique_ptr<IOBackend>(new ThreadPoolBackend());
+    }
+
+    int FileManager::acquire(uint64_t segmentId) {
+        assert(segmentId < MAX_FILES); // TODO: error handling
+        FileHandle &handle = _fileHandles[segmentId];
+
+        while (true) {
+            // announce the use before reading the handle, a thread closing the file waits for us or we see it closed
+            handle.users.fetch_add(1);
+            int fd = handle.fd.load();
+            if (fd > -1) {
+                return fd;
+            }
+            handle.users.fetch_sub(1);
+
+            open(segmentId);
         }
     }
 
@@ -75,11 +285,53 @@ namespace simpledb {
             return;
         }
 
-        int fd = ::open(getFileName(segmentId).c_str(), O_RDWR | O_SYNC);
+        _fileHandles[segmentId].fd.store(openFile(segmentId, false));
+    }
+
+    uint64_t FileManager::writeVectored(int fd, std::vector<iovec>& regions, uint64_t offset) {
+        // the kernel might write less than requested, skip the written regions and continue with the rest
+        uint64_t written = 0;
+        iovec *region = regions.data();
+        uint64_t count = regions.size();
+        while (count > 0) {
+            ssize_t res = ::pwritev(fd, region, count, offset + written);
+            assert(res > 0);
+            // TODO: error handling
+            written += res;
+
+            while (count > 0 && static_cast<uint64_t> (res) >= region->iov_len) {
+                res -= region->iov_len;
+                ++region;
+                --count;
+            }
+            if (count > 0) {
+                region->iov_base = reinterpret_cast<char*> (region->iov_base) + res;
+                region->iov_len -= res;
+            }
+        }
+        return written;
+    }
+
+    int FileManager::openFile(uint64_t segmentId, bool create) {
+        int flags = O_RDWR | (create ? O_CREAT : 0);
+
+        int fd = ::open(getFileName(segmentId).c_str(), flags | (_directIO ? O_DIRECT : O_SYNC), S_IRUSR | S_IWUSR);
+        if (fd < 0 && _directIO && errno == EINVAL) { // no O_DIRECT support
+            fd = ::open(getFileName(segmentId).c_str(), flags, S_IRUSR | S_IWUSR);
+        }
         assert(fd > -1);
         // TODO: error handling
 
-        _fileHandles[segmentId] = fd;
+        return fd;
+    }
+
+    std::unique_ptr<char, void (*)(void*)> FileManager::alignedBuffer(uint64_t length) {
+        void *buffer = nullptr;
+        int res = posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, (length + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT);
+        assert(res == 0);
+        // TODO: error handling
+
+        return std::unique_ptr<char, void (*)(void*)>(reinterpret_cast<char*> (buffer), free);
     }
 
     void FileManager::close(uint64_t segmentId) {
@@ -93,8 +345,12 @@ namespace simpledb {
             return;
         }
 
-        int fd = _fileHandles[segmentId];
-        _fileHandles.erase(fd);
+        // hide the handle, then wait for the threads still doing I/O with it, so the handle isn't reused under them
+        FileHandle &handle = _fileHandles[segmentId];
+        int fd = handle.fd.exchange(-1);
+        while (handle.users.load() > 0) {
+            boost::this_thread::yield();
+        }
 
         int res = ::close(fd);
         assert(res > -1);
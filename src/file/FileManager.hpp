@@ -2,16 +2,24 @@
 #ifndef SIMPLEDB_FILE_FILEMANAGER_HPP
 #define	SIMPLEDB_FILE_FILEMANAGER_HPP
 
+#include "IOBackend.hpp"
+#include "IOBatch.hpp"
+#include "MappedFile.hpp"
 #include "buffer/PageId.hpp"
+#include "buffer/Statistics.hpp"
 
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/lock_guard.hpp>
 
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -20,21 +28,44 @@ namespace simpledb {
 
     /**
      * File manager handles all file operations.
+     * Files are opened with O_SYNC, so each write is durable when it returns. In direct mode they are opened with O_DIRECT instead,
+     * so pages bypass the kernel page cache and aren't cached twice; writes are durable after the next sync then.
      * @param path the path where all files reside
      */
     class FileManager {
     public:
+        static constexpr uint64_t DIRECT_IO_ALIGNMENT = 4096; // alignment of memory, offsets and lengths of direct I/O in bytes
 
-        explicit FileManager(std::string path) : _path(path) {
-        };
+        /**
+         * @param path the path where all files reside
+         * @param backendType the backend for batched I/O
+         * @param directIO true, to bypass the kernel page cache with O_DIRECT; false, to write synchronously with O_SYNC
+         * @param statistics the statistics to count the reads and writes in; nullptr, to count nothing
+         */
+        explicit FileManager(std::string path, IOBackendType backendType = IOBackendType::automatic, bool directIO = false, Statistics* statistics = nullptr);
         ~FileManager();
 
         FileManager(const FileManager& orig) = delete;
         FileManager& operator=(const FileManager& orig) = delete;
 
+        /**
+         * @return true, if the files are opened with O_DIRECT; false, otherwise
+         */
+        bool isDirectIO() const {
+            return _directIO;
+        }
+
+        /**
+         * Allocates memory aligned to DIRECT_IO_ALIGNMENT, e.g. for reads and writes of unaligned memory in direct mode.
+         * @param length the length in bytes, rounded up to a multiple of the alignment
+         * @return the memory, release it with free
+         */
+        static std::unique_ptr<char, void (*)(void*)> alignedBuffer(uint64_t length);
+
         /**
          * Reads a page from a file to memory.
          * Files are opened transparently.
+         * In direct mode, memory that isn't aligned to DIRECT_IO_ALIGNMENT is read through an aligned buffer.
          * @param pageId the page id identifies the file and page
          * @param PAGE_SIZE the size of a page in bytes
          * @param data the pointer to the memory region for writing
@@ -44,12 +75,75 @@ namespace simpledb {
         /**
          * Writes a page from memory to a file.
          * Files are opened transparently.
+         * In direct mode, memory that isn't aligned to DIRECT_IO_ALIGNMENT is written through an aligned buffer.
          * @param pageId the page id identifies the file and page
          * @param PAGE_SIZE the size of a page in bytes
          * @param data
          */
         void write(PageId pageId, const uint64_t PAGE_SIZE, void *data);
 
+        /**
+         * Reads consecutive pages from a file to memory with one read, e.g. the extent of a large record.
+         * Files are opened transparently.
+         * In direct mode, memory that isn't aligned or a length that isn't a multiple of DIRECT_IO_ALIGNMENT is read through an aligned buffer.
+         * @param firstPage the page id of the first page
+         * @param PAGE_SIZE the size of a page in bytes
+         * @param length the number of bytes to read
+         * @param data the pointer to the memory region for writing
+         */
+        void readPages(PageId firstPage, const uint64_t PAGE_SIZE, uint64_t length, void *data);
+
+        /**
+         * Writes memory to consecutive pages of a file with one write, e.g. the extent of a large record.
+         * Files are opened transparently.
+         * In direct mode, memory that isn't aligned or a length that isn't a multiple of DIRECT_IO_ALIGNMENT is written through an aligned buffer,
+         * the rest of the last block is filled with zeros.
+         * @param firstPage the page id of the first page
+         * @param PAGE_SIZE the size of a page in bytes
+         * @param length the number of bytes to write
+         * @param data the pointer to the memory region for reading
+         */
+        void writePages(PageId firstPage, const uint64_t PAGE_SIZE, uint64_t length, const void *data);
+
+        /**
+         * Starts all reads and writes of a batch without waiting for them.
+         * The memory regions of the requests must not be touched until the batch is completed.
+         * In direct mode, they must be aligned to DIRECT_IO_ALIGNMENT, like the buffer frames.
+         * Files are opened transparently.
+         * @param batch the batch
+         */
+        void submit(IOBatch& batch);
+
+        /**
+         * Writes all pages of a batch of writes and waits for them.
+         * The requests are sorted by page id, and runs of adjacent pages of a file are written with one vectored write each.
+         * In direct mode, the memory regions must be aligned to DIRECT_IO_ALIGNMENT, like the buffer frames.
+         * Files are opened transparently.
+         * @param batch the batch, it must only contain writes
+         */
+        void writeCoalesced(IOBatch& batch);
+
+        /**
+         * Waits until all reads and writes of a submitted batch are completed.
+         * Must be called by the thread that submitted the batch.
+         * @param batch the batch
+         */
+        void complete(IOBatch& batch);
+
+        /**
+         * Flushes all writes to the open files to disk, e.g. when the buffer manager is flushed.
+         * In direct mode, writes are only durable after a sync.
+         * This method is thread-safe.
+         */
+        void sync();
+
+        /**
+         * Flushes all writes to the file of a segment to disk, if it is open.
+         * This method is thread-safe.
+         * @param segmentId the segment id
+         */
+        void sync(uint64_t segmentId);
+
         /**
          * Creates a file for the given segment id.
          * This method is thread-safe.
@@ -72,10 +166,119 @@ namespace simpledb {
          */
         void truncate(uint64_t segmentId, const uint64_t PAGE_SIZE, uint64_t size);
 
+        /**
+         * Maps the file of a segment read-only, so its pages can be read without copying them into frames.
+         * Writes to the file (also in direct mode) are visible through the mapping once they're completed.
+         * This method is thread-safe.
+         * @param segmentId the segment id
+         * @param length the number of bytes to map, the file must not be shorter
+         * @param advice the access pattern of the mapping
+         * @return the mapping
+         */
+        std::unique_ptr<MappedFile> map(uint64_t segmentId, uint64_t length, MapAdvice advice);
+
     private:
+        static constexpr uint64_t MAX_WRITE_RUN = 256; // maximum number of pages written with one vectored write
+        static constexpr uint64_t MAX_FILES = 1 << 16; // number of segments, that can have a file
+
+        /**
+         * The handle of a file and the number of threads doing I/O with it, so it isn't closed while they use it.
+         */
+        struct FileHandle {
+            std::atomic<int> fd; // the file handle; or -1, if the file isn't open
+            std::atomic<uint32_t> users; // number of threads using the file handle
+        };
+
+        /**
+         * Holds the handle of a file for one I/O and releases it afterwards.
+         */
+        class FileHandleGuard {
+        public:
+
+            /**
+             * Acquires the handle of a file, it's opened if necessary.
+             * @param fileManager the file manager
+             * @param segmentId the segment id
+             */
+            FileHandleGuard(FileManager& fileManager, uint64_t segmentId) : _fileManager(fileManager), _segmentId(segmentId), _fd(fileManager.acquire(segmentId)) {
+            }
+
+            ~FileHandleGuard() {
+                _fileManager.release(_segmentId);
+            }
+
+            FileHandleGuard(const FileHandleGuard& orig) = delete;
+            FileHandleGuard& operator=(const FileHandleGuard& orig) = delete;
+
+            int fd() const {
+                return _fd;
+            }
+
+        private:
+            FileManager& _fileManager;
+            uint64_t _segmentId;
+            int _fd;
+        };
+
         std::string _path; // the path where all files reside
-        std::unordered_map<uint64_t, int> _fileHandles; // map: segment id -> file handle
-        boost::mutex _mutex; // mutex for concurrent access
+        std::unique_ptr<FileHandle[]> _fileHandles; // the file handles indexed by segment id, read without locking
+        boost::mutex _mutex; // mutex for opening and closing files
+        std::unique_ptr<IOBackend> _backend; // executes batched I/O
+        bool _directIO; // true, if the files are opened with O_DIRECT
+        Statistics* _statistics; // counts reads and writes; or nullptr
+
+        /**
+         * Creates the backend for batched I/O.
+         * @param backendType the backend type
+         * @return the backend
+         */
+        static std::unique_ptr<IOBackend> initBackend(IOBackendType backendType);
+
+        /**
+         * Writes memory regions to consecutive bytes of a file, continues until all are written.
+         * @param fd the file handle
+         * @param regions the memory regions, they are modified
+         * @param offset the offset of the first region in the file in bytes
+         * @return the number of bytes written
+         */
+        static uint64_t writeVectored(int fd, std::vector<iovec>& regions, uint64_t offset);
+
+        /**
+         * Opens the file of a segment with O_DIRECT or O_SYNC.
+         * File systems that don't support O_DIRECT (e.g. tmpfs) fall back to the page cache, the writes are durable after a sync then.
+         * @param segmentId the segment id
+         * @param create true, to create the file; false, to open an existing file
+         * @return the file handle
+         */
+        int openFile(uint64_t segmentId, bool create);
+
+        /**
+         * @param data a memory region
+         * @param length the length of the region in bytes
+         * @param offset the offset in the file in bytes
+         * @return true, if the region can be read or written directly; false, if it needs an aligned buffer
+         */
+        bool isAligned(const void* data, uint64_t length, uint64_t offset) const {
+            return (!_directIO || (reinterpret_cast<uintptr_t> (data) % DIRECT_IO_ALIGNMENT == 0 && length % DIRECT_IO_ALIGNMENT == 0 && offset % DIRECT_IO_ALIGNMENT == 0));
+        }
+
+        /**
+         * Gets the handle of a file for I/O, the file is opened if necessary.
+         * The file isn't closed until the handle is released. Only opening a file takes the mutex.
+         * This method is thread-safe.
+         * @param segmentId the segment id
+         * @return the file handle
+         */
+        int acquire(uint64_t segmentId);
+
+        /**
+         * Releases a file handle acquired for I/O.
+         * This method is thread-safe.
+         * @param segmentId the segment id
+         */
+        void release(uint64_t segmentId) {
+            _fileHandles[segmentId].users.fetch_sub(1);
+        }
 
         /**
          * Opens a file.
@@ -92,7 +295,7 @@ namespace simpledb {
         void close(uint64_t segmentId);
 
         /**
-         * Closes a file.
+         * Closes a file, after all threads doing I/O with it released its handle.
          * @param segmentId the segment id
          */
         void closeUnsyncronized(uint64_t segmentId);
@@ -103,7 +306,8 @@ namespace simpledb {
          * @return true, if the file is already opened; false, otherwise
          */
         bool isOpen(uint64_t segmentId) {
-            return (_fileHandles.count(segmentId) > 0);
+            assert(segmentId < MAX_FILES); // TODO: error handling
+            return (_fileHandles[segmentId].fd.load() > -1);
         };
 
         /**
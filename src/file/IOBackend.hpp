@@ -0,0 +1,47 @@
+
+#ifndef SIMPLEDB_FILE_IOBACKEND_HPP
+#define	SIMPLEDB_FILE_IOBACKEND_HPP
+
+#include "IOBatch.hpp"
+
+namespace simpledb {
+
+    /**
+     * Selects the backend a file manager uses for batched I/O:
+     * - automatic: io_uring, if the kernel supports it; a thread pool, otherwise
+     * - uring: io_uring with one ring per thread
+     * - threadPool: a pool of threads issuing blocking pread/pwrite calls
+     */
+    enum class IOBackendType {
+        automatic, uring, threadPool
+    };
+
+    /**
+     * Interface for asynchronous batched I/O.
+     * All operations are thread-safe.
+     */
+    class IOBackend {
+    public:
+        IOBackend() = default;
+        virtual ~IOBackend() = default;
+
+        IOBackend(const IOBackend& orig) = delete;
+        IOBackend& operator=(const IOBackend& orig) = delete;
+
+        /**
+         * Starts all requests of a batch without waiting for them.
+         * The file handles of the requests must be set.
+         * @param batch the batch
+         */
+        virtual void submit(IOBatch& batch) = 0;
+
+        /**
+         * Waits until all requests of a submitted batch are completed.
+         * Must be called by the thread that submitted the batch.
+         * @param batch the batch
+         */
+        virtual void complete(IOBatch& batch) = 0;
+    };
+}
+
+#endif	/* SIMPLEDB_FILE_IOBACKEND_HPP */
@@ -0,0 +1,117 @@
+
+#ifndef SIMPLEDB_FILE_IOBATCH_HPP
+#define	SIMPLEDB_FILE_IOBATCH_HPP
+
+#include "buffer/PageId.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace simpledb {
+
+    /**
+     * A single page read or write of a batch.
+     */
+    struct IORequest {
+        PageId pageId; // identifies the file and page
+        uint64_t size; // the size of a page in bytes
+        void *data; // the memory region to read to or write from
+        bool write; // true, for a write; false, for a read
+        int fd; // the file handle, set by the file manager on submit
+
+        IORequest(PageId pageId, uint64_t size, void *data, bool write) : pageId(pageId), size(size), data(data), write(write), fd(-1) {
+        };
+    };
+
+    /**
+     * Batch of page reads and writes that are submitted to the file manager at once and completed together.
+     * A batch must be completed by the thread that submitted it. It can be reused after clear().
+     */
+    class IOBatch {
+    public:
+
+        IOBatch() : _requests(), _pending(0) {
+        };
+
+        ~IOBatch() {
+            assert(isCompleted()); // destructing a batch in flight corrupts memory
+        };
+
+        IOBatch(const IOBatch& orig) = delete;
+        IOBatch& operator=(const IOBatch& orig) = delete;
+
+        /**
+         * Adds a page read to the batch.
+         * @param pageId the page id identifies the file and page
+         * @param PAGE_SIZE the size of a page in bytes
+         * @param data the pointer to the memory region for writing
+         */
+        void read(PageId pageId, const uint64_t PAGE_SIZE, void *data) {
+            assert(isCompleted());
+            _requests.push_back(IORequest(pageId, PAGE_SIZE, data, false));
+        }
+
+        /**
+         * Adds a page write to the batch.
+         * @param pageId the page id identifies the file and page
+         * @param PAGE_SIZE the size of a page in bytes
+         * @param data the pointer to the memory region to write
+         */
+        void write(PageId pageId, const uint64_t PAGE_SIZE, void *data) {
+            assert(isCompleted());
+            _requests.push_back(IORequest(pageId, PAGE_SIZE, data, true));
+        }
+
+        /**
+         * Removes all requests, so the batch can be reused.
+         */
+        void clear() {
+            assert(isCompleted());
+            _requests.clear();
+        }
+
+        bool empty() const {
+            return _requests.empty();
+        }
+
+        uint64_t size() const {
+            return _requests.size();
+        }
+
+        std::vector<IORequest>& requests() {
+            return _requests;
+        }
+
+        /**
+         * @return true, if no request of the batch is in flight
+         */
+        bool isCompleted() const {
+            return (_pending.load(std::memory_order_acquire) == 0);
+        }
+
+        /**
+         * Marks all requests as in flight. Used by the I/O backends on submit.
+         */
+        void setPending() {
+            assert(isCompleted());
+            _pending.store(_requests.size(), std::memory_order_relaxed);
+        }
+
+        /**
+         * Marks one request as completed. Used by the I/O backends.
+         * @return true, if it was the last request in flight; false, otherwise
+         */
+        bool completeRequest() {
+            assert(!isCompleted());
+            return (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1);
+        }
+
+    private:
+        std::vector<IORequest> _requests; // the requests of the batch
+        std::atomic<uint64_t> _pending; // number of requests in flight
+    };
+}
+
+#endif	/* SIMPLEDB_FILE_IOBATCH_HPP */
@@ -0,0 +1,204 @@
+
+#include "IOUringBackend.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace simpledb {
+
+    namespace {
+
+        int ioUringSetup(unsigned entries, io_uring_params *params) {
+            return static_cast<int> (syscall(__NR_io_uring_setup, entries, params));
+        }
+
+        int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+            return static_cast<int> (syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+        }
+    }
+
+    constexpr unsigned IOUringBackend::RING_ENTRIES;
+
+    bool IOUringBackend::isSupported() {
+        static const bool supported = [] {
+            io_uring_params params;
+            memset(&params, 0, sizeof (params));
+            int fd = ioUringSetup(1, &params);
+            if (fd < 0) {
+                return false;
+            }
+            ::close(fd);
+            // IORING_OP_READ and IORING_OP_WRITE need Linux 5.6, which introduced IORING_FEAT_RW_CUR_POS
+            return ((params.features & IORING_FEAT_RW_CUR_POS) != 0);
+        }();
+        return supported;
+    }
+
+    void IOUringBackend::submit(IOBatch& batch) {
+        if (batch.empty()) {
+            return;
+        }
+
+        Ring& r = ring();
+        batch.setPending();
+        for (IORequest &request : batch.requests()) {
+            r.backlog().push_back(std::make_pair(&request, &batch));
+        }
+        r.submitBacklog();
+    }
+
+    void IOUringBackend::complete(IOBatch& batch) {
+        if (batch.isCompleted()) {
+            return;
+        }
+
+        Ring& r = ring();
+        while (true) {
+            r.reap();
+            if (batch.isCompleted()) {
+                return;
+            }
+            r.submitBacklog();
+            r.wait();
+        }
+    }
+
+    IOUringBackend::Ring& IOUringBackend::ring() {
+        if (_rings.get() == nullptr) {
+            _rings.reset(new Ring(RING_ENTRIES));
+            assert(_rings->isValid());
+            // TODO: error handling
+        }
+        return *_rings;
+    }
+
+    IOUringBackend::Ring::Ring(unsigned entries) : _fd(-1), _entries(), _inFlight(0), _sqRing(MAP_FAILED), _sqRingSize(0), _cqRing(MAP_FAILED), _cqRingSize(0), _sqes(nullptr), _sqesSize(0), _backlog() {
+        io_uring_params params;
+        memset(&params, 0, sizeof (params));
+        _fd = ioUringSetup(entries, &params);
+        if (_fd < 0) {
+            return;
+        }
+        _entries = params.sq_entries;
+
+        // map queues, newer kernels map both rings with one mapping
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+        bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+        }
+        _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        assert(_sqRing != MAP_FAILED);
+        _cqRing = singleMmap ? _sqRing : mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+        assert(_cqRing != MAP_FAILED);
+        _sqesSize = params.sq_entries * sizeof (io_uring_sqe);
+        void *sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+        assert(sqes != MAP_FAILED);
+        // TODO: error handling
+        _sqes = reinterpret_cast<io_uring_sqe *> (sqes);
+
+        char *sq = reinterpret_cast<char *> (_sqRing);
+        _sqTail = reinterpret_cast<unsigned *> (sq + params.sq_off.tail);
+        _sqMask = *reinterpret_cast<unsigned *> (sq + params.sq_off.ring_mask);
+        _sqArray = reinterpret_cast<unsigned *> (sq + params.sq_off.array);
+        char *cq = reinterpret_cast<char *> (_cqRing);
+        _cqHead = reinterpret_cast<unsigned *> (cq + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned *> (cq + params.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned *> (cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe *> (cq + params.cq_off.cqes);
+    }
+
+    IOUringBackend::Ring::~Ring() {
+        assert(_inFlight == 0 && _backlog.empty()); // the memory of requests in flight is probably freed already
+
+        if (_sqes != nullptr) {
+            munmap(_sqes, _sqesSize);
+        }
+        if (_cqRing != MAP_FAILED && _cqRing != _sqRing) {
+            munmap(_cqRing, _cqRingSize);
+        }
+        if (_sqRing != MAP_FAILED) {
+            munmap(_sqRing, _sqRingSize);
+        }
+        if (_fd > -1) {
+            ::close(_fd);
+        }
+    }
+
+    void IOUringBackend::Ring::submitBacklog() {
+        // only the submitting thread writes the tail, so no atomic read-modify-write is needed
+        unsigned tail = __atomic_load_n(_sqTail, __ATOMIC_RELAXED);
+        unsigned toSubmit = 0;
+        while (!_backlog.empty() && _inFlight < _entries) {
+            IORequest *request = _backlog.front().first;
+            IOBatch *batch = _backlog.front().second;
+            _backlog.pop_front();
+
+            unsigned index = tail & _sqMask;
+            io_uring_sqe *sqe = &_sqes[index];
+            memset(sqe, 0, sizeof (io_uring_sqe));
+            sqe->opcode = request->write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = request->fd;
+            sqe->addr = reinterpret_cast<uint64_t> (request->data);
+            sqe->len = static_cast<uint32_t> (request->size);
+            sqe->off = request->pageId.page * request->size;
+            sqe->user_data = reinterpret_cast<uint64_t> (batch);
+            _sqArray[index] = index;
+
+            ++tail;
+            ++toSubmit;
+            ++_inFlight;
+        }
+
+        if (toSubmit == 0) {
+            return;
+        }
+
+        // publish the entries to the kernel
+        __atomic_store_n(_sqTail, tail, __ATOMIC_RELEASE);
+        while (toSubmit > 0) {
+            int res = ioUringEnter(_fd, toSubmit, 0, 0);
+            if (res < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            assert(res > 0);
+            // TODO: error handling
+            toSubmit -= res;
+        }
+    }
+
+    void IOUringBackend::Ring::reap() {
+        unsigned head = __atomic_load_n(_cqHead, __ATOMIC_RELAXED);
+        unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; ++head) {
+            io_uring_cqe *cqe = &_cqes[head & _cqMask];
+            assert(cqe->res > -1);
+            // TODO: error handling
+            reinterpret_cast<IOBatch *> (cqe->user_data)->completeRequest();
+            --_inFlight;
+        }
+
+        // hand the entries back to the kernel
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    void IOUringBackend::Ring::wait() {
+        if (_inFlight == 0) {
+            return;
+        }
+
+        int res;
+        do {
+            res = ioUringEnter(_fd, 0, 1, IORING_ENTER_GETEVENTS);
+        } while (res < 0 && errno == EINTR);
+        assert(res > -1);
+        // TODO: error handling
+    }
+}
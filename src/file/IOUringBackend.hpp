@@ -0,0 +1,121 @@
+
+#ifndef SIMPLEDB_FILE_IOURINGBACKEND_HPP
+#define	SIMPLEDB_FILE_IOURINGBACKEND_HPP
+
+#include "IOBackend.hpp"
+#include "IOBatch.hpp"
+
+#include <linux/io_uring.h>
+
+#include <boost/thread/tss.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace simpledb {
+
+    /**
+     * I/O backend using io_uring through the raw system calls.
+     * Each thread gets its own ring, so submitting and completing needs no synchronization.
+     * Batches larger than the ring are submitted in parts while completing.
+     */
+    class IOUringBackend : public IOBackend {
+    public:
+
+        IOUringBackend() : _rings() {
+        };
+
+        virtual ~IOUringBackend() {
+        };
+
+        IOUringBackend(const IOUringBackend& orig) = delete;
+        IOUringBackend& operator=(const IOUringBackend& orig) = delete;
+
+        /**
+         * Checks once whether the kernel supports io_uring (and doesn't forbid it, e.g. by seccomp).
+         * @return true, if io_uring can be used; false, otherwise
+         */
+        static bool isSupported();
+
+        virtual void submit(IOBatch& batch);
+        virtual void complete(IOBatch& batch);
+
+    private:
+        static constexpr unsigned RING_ENTRIES = 64; // number of submission queue entries, also the maximum number of I/Os in flight per thread
+
+        /**
+         * Submission and completion queue of one thread.
+         */
+        class Ring {
+        public:
+            /**
+             * Sets up a ring and maps its queues.
+             * @param entries number of submission queue entries
+             */
+            explicit Ring(unsigned entries);
+
+            /**
+             * Unmaps the queues and closes the ring. All requests must be completed.
+             */
+            ~Ring();
+
+            Ring(const Ring& orig) = delete;
+            Ring& operator=(const Ring& orig) = delete;
+
+            bool isValid() const {
+                return (_fd > -1);
+            }
+
+            /**
+             * Adds requests of the backlog to the submission queue, as long as it has space, and submits them.
+             */
+            void submitBacklog();
+
+            /**
+             * Processes all completions, that are available.
+             */
+            void reap();
+
+            /**
+             * Blocks until at least one request is completed.
+             */
+            void wait();
+
+            std::deque<std::pair<IORequest*, IOBatch*>>& backlog() {
+                return _backlog;
+            }
+
+        private:
+            int _fd; // the ring file handle
+            unsigned _entries; // number of submission queue entries
+            uint64_t _inFlight; // number of submitted requests that aren't completed
+
+            void *_sqRing; // mapped submission queue ring
+            size_t _sqRingSize;
+            void *_cqRing; // mapped completion queue ring, may be the same mapping as the submission queue ring
+            size_t _cqRingSize;
+            io_uring_sqe *_sqes; // mapped submission queue entries
+            size_t _sqesSize;
+
+            unsigned *_sqTail; // accessed with atomic builtins, the kernel reads it concurrently
+            unsigned _sqMask;
+            unsigned *_sqArray;
+            unsigned *_cqHead;
+            unsigned *_cqTail; // accessed with atomic builtins, the kernel writes it concurrently
+            unsigned _cqMask;
+            io_uring_cqe *_cqes;
+
+            std::deque<std::pair<IORequest*, IOBatch*>> _backlog; // requests not submitted yet, as the ring was full
+        };
+
+        boost::thread_specific_ptr<Ring> _rings; // the ring of each thread
+
+        /**
+         * @return the ring of the calling thread, it's created on first use
+         */
+        Ring& ring();
+    };
+}
+
+#endif	/* SIMPLEDB_FILE_IOURINGBACKEND_HPP */
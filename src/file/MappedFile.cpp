@@ -0,0 +1,54 @@
+
+#include "MappedFile.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace simpledb {
+
+    MappedFile::MappedFile(int fd, uint64_t length, MapAdvice advice) : _data(nullptr), _length(length) {
+        if (_length == 0) { // empty files can't be mapped
+            return;
+        }
+
+        void *data = ::mmap(nullptr, _length, PROT_READ, MAP_SHARED, fd, 0);
+        assert(data != MAP_FAILED);
+        // TODO: error handling
+        _data = reinterpret_cast<char*> (data);
+
+        advise(advice);
+    }
+
+    MappedFile::~MappedFile() {
+        if (_data) {
+            ::munmap(_data, _length);
+            // TODO: error handling
+        }
+    }
+
+    void MappedFile::advise(MapAdvice advice) const {
+        if (!_data) {
+            return;
+        }
+
+        int hint = MADV_NORMAL;
+        if (advice == MapAdvice::sequential) {
+            hint = MADV_SEQUENTIAL;
+        } else if (advice == MapAdvice::random) {
+            hint = MADV_RANDOM;
+        }
+        ::madvise(_data, _length, hint); // only a hint, failures are ignored
+    }
+
+    void MappedFile::willNeed(uint64_t offset, uint64_t length) const {
+        if (offset >= _length) {
+            return;
+        }
+
+        // madvise needs a page aligned address
+        uint64_t systemPageSize = static_cast<uint64_t> (sysconf(_SC_PAGE_SIZE));
+        uint64_t alignedOffset = offset / systemPageSize * systemPageSize;
+        uint64_t end = (offset + length < _length) ? offset + length : _length;
+        ::madvise(_data + alignedOffset, end - alignedOffset, MADV_WILLNEED); // only a hint, failures are ignored
+    }
+}
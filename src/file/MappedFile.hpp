@@ -0,0 +1,79 @@
+
+#ifndef SIMPLEDB_FILE_MAPPEDFILE_HPP
+#define	SIMPLEDB_FILE_MAPPEDFILE_HPP
+
+#include <cassert>
+#include <cstdint>
+
+namespace simpledb {
+
+    /**
+     * Hint about how the pages of a mapped file are accessed:
+     * - normal: the kernel's default read-ahead
+     * - sequential: pages are read in order, the kernel reads ahead aggressively and drops pages behind
+     * - random: pages are read in random order, no read-ahead
+     */
+    enum class MapAdvice {
+        normal, sequential, random
+    };
+
+    /**
+     * Read-only memory mapping of a file, pages are read from the page cache without copying them into frames.
+     * The file must not shrink while it's mapped.
+     */
+    class MappedFile {
+    public:
+        /**
+         * Maps a file.
+         * The file handle can be closed afterwards, the mapping stays valid.
+         * @param fd the file handle
+         * @param length the number of bytes to map from the start of the file
+         * @param advice the access pattern of the mapping
+         */
+        MappedFile(int fd, uint64_t length, MapAdvice advice);
+
+        /**
+         * Unmaps the file.
+         */
+        ~MappedFile();
+
+        MappedFile(const MappedFile& orig) = delete;
+        MappedFile& operator=(const MappedFile& orig) = delete;
+
+        /**
+         * @return the number of mapped bytes
+         */
+        uint64_t length() const {
+            return _length;
+        }
+
+        /**
+         * @param page the page number
+         * @param PAGE_SIZE the size of a page in bytes
+         * @return the pointer to the mapped page
+         */
+        const char* page(uint64_t page, const uint64_t PAGE_SIZE) const {
+            assert((page + 1) * PAGE_SIZE <= _length); // pages behind the mapping are neither mapped nor in the file
+            return _data + page * PAGE_SIZE;
+        }
+
+        /**
+         * Changes the access pattern of the whole mapping.
+         * @param advice the access pattern
+         */
+        void advise(MapAdvice advice) const;
+
+        /**
+         * Starts reading a range of the file into the page cache, without waiting for it.
+         * @param offset the offset of the range in bytes
+         * @param length the length of the range in bytes, it's cut at the end of the mapping
+         */
+        void willNeed(uint64_t offset, uint64_t length) const;
+
+    private:
+        char *_data; // the mapped memory; nullptr, if nothing is mapped
+        uint64_t _length; // the number of mapped bytes
+    };
+}
+
+#endif	/* SIMPLEDB_FILE_MAPPEDFILE_HPP */
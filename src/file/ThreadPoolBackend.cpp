@@ -0,0 +1,76 @@
+
+#include "ThreadPoolBackend.hpp"
+
+#include <unistd.h>
+
+namespace simpledb {
+
+    ThreadPoolBackend::ThreadPoolBackend(uint64_t threads) : _mutex(), _requestCondition(), _completeCondition(), _queue(), _stop(false), _threads() {
+        assert(threads > 0);
+
+        for (uint64_t i = 0; i < threads; ++i) {
+            _threads.add_thread(new boost::thread(&ThreadPoolBackend::run, this));
+        }
+    }
+
+    ThreadPoolBackend::~ThreadPoolBackend() {
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            assert(_queue.empty());
+            _stop = true;
+            _requestCondition.notify_all();
+        }
+        _threads.join_all();
+    }
+
+    void ThreadPoolBackend::submit(IOBatch& batch) {
+        if (batch.empty()) {
+            return;
+        }
+
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        batch.setPending();
+        for (IORequest &request : batch.requests()) {
+            _queue.push_back(std::make_pair(&request, &batch));
+        }
+        _requestCondition.notify_all();
+    }
+
+    void ThreadPoolBackend::complete(IOBatch& batch) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (!batch.isCompleted()) {
+            _completeCondition.wait(lock);
+        }
+    }
+
+    void ThreadPoolBackend::run() {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (true) {
+            while (_queue.empty() && !_stop) {
+                _requestCondition.wait(lock);
+            }
+            if (_queue.empty()) { // stopped
+                return;
+            }
+
+            IORequest *request = _queue.front().first;
+            IOBatch *batch = _queue.front().second;
+            _queue.pop_front();
+            lock.unlock();
+
+            ssize_t res;
+            if (request->write) {
+                res = ::pwrite(request->fd, request->data, request->size, request->pageId.page * request->size);
+            } else {
+                res = ::pread(request->fd, request->data, request->size, request->pageId.page * request->size);
+            }
+            assert(res > -1);
+            // TODO: error handling
+
+            lock.lock();
+            if (batch->completeRequest()) {
+                _completeCondition.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+
+#ifndef SIMPLEDB_FILE_THREADPOOLBACKEND_HPP
+#define	SIMPLEDB_FILE_THREADPOOLBACKEND_HPP
+
+#include "IOBackend.hpp"
+#include "IOBatch.hpp"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace simpledb {
+
+    /**
+     * I/O backend that hands the requests to a pool of threads issuing blocking pread and pwrite calls.
+     * Fallback for kernels without io_uring.
+     */
+    class ThreadPoolBackend : public IOBackend {
+    public:
+
+        /**
+         * Starts the I/O threads.
+         * @param threads number of I/O threads, i.e. the maximum number of I/Os in flight
+         */
+        explicit ThreadPoolBackend(uint64_t threads = DEFAULT_THREADS);
+
+        /**
+         * Stops the I/O threads. All batches must be completed.
+         */
+        virtual ~ThreadPoolBackend();
+
+        ThreadPoolBackend(const ThreadPoolBackend& orig) = delete;
+        ThreadPoolBackend& operator=(const ThreadPoolBackend& orig) = delete;
+
+        virtual void submit(IOBatch& batch);
+        virtual void complete(IOBatch& batch);
+
+    private:
+        static constexpr uint64_t DEFAULT_THREADS = 16; // default number of I/O threads
+
+        boost::mutex _mutex; // mutex for the queue and the completions
+        boost::condition_variable _requestCondition; // notified when requests are queued
+        boost::condition_variable _completeCondition; // notified when a batch is completed
+        std::deque<std::pair<IORequest*, IOBatch*>> _queue; // requests waiting for an I/O thread
+        bool _stop; // true, if the I/O threads should terminate
+        boost::thread_group _threads; // the I/O threads
+
+        /**
+         * Main loop of an I/O thread.
+         */
+        void run();
+    };
+}
+
+#endif	/* SIMPLEDB_FILE_THREADPOOLBACKEND_HPP */
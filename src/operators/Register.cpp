@@ -3,7 +3,7 @@
 
 namespace simpledb {
 
-    Register::Register(Record& record, uint64_t length, uint64_t offset) : _length(length), _data(new char[length]) {
+    Register::Register(const RecordView& record, uint64_t length, uint64_t offset) : _length(length), _data(new char[length]) {
         std::memcpy(_data.get(), record.getData() + offset, length);
     }
 
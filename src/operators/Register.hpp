@@ -3,6 +3,7 @@
 #define SIMPLEDB_OPERATORS_REGISTER_HPP
 
 #include "data/Record.hpp"
+#include "data/RecordView.hpp"
 
 #include <cstdint>
 #include <memory>
@@ -13,7 +14,7 @@ namespace simpledb {
     class Register {
     public:
 
-        Register(Record& record, uint64_t length, uint64_t offset);
+        Register(const RecordView& record, uint64_t length, uint64_t offset);
         ~Register() = default;
 
         Register(const Register& orig);
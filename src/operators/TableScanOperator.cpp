@@ -15,7 +15,8 @@ namespace simpledb {
             return false;
         }
 
-        Record record = **_it;
+        // the attributes are copied from the page, the record itself isn't
+        RecordView record = _it->view();
         _tuple.clear();
         _tuple.reserve(_relation.attributes.size());
 
@@ -2,6 +2,7 @@
 #ifndef SIMPLEDB_SEGMENT_HPP
 #define SIMPLEDB_SEGMENT_HPP
 
+#include "segment/Extent.hpp"
 #include "segment/SegmentManager.hpp"
 #include "segment/SegmentMetadata.hpp"
 
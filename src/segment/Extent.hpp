@@ -0,0 +1,26 @@
+
+#ifndef SIMPLEDB_SEGMENT_EXTENT_HPP
+#define SIMPLEDB_SEGMENT_EXTENT_HPP
+
+#include <cstdint>
+
+namespace simpledb {
+
+    /**
+     * Consecutive pages in the extent segment of a segment, holding a large record.
+     * Extents are read and written as a whole, bypassing the buffer manager.
+     */
+    struct Extent {
+        uint64_t firstPage; // the first page in the extent segment
+        uint64_t pages; // the number of pages
+        uint64_t length; // the length of the data in bytes
+
+        Extent(uint64_t firstPage, uint64_t pages, uint64_t length) : firstPage(firstPage), pages(pages), length(length) {
+        };
+
+        Extent() : Extent(0, 0, 0) {
+        };
+    };
+}
+
+#endif /* SIMPLEDB_SEGMENT_EXTENT_HPP */
@@ -3,7 +3,10 @@
 
 namespace simpledb {
 
-    SegmentManager::SegmentManager(std::string path, std::shared_ptr<BufferManager> buffferManager, std::shared_ptr<FileManager> fileManager) : _bufferManager(buffferManager), _fileManager(fileManager), _segmentManagerFile(path + "segments"), _segments(1, std::make_shared<SegmentMetadata>()) {
+    constexpr uint64_t SegmentManager::FILE_MAGIC;
+    constexpr uint64_t SegmentManager::FILE_VERSION;
+
+    SegmentManager::SegmentManager(std::string path, std::shared_ptr<BufferManager> buffferManager, std::shared_ptr<FileManager> fileManager) : _bufferManager(buffferManager), _fileManager(fileManager), _segmentManagerFile(path + "segments"), _segments(1, std::make_shared<SegmentMetadata>()), _freeExtents(), _mutex() {
         std::ifstream in(_segmentManagerFile, std::ifstream::binary);
 
         if (!in.is_open()) {
@@ -12,24 +15,75 @@ namespace simpledb {
             return;
         }
 
+        // the file starts with its format version, files without it are in the legacy format, where it starts with the number of segments
+        uint64_t version = 0;
+        decltype(_segments)::size_type size;
         {
-            // deserialize number of segments
-            decltype(_segments)::size_type size;
-            in.read(reinterpret_cast<char*> (&size), sizeof (size));
+            uint64_t magic = 0;
+            in.read(reinterpret_cast<char*> (&magic), sizeof (magic));
+            if (magic == FILE_MAGIC) {
+                in.read(reinterpret_cast<char*> (&version), sizeof (version));
+                in.read(reinterpret_cast<char*> (&size), sizeof (size));
+            } else {
+                size = magic;
+            }
+            assert(version <= FILE_VERSION); // written by a newer version
+            // TODO: error handling
+        }
 
-            // deserialize segments
+        {
+            // deserialize segments, the first one is the unused segment id 0
             // TODO: use range constructor of vector to improve performance
+            _segments.clear();
             _segments.reserve(size);
             for (decltype(_segments)::size_type i = 0; i < size; ++i) {
                 std::unique_ptr<SegmentMetadata> segment(new SegmentMetadata());
-                static_assert(sizeof (*segment) == sizeof (SegmentMetadata), "");
-                in.read(reinterpret_cast<char*> (&*segment), sizeof (*segment));
+                if (version < FILE_VERSION) {
+                    readLegacySegment(in, version, *segment);
+                } else {
+                    static_assert(sizeof (*segment) == sizeof (SegmentMetadata), "");
+                    in.read(reinterpret_cast<char*> (&*segment), sizeof (*segment));
+                }
+                if (segment->segmentId() != 0) {
+                    _bufferManager->setPageSize(segment->segmentId(), segment->pageSize());
+                }
                 _segments.emplace_back(std::move(segment));
             }
+            assert(!_segments.empty());
+            // TODO: error handling
+        }
+
+        if (version > 0) {
+            // deserialize free extents, legacy files have none
+            decltype(_freeExtents)::size_type size = 0;
+            in.read(reinterpret_cast<char*> (&size), sizeof (size));
+            for (decltype(_freeExtents)::size_type i = 0; i < size && in; ++i) {
+                uint64_t segmentId;
+                uint64_t count;
+                in.read(reinterpret_cast<char*> (&segmentId), sizeof (segmentId));
+                in.read(reinterpret_cast<char*> (&count), sizeof (count));
+                for (uint64_t j = 0; j < count; ++j) {
+                    uint64_t firstPage;
+                    uint64_t pages;
+                    in.read(reinterpret_cast<char*> (&firstPage), sizeof (firstPage));
+                    in.read(reinterpret_cast<char*> (&pages), sizeof (pages));
+                    _freeExtents[segmentId][firstPage] = pages;
+                }
+            }
+        }
+
+        if (version < FILE_VERSION) {
+            // files of older versions are rewritten in the current format
+            persist();
         }
     }
 
-    uint64_t SegmentManager::create() {
+    uint64_t SegmentManager::create(uint64_t pageSize) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        return createSegment(pageSize);
+    }
+
+    uint64_t SegmentManager::createSegment(uint64_t pageSize) {
         // search next free segment id
         uint64_t segmentId = 0;
         assert(_segments.size() > 0);
@@ -46,24 +100,37 @@ namespace simpledb {
         if (segmentId == 0) { // no free space found => append
             segmentId = _segments.size();
             _fileManager->create(segmentId);
-            _segments.push_back(std::make_shared<SegmentMetadata>(segmentId));
+            _segments.push_back(std::make_shared<SegmentMetadata>(segmentId, pageSize));
         } else { // use found next free segment id
             _fileManager->create(segmentId);
             _segments[segmentId]->setSegmentId(segmentId);
             _segments[segmentId]->setSize();
+            _segments[segmentId]->setPageSize(pageSize);
+            _segments[segmentId]->setVersion(SegmentMetadata::VERSION);
         }
+        _bufferManager->setPageSize(segmentId, pageSize);
 
         persist();
 
         return segmentId;
     }
 
+    SegmentManager::~SegmentManager() {
+        _fileManager->sync();
+    }
+
     std::shared_ptr<SegmentMetadata> SegmentManager::retrieve(uint64_t segmentId) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
         assert(checkExists(segmentId));
         return _segments[segmentId];
     }
 
     void SegmentManager::allocate(uint64_t segmentId, uint64_t min, uint64_t max) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        allocateSegment(segmentId, min, max);
+    }
+
+    void SegmentManager::allocateSegment(uint64_t segmentId, uint64_t min, uint64_t max) {
         assert(checkExists(segmentId));
 
         uint64_t currentSize = _segments[segmentId]->size();
@@ -79,19 +146,124 @@ namespace simpledb {
             newSize = std::max(newSize + 1, tmpSize);
         }
 
-        _fileManager->truncate(segmentId, _bufferManager->pageSize(), newSize);
+        _fileManager->truncate(segmentId, _segments[segmentId]->pageSize(), newSize);
         _segments[segmentId]->setSize(newSize);
         persist();
     }
 
     void SegmentManager::remove(uint64_t segmentId) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        removeSegment(segmentId);
+    }
+
+    void SegmentManager::removeSegment(uint64_t segmentId) {
         assert(checkExists(segmentId));
 
+        uint64_t extentSegmentId = _segments[segmentId]->extentSegmentId();
+        if (extentSegmentId != 0) {
+            removeSegment(extentSegmentId);
+            _freeExtents.erase(segmentId);
+        }
+
         _fileManager->remove(segmentId);
         _segments[segmentId]->setSegmentId();
         _segments[segmentId]->setSize();
+        _segments[segmentId]->setPageSize(0);
+        _segments[segmentId]->setExtentSegmentId(0);
+        _segments[segmentId]->setVersion(0);
+
+        persist();
+    }
+
+    Extent SegmentManager::allocateExtent(uint64_t segmentId, uint64_t length) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        assert(checkExists(segmentId));
+        assert(length > 0);
+
+        uint64_t pageSize = _segments[segmentId]->pageSize();
+        uint64_t pages = (length + pageSize - 1) / pageSize;
+        uint64_t extentSegmentId = extentSegment(segmentId);
+        std::map<uint64_t, uint64_t> &freeExtents = _freeExtents[segmentId];
+
+        // first fit in the free extents
+        for (std::map<uint64_t, uint64_t>::iterator it = freeExtents.begin(); it != freeExtents.end(); ++it) {
+            if (it->second >= pages) {
+                uint64_t firstPage = it->first;
+                uint64_t remainingPages = it->second - pages;
+                freeExtents.erase(it);
+                if (remainingPages > 0) {
+                    freeExtents[firstPage + pages] = remainingPages;
+                }
+                persist();
+                return Extent(firstPage, pages, length);
+            }
+        }
+
+        // no free extent large enough -> grow the extent segment, starting with a free extent at its end
+        uint64_t firstPage = _segments[extentSegmentId]->size();
+        if (!freeExtents.empty() && freeExtents.rbegin()->first + freeExtents.rbegin()->second == firstPage) {
+            firstPage = freeExtents.rbegin()->first;
+            freeExtents.erase(firstPage);
+        }
+        allocateSegment(extentSegmentId, firstPage + pages, firstPage + pages);
 
+        // the segment grows by more than the extent, the rest is free
+        uint64_t newSize = _segments[extentSegmentId]->size();
+        if (newSize > firstPage + pages) {
+            freeExtents[firstPage + pages] = newSize - (firstPage + pages);
+        }
         persist();
+
+        return Extent(firstPage, pages, length);
+    }
+
+    void SegmentManager::freeExtent(uint64_t segmentId, Extent extent) {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        assert(checkExists(segmentId));
+        assert(extent.pages > 0);
+
+        std::map<uint64_t, uint64_t> &freeExtents = _freeExtents[segmentId];
+        std::map<uint64_t, uint64_t>::iterator it = freeExtents.insert(std::make_pair(extent.firstPage, extent.pages)).first;
+        assert(it->second == extent.pages); // extent freed twice?
+
+        // merge with the following and the preceding free extent
+        std::map<uint64_t, uint64_t>::iterator next = std::next(it);
+        if (next != freeExtents.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            freeExtents.erase(next);
+        }
+        if (it != freeExtents.begin()) {
+            std::map<uint64_t, uint64_t>::iterator previous = std::prev(it);
+            if (previous->first + previous->second == it->first) {
+                previous->second += it->second;
+                freeExtents.erase(it);
+            }
+        }
+
+        persist();
+    }
+
+    void SegmentManager::writeExtent(uint64_t segmentId, Extent extent, const char* data) {
+        // the extent segment exists before its first extent is allocated, the write doesn't need the mutex
+        std::shared_ptr<SegmentMetadata> segment = retrieve(segmentId);
+        assert(extent.length <= extent.pages * segment->pageSize());
+
+        PageId firstPage(segment->extentSegmentId(), extent.firstPage);
+        _fileManager->writePages(firstPage, segment->pageSize(), extent.length, data);
+    }
+
+    void SegmentManager::readExtent(uint64_t segmentId, Extent extent, char* data) {
+        std::shared_ptr<SegmentMetadata> segment = retrieve(segmentId);
+
+        PageId firstPage(segment->extentSegmentId(), extent.firstPage);
+        _fileManager->readPages(firstPage, segment->pageSize(), extent.length, data);
+    }
+
+    std::unique_ptr<MappedFile> SegmentManager::map(uint64_t segmentId, MapAdvice advice) {
+        std::shared_ptr<SegmentMetadata> segment = retrieve(segmentId);
+
+        _bufferManager->flushSegment(segmentId);
+        return _fileManager->map(segmentId, segment->size() * segment->pageSize(), advice);
     }
 
     void SegmentManager::persist() {
@@ -100,6 +272,12 @@ namespace simpledb {
         assert(out.is_open());
         // TODO: error handling
 
+        // serialize format version
+        uint64_t magic = FILE_MAGIC;
+        uint64_t version = FILE_VERSION;
+        out.write(reinterpret_cast<char*> (&magic), sizeof (magic));
+        out.write(reinterpret_cast<char*> (&version), sizeof (version));
+
         // serialize number of segments
         auto size = _segments.size();
         out.write(reinterpret_cast<char*> (&size), sizeof (size));
@@ -109,9 +287,72 @@ namespace simpledb {
             static_assert(sizeof (*i) == sizeof (SegmentMetadata), "");
             out.write(reinterpret_cast<char*> (&*i), sizeof (*i));
         }
+
+        // serialize free extents
+        auto freeExtentsSize = _freeExtents.size();
+        out.write(reinterpret_cast<char*> (&freeExtentsSize), sizeof (freeExtentsSize));
+        for (std::pair<const uint64_t, std::map<uint64_t, uint64_t>> const &i : _freeExtents) {
+            uint64_t segmentId = i.first;
+            uint64_t count = i.second.size();
+            out.write(reinterpret_cast<char*> (&segmentId), sizeof (segmentId));
+            out.write(reinterpret_cast<char*> (&count), sizeof (count));
+            for (std::pair<const uint64_t, uint64_t> const &j : i.second) {
+                uint64_t firstPage = j.first;
+                uint64_t pages = j.second;
+                out.write(reinterpret_cast<char*> (&firstPage), sizeof (firstPage));
+                out.write(reinterpret_cast<char*> (&pages), sizeof (pages));
+            }
+        }
+        out.close();
+
+        // the metadata file is written through the page cache, it's neither page aligned nor a multiple of the page size
+        // with direct I/O, writes aren't synchronous, so the metadata and the extents it references are synced here
+        if (_fileManager->isDirectIO()) {
+            _fileManager->sync();
+
+            int fd = ::open(_segmentManagerFile.c_str(), O_RDONLY);
+            assert(fd > -1);
+            int res = ::fdatasync(fd);
+            assert(res > -1);
+            ::close(fd);
+            // TODO: error handling
+        }
+    }
+
+    void SegmentManager::readLegacySegment(std::istream& in, uint64_t version, SegmentMetadata& segment) {
+        // the legacy format only has the segment id and the size, all segments have the default page size and no extent segment
+        uint64_t segmentId = 0;
+        uint64_t size = 0;
+        uint64_t pageSize = 0;
+        uint64_t extentSegmentId = 0;
+        in.read(reinterpret_cast<char*> (&segmentId), sizeof (segmentId));
+        in.read(reinterpret_cast<char*> (&size), sizeof (size));
+        if (version == 0) {
+            pageSize = (segmentId != 0 ? BufferManager::PAGE_SIZE : 0);
+        } else {
+            in.read(reinterpret_cast<char*> (&pageSize), sizeof (pageSize));
+            in.read(reinterpret_cast<char*> (&extentSegmentId), sizeof (extentSegmentId));
+        }
+        segment.setSegmentId(segmentId);
+        segment.setSize(size);
+        segment.setPageSize(pageSize);
+        segment.setExtentSegmentId(extentSegmentId);
+
+        // segments of version 1 files were created with the page layout of the first segment version
+        segment.setVersion(version == 0 ? 0 : 1);
     }
 
     bool SegmentManager::checkExists(uint64_t segmentId) {
         return (_segments.size() > segmentId && _segments[segmentId].get() && _segments[segmentId]->segmentId() == segmentId);
     }
+
+    uint64_t SegmentManager::extentSegment(uint64_t segmentId) {
+        uint64_t extentSegmentId = _segments[segmentId]->extentSegmentId();
+        if (extentSegmentId == 0) {
+            extentSegmentId = createSegment(_segments[segmentId]->pageSize());
+            _segments[segmentId]->setExtentSegmentId(extentSegmentId);
+            persist();
+        }
+        return extentSegmentId;
+    }
 }
\ No newline at end of file
@@ -2,23 +2,38 @@
 #ifndef SIMPLEDB_SEGMENT_SEGMENTMANAGER_HPP
 #define SIMPLEDB_SEGMENT_SEGMENTMANAGER_HPP
 
+#include "Extent.hpp"
 #include "SegmentMetadata.hpp"
 
 #include "buffer.hpp"
 #include "file.hpp"
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <fstream>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace simpledb {
 
+    /**
+     * Selects how the pages of a segment are accessed:
+     * - buffered: pages are fixed in frames of the buffer manager, they can be read and written
+     * - mapped: the segment is read-only, its pages are read from a memory mapping of its file without using frames
+     */
+    enum class SegmentAccess {
+        buffered, mapped
+    };
+
     /**
      * Manages concurrent access to creation, deletion and growth of segments.
+     * All methods are thread-safe, the metadata and the free extents are guarded by one mutex.
      */
     class SegmentManager {
     public:
@@ -29,16 +44,21 @@ namespace simpledb {
          * @param fileManager the file manager
          */
         SegmentManager(std::string path, std::shared_ptr<BufferManager> bufferManager, std::shared_ptr<FileManager> fileManager);
-        ~SegmentManager() = default;
+
+        /**
+         * Syncs the extents written with the file manager, they aren't durable yet in direct mode.
+         */
+        ~SegmentManager();
 
         SegmentManager(const SegmentManager& orig) = delete;
         SegmentManager& operator=(const SegmentManager& orig) = delete;
 
         /**
          * Creates a new segment on disk. No disk space is allocated.
+         * @param pageSize the size of a page in bytes, the buffer manager must have frames of that size
          * @return the id of the new segment
          */
-        uint64_t create();
+        uint64_t create(uint64_t pageSize = BufferManager::PAGE_SIZE);
 
         /**
          * Retrieves metadata information about a segment.
@@ -51,8 +71,8 @@ namespace simpledb {
          * Enlarges a segment to a given size.
          * If necessary new disk space is allocated.
          * @param segmentId the id of the segment to enlarge
-         * @param min the minimum size of the segment in buffer frame sizes
-         * @param max a hint for the needed segment size in buffer frame sizes
+         * @param min the minimum size of the segment in pages
+         * @param max a hint for the needed segment size in pages
          */
         void allocate(uint64_t segmentId, uint64_t min, uint64_t max);
 
@@ -62,24 +82,107 @@ namespace simpledb {
          */
         void remove(uint64_t segmentId);
 
+        /**
+         * Allocates consecutive pages for a large record in the extent segment of a segment.
+         * The extent segment is created with the page size of the segment on first use and removed with the segment.
+         * @param segmentId the segment id
+         * @param length the length of the record in bytes
+         * @return the extent
+         */
+        Extent allocateExtent(uint64_t segmentId, uint64_t length);
+
+        /**
+         * Returns the pages of an extent, so they can be reused for other extents of the segment.
+         * @param segmentId the segment id
+         * @param extent the extent
+         */
+        void freeExtent(uint64_t segmentId, Extent extent);
+
+        /**
+         * Writes the data of a large record to an extent with one write.
+         * Extents bypass the buffer manager.
+         * @param segmentId the segment id
+         * @param extent the extent
+         * @param data the data of extent.length bytes
+         */
+        void writeExtent(uint64_t segmentId, Extent extent, const char* data);
+
+        /**
+         * Reads the data of a large record from an extent with one read.
+         * This method is thread-safe, but the data is inconsistent if the extent is freed concurrently.
+         * @param segmentId the segment id
+         * @param extent the extent
+         * @param data the memory for extent.length bytes
+         */
+        void readExtent(uint64_t segmentId, Extent extent, char* data);
+
+        /**
+         * Maps the file of a segment read-only for segments in mapped mode.
+         * Its dirty pages are flushed from the buffer manager first. The segment must not be modified or grow while it's mapped.
+         * @param segmentId the segment id
+         * @param advice the access pattern of the mapping
+         * @return the mapping of all pages of the segment
+         */
+        std::unique_ptr<MappedFile> map(uint64_t segmentId, MapAdvice advice);
+
     private:
         static constexpr double SEGMENT_GROWTH_FACTOR = 1.25;
+        static constexpr uint64_t FILE_MAGIC = 0x73746e656d676573ull; // "segments", precedes the format version of the metadata file
+        static constexpr uint64_t FILE_VERSION = 2; // 0: legacy format without magic, page sizes and extents; 1: without segment versions
         std::shared_ptr<BufferManager> _bufferManager;
         std::shared_ptr<FileManager> _fileManager;
         std::string _segmentManagerFile;
         std::vector<std::shared_ptr<SegmentMetadata>> _segments;
+        std::map<uint64_t, std::map<uint64_t, uint64_t>> _freeExtents; // segment id -> first page -> number of pages of the free extents
+        boost::mutex _mutex; // mutex for the segments and the free extents
+
+        /**
+         * Creates a new segment on disk, the mutex must be held.
+         * @param pageSize the size of a page in bytes
+         * @return the id of the new segment
+         */
+        uint64_t createSegment(uint64_t pageSize);
 
         /**
-         * Persists all changes to the segment manager on disk.
+         * Enlarges a segment to a given size, the mutex must be held.
+         * @param segmentId the id of the segment to enlarge
+         * @param min the minimum size of the segment in pages
+         * @param max a hint for the needed segment size in pages
+         */
+        void allocateSegment(uint64_t segmentId, uint64_t min, uint64_t max);
+
+        /**
+         * Deletes a segment and its extent segment from disk, the mutex must be held.
+         * @param segmentId the id of the segment to delete
+         */
+        void removeSegment(uint64_t segmentId);
+
+        /**
+         * Persists all changes to the segment manager on disk, the mutex must be held.
          */
         void persist();
 
         /**
-         * Check if a segment exists in the segment manager.
+         * Reads the metadata of a segment in a format older than the current one.
+         * @param in the metadata file
+         * @param version the format version of the file
+         * @param segment the segment metadata to fill
+         */
+        static void readLegacySegment(std::istream& in, uint64_t version, SegmentMetadata& segment);
+
+        /**
+         * Check if a segment exists in the segment manager, the mutex must be held.
          * @param segmentId the segment id
          * @return true, if the segment exists; false, otherwise
          */
         bool checkExists(uint64_t segmentId);
+
+        /**
+         * The mutex must be held.
+         * @param segmentId the segment id
+         * @return the id of the extent segment of the segment, it's created if it doesn't exist yet
+         */
+        uint64_t extentSegment(uint64_t segmentId);
     };
 }
 
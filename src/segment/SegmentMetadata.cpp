@@ -3,12 +3,16 @@
 
 namespace simpledb {
 
-    SegmentMetadata::SegmentMetadata(uint64_t segmentId, uint64_t size) : _segmentId(segmentId), _size(size) {
+    constexpr uint64_t SegmentMetadata::VERSION;
+
+    static_assert(sizeof (std::atomic<uint64_t>) == sizeof (uint64_t), "the metadata file stores the size as a uint64_t");
+
+    SegmentMetadata::SegmentMetadata(uint64_t segmentId, uint64_t size, uint64_t pageSize) : _segmentId(segmentId), _size(size), _pageSize(pageSize), _extentSegmentId(0), _version(VERSION) {
     }
 
-    SegmentMetadata::SegmentMetadata(uint64_t segmentId) : SegmentMetadata(segmentId, 0) {
+    SegmentMetadata::SegmentMetadata(uint64_t segmentId, uint64_t pageSize) : SegmentMetadata(segmentId, 0, pageSize) {
     }
 
-    SegmentMetadata::SegmentMetadata() : SegmentMetadata(0, 0) {
+    SegmentMetadata::SegmentMetadata() : SegmentMetadata(0, 0, 0) {
     }
 }
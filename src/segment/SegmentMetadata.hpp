@@ -2,30 +2,37 @@
 #ifndef SIMPLEDB_SEGMENT_SEGMENTMETADATA_HPP
 #define SIMPLEDB_SEGMENT_SEGMENTMETADATA_HPP
 
+#include <atomic>
 #include <cstdint>
 
 namespace simpledb {
 
     /**
      * Holds all segment metadata info that is serialized to disk.
+     * The size is published atomically, so it can be read while the segment grows.
+     * The other fields are only set while a segment is created or removed.
      */
     class SegmentMetadata {
     public:
+        static constexpr uint64_t VERSION = 1; // version of the page layout of new segments, segments created before versions were stored have version 0
+
         /**
-         * Creates a new segment metadata object.
+         * Creates a new segment metadata object with the current version.
          * @param segmentId the segment id
          * @param size the size of the segment in number of pages
+         * @param pageSize the size of a page in bytes
          */
-        SegmentMetadata(uint64_t segmentId, uint64_t size);
+        SegmentMetadata(uint64_t segmentId, uint64_t size, uint64_t pageSize);
 
         /**
          * Creates a new segment metdata object with zero size.
          * @param segmentId the segment id
+         * @param pageSize the size of a page in bytes
          */
-        explicit SegmentMetadata(uint64_t segmentId);
+        SegmentMetadata(uint64_t segmentId, uint64_t pageSize);
 
         /**
-         * Creates a new segment metadata object with invalid segment id and zero size.
+         * Creates a new segment metadata object with invalid segment id, zero size and zero page size.
          */
         SegmentMetadata();
 
@@ -53,7 +60,7 @@ namespace simpledb {
          * @return the size of the segment in number of pages
          */
         uint64_t size() {
-            return _size;
+            return _size.load();
         }
 
         /**
@@ -61,12 +68,60 @@ namespace simpledb {
          * @param size the size of the segment in number of pages
          */
         void setSize(uint64_t size = 0) {
-            _size = size;
+            _size.store(size);
+        }
+
+        /**
+         * @return the size of a page in bytes
+         */
+        uint64_t pageSize() {
+            return _pageSize;
+        }
+
+        /**
+         * Sets the page size of the segment.
+         * @param pageSize the size of a page in bytes
+         */
+        void setPageSize(uint64_t pageSize) {
+            _pageSize = pageSize;
+        }
+
+        /**
+         * @return the id of the segment holding the extents of large records; 0, if there is none
+         */
+        uint64_t extentSegmentId() {
+            return _extentSegmentId;
+        }
+
+        /**
+         * Sets the id of the segment holding the extents of large records.
+         * @param extentSegmentId the extent segment id
+         */
+        void setExtentSegmentId(uint64_t extentSegmentId) {
+            _extentSegmentId = extentSegmentId;
+        }
+
+        /**
+         * @return the version of the page layout of the segment, the segment type decides which layouts it reads
+         */
+        uint64_t version() {
+            return _version;
+        }
+
+        /**
+         * Sets the version of the page layout of the segment.
+         * @param version the version
+         */
+        void setVersion(uint64_t version) {
+            _version = version;
         }
 
     private:
         uint64_t _segmentId; // segment id
-        uint64_t _size; // size in page sizes
+        std::atomic<uint64_t> _size; // size in page sizes, it has the layout of a uint64_t in the metadata file
+        uint64_t _pageSize; // size of a page in bytes
+        uint64_t _extentSegmentId; // id of the segment holding the extents of large records
+        uint64_t _version; // version of the page layout
     };
 }
 
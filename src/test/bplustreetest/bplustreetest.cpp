@@ -5,6 +5,7 @@
 #include "segment.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -101,7 +102,7 @@ const IntPair getSmallestKey(const uint64_t& i) {
     return std::make_pair(0, 0);
 }
 
-template <class T, class CMP>
+template <class T, class CMP, uint64_t PAGE_SIZE = BufferManager::PAGE_SIZE>
 void test(uint64_t n) {
     // create tmp dir
     const char *tmpDir = "/tmp/slottedtest/";
@@ -113,10 +114,14 @@ void test(uint64_t n) {
 
     // Set up stuff, you probably have to change something here to match to your interfaces
     std::shared_ptr<FileManager> fm = std::make_shared<FileManager>(tmpDir);
-    std::shared_ptr<BufferManager> bm = std::make_shared<BufferManager>(tmpDir, 1000);
+    BufferManagerOptions options;
+    if (PAGE_SIZE != BufferManager::PAGE_SIZE) {
+        options.pageSizes[PAGE_SIZE] = 250; // same memory as 1000 frames of the default page size
+    }
+    std::shared_ptr<BufferManager> bm = std::make_shared<BufferManager>(tmpDir, 1000, options);
     std::shared_ptr<SegmentManager> sm = std::make_shared<SegmentManager>(tmpDir, bm, fm);
-    uint64_t segmentId = sm->create();
-    BPlusTree<T, uint64_t, CMP> bTree(segmentId, sm, bm);
+    uint64_t segmentId = sm->create(PAGE_SIZE);
+    BPlusTree<T, uint64_t, CMP, PAGE_SIZE> bTree(segmentId, sm, bm);
     std::map<T, uint64_t, CMP> map;
 
     // Insert values
@@ -130,15 +135,22 @@ void test(uint64_t n) {
     }
     assert(bTree.size() == n);
 
-    // Check if they can be retrieved
-    for (uint64_t i = 1; i <= n; ++i) {
-        uint64_t value = bTree.lookup(getKey<T>(i));
-        assert(value == i * i);
+    // Check if they can be retrieved, the first pass swizzles the references to the nodes in memory
+    for (uint64_t pass = 0; pass < 2; ++pass) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint64_t i = 1; i <= n; ++i) {
+            uint64_t value = bTree.lookup(getKey<T>(i));
+            assert(value == i * i);
+        }
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        if (pass == 1) {
+            std::cout << "lookup throughput: " << static_cast<uint64_t> (n / duration.count()) << " ops/s" << std::endl;
+        }
     }
 
     // Check range request
     {
-        typename BPlusTree<T, uint64_t, CMP>::iterator it = bTree.lookupRange(getSmallestKey<T>(0));
+        typename BPlusTree<T, uint64_t, CMP, PAGE_SIZE>::iterator it = bTree.lookupRange(getSmallestKey<T>(0));
         typename std::map<T, uint64_t>::iterator map_it;
         for (map_it = map.begin(); it.isValid(); ++it, ++map_it) {
             T key = (*it).first;
@@ -169,9 +181,21 @@ void test(uint64_t n) {
         }
     }
 
+    // Check lookups of the tree read from a mapping of its segment, while it isn't modified
+    {
+        BPlusTree<T, uint64_t, CMP, PAGE_SIZE> mappedTree(segmentId, sm, bm, SegmentAccess::mapped);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint64_t i = 1; i <= n; ++i) {
+            uint64_t value = mappedTree.lookup(getKey<T>(i));
+            assert(value == ((i % 7) == 0 ? 0 : i * i));
+        }
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        std::cout << "mapped lookup throughput: " << static_cast<uint64_t> (n / duration.count()) << " ops/s" << std::endl;
+    }
+
     // Check range request
     {
-        typename BPlusTree<T, uint64_t, CMP>::iterator it = bTree.lookupRange(getSmallestKey<T>(0));
+        typename BPlusTree<T, uint64_t, CMP, PAGE_SIZE>::iterator it = bTree.lookupRange(getSmallestKey<T>(0));
         typename std::map<T, uint64_t>::iterator map_it;
         for (map_it = map.begin(); it.isValid(); ++it, ++map_it) {
             T key = (*it).first;
@@ -196,7 +220,7 @@ void test(uint64_t n) {
 
     // Check range request
     {
-        typename BPlusTree<T, uint64_t, CMP>::iterator it = bTree.lookupRange(getKey<T>(0));
+        typename BPlusTree<T, uint64_t, CMP, PAGE_SIZE>::iterator it = bTree.lookupRange(getKey<T>(0));
         assert(!it.isValid());
     }
 
@@ -225,6 +249,9 @@ int main(int argc, char* argv[]) {
     // Test index with compound key
     test<IntPair, MyCustomIntPairCmp>(n);
 
+    // Test index with 64bit unsigned integers on 16 KiB pages
+    test<uint64_t, MyCustomUInt64Cmp, 4 * BufferManager::PAGE_SIZE>(n);
+
 
     std::cout << "test successful" << std::endl;
 
@@ -2,15 +2,22 @@
 
 #include <boost/thread/thread.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <assert.h>
+#include <fstream>
 #include <memory>
+#include <string>
+#include <tuple>
 
+#include <linux/perf_event.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 
 using namespace std;
@@ -42,7 +49,7 @@ static void scan() {
         unsigned start = random() % pagesOnDisk;
         unsigned i, page;
         for (page = start, i = 0; i < 10; page = (page + 1) % pagesOnDisk, ++i) {
-            std::shared_ptr<BufferFrame> bf = bm->fixPage(1, page, false);
+            PageGuard bf = bm->fixPage(1, page, false);
             unsigned newcount = reinterpret_cast<unsigned*> (bf->getData())[0];
             assert(counters[page] <= newcount);
             counters[page] = newcount;
@@ -51,12 +58,58 @@ static void scan() {
     }
 }
 
+static void scanOptimistic() {
+    // scan all pages without fixing them and check if the counters are not decreasing
+    unsigned counters[pagesOnDisk];
+    for (unsigned i = 0; i < pagesOnDisk; i++)
+        counters[i] = 0;
+
+    while (!stop) {
+        unsigned start = random() % pagesOnDisk;
+        unsigned i, page;
+        for (page = start, i = 0; i < 10; page = (page + 1) % pagesOnDisk, ++i) {
+            // read optimistically, retry if the page was modified concurrently
+            BufferFrame *bf;
+            uint64_t version;
+            unsigned newcount;
+            do {
+                std::tie(bf, version) = bm->fixPageOptimistic(1, page);
+                newcount = reinterpret_cast<unsigned*> (bf->getData())[0];
+            } while (!bm->unfixPageOptimistic(bf, version));
+            assert(counters[page] <= newcount);
+            counters[page] = newcount;
+        }
+    }
+}
+
+static int openCounter(uint32_t type, uint64_t config) {
+    // count for all threads started afterwards, -1 if the counter isn't available (e.g. no PMU in a VM)
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = (type != PERF_TYPE_SOFTWARE); // page faults of reads into the frames happen in the kernel
+    attr.exclude_hv = 1;
+    return static_cast<int> (syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static string readCounter(int counter) {
+    uint64_t value;
+    if (counter < 0 || read(counter, &value, sizeof (value)) != sizeof (value)) {
+        return "n/a";
+    }
+    close(counter);
+    return to_string(value);
+}
+
 static void readWrite(uint64_t threadNum) {
     // read or write random pages
     uint64_t count = 0;
     for (unsigned i = 0; i < 100000 / threadCount; i++) {
         bool isWrite = rand_r(&threadSeed[threadNum]) % 128 < 10;
-        std::shared_ptr<BufferFrame> bf = bm->fixPage(1, randomPage(threadNum), isWrite);
+        PageGuard bf = bm->fixPage(1, randomPage(threadNum), isWrite);
 
         if (isWrite) {
             count++;
@@ -69,12 +122,42 @@ static void readWrite(uint64_t threadNum) {
 }
 
 int main(int argc, char** argv) {
-    if (argc == 4) {
+    BufferManagerOptions options;
+    if (argc >= 4 && argc <= 9) {
         pagesOnDisk = atoi(argv[1]);
         pagesInRAM = atoi(argv[2]);
         threadCount = atoi(argv[3]);
+        if (argc >= 5 && string(argv[4]) == "2q") {
+            options.strategy = ReplacementStrategy::twoQueue;
+        } else if (argc >= 5 && string(argv[4]) != "clock") {
+            cerr << "unknown replacement strategy: " << argv[4] << endl;
+            exit(1);
+        }
+        if (argc >= 6) {
+            options.writerThreads = atoi(argv[5]);
+        }
+        if (argc >= 7 && string(argv[6]) == "uring") {
+            options.ioBackend = IOBackendType::uring;
+        } else if (argc >= 7 && string(argv[6]) == "threads") {
+            options.ioBackend = IOBackendType::threadPool;
+        } else if (argc >= 7) {
+            cerr << "unknown I/O backend: " << argv[6] << endl;
+            exit(1);
+        }
+        if (argc >= 8 && string(argv[7]) == "small") {
+            options.hugePages = false;
+        } else if (argc >= 8 && string(argv[7]) != "huge") {
+            cerr << "unknown page backing: " << argv[7] << endl;
+            exit(1);
+        }
+        if (argc == 9 && string(argv[8]) == "direct") {
+            options.directIO = true;
+        } else if (argc == 9 && string(argv[8]) != "sync") {
+            cerr << "unknown file mode: " << argv[8] << endl;
+            exit(1);
+        }
     } else {
-        cerr << "usage: " << argv[0] << " <pagesOnDisk> <pagesInRAM> <threads>" << endl;
+        cerr << "usage: " << argv[0] << " <pagesOnDisk> <pagesInRAM> <threads> [clock|2q] [writerThreads] [uring|threads] [huge|small] [sync|direct]" << endl;
         exit(1);
     }
 
@@ -100,58 +183,169 @@ int main(int argc, char** argv) {
             ::close(file);
         }
     }
+    // pages a multiple of the shard count apart fill a single shard of the frame table beyond its even share
+    {
+        const uint64_t frames = 256;
+        const uint64_t stride = 4;
+        if (truncate(tmpFile, 2 * frames * stride * sysconf(_SC_PAGE_SIZE)) < 0) {
+            perror("Could not allocate tmp file");
+            exit(EXIT_FAILURE);
+        }
+        BufferManager strided(tmpDir, frames, options);
+        for (uint64_t i = 0; i < 2 * frames; i++) {
+            PageGuard bf = strided.fixPage(1, i * stride, false);
+            strided.unfixPage(bf, false);
+        }
+        assert(strided.statistics().residentPages[1] == frames);
+
+        // a batch fixes repeated pages once and maps each of them to the guard of its page
+        std::vector<PageId> pages = {PageId(1, 2 * stride), PageId(1, 0), PageId(1, 2 * stride)};
+        PageBatch batch = strided.fixPages(pages, false);
+        assert(batch.size() == pages.size() && batch.guards().size() == 2);
+        for (uint64_t i = 0; i < pages.size(); i++) {
+            assert(batch[i]->pageId() == pages[i]);
+        }
+        assert(batch.guardIndex(0) == batch.guardIndex(2));
+        strided.unfixPages(batch);
+    }
+
     if (truncate(tmpFile, pagesOnDisk * sysconf(_SC_PAGE_SIZE)) < 0) {
         perror("Could not allocate tmp file");
         exit(EXIT_FAILURE);
     }
 
-    bm = new BufferManager(tmpDir, pagesInRAM);
+    // count TLB misses, loads from remote NUMA nodes and page faults from the first touch of the frames to the end of the read/write threads
+    int tlbMisses = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    int remoteLoads = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    int pageFaults = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+
+    bm = new BufferManager(tmpDir, pagesInRAM, options);
 
     boost::thread_group threads;
 
     // set all counters to 0
     for (uint64_t i = 0; i < pagesOnDisk; i++) {
-        std::shared_ptr<BufferFrame> bf = bm->fixPage(1, i, true);
+        PageGuard bf = bm->fixPage(1, i, true);
         reinterpret_cast<unsigned*> (bf->getData())[0] = 0;
         bm->unfixPage(bf, true);
     }
 
-    // start scan thread
+    // write the adjacent dirty pages with vectored writes
+    bm->flushSegment(1);
+    StatisticsSnapshot flushed = bm->statistics();
+    assert(flushed.dirtyFrames == 0);
+    cout << "pages per write: " << static_cast<double> (flushed.counter(Counter::writes)) / flushed.count(Histogram::writeLatency) << endl;
+
+    // start scan threads, one with shared fixes and one with optimistic reads
     boost::thread scanThread(scan);
+    boost::thread scanOptimisticThread(scanOptimistic);
 
     // start read/write threads
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     for (uint64_t i = 0; i < threadCount; i++) {
         threads.add_thread(new boost::thread(readWrite, i));
     }
 
-    // wait for read/write threads
+    // wait for read/write threads, the scan threads only read
     threads.join_all();
+    bm->flushAll();
+    assert(bm->statistics().dirtyFrames == 0);
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    uint64_t operations = (100000 / threadCount) * threadCount;
+    cout << "fix/unfix throughput: " << static_cast<uint64_t> (operations / duration.count()) << " ops/s" << endl;
+    cout << "dTLB load misses: " << readCounter(tlbMisses) << ", remote node loads: " << readCounter(remoteLoads) << ", page faults: " << readCounter(pageFaults) << endl;
+
+    // all fixes are counted, the misses can't exceed them and no segment can have more pages in memory than there are frames
+    StatisticsSnapshot statistics = bm->statistics();
+    assert(statistics.counter(Counter::fixes) >= pagesOnDisk + operations);
+    assert(statistics.counter(Counter::misses) <= statistics.counter(Counter::fixes));
+    assert(statistics.residentPages[1] <= pagesInRAM);
+    cout << "hit rate: " << statistics.hitRate() << ", miss latency p99 < " << statistics.percentile(Histogram::missLatency, 0.99) << " ns, lock waits: " << statistics.counter(Counter::lockWaits) << endl;
 
     uint64_t totalCount = 0;
     for (uint64_t i = 0; i < threadCount; i++) {
         totalCount += threadCounter[i];
     }
 
-    // wait for scan thread
+    // wait for scan threads
     stop = true;
     scanThread.join();
+    scanOptimisticThread.join();
+
+    // pages round trip through the codec, random data doesn't compress
+    {
+        const uint64_t pageSize = BufferManager::PAGE_SIZE;
+        unique_ptr<char[]> page(new char[pageSize]);
+        unique_ptr<char[]> compressed(new char[pageSize]);
+        unique_ptr<char[]> decompressed(new char[pageSize]);
+        for (uint64_t i = 0; i < pageSize; ++i) {
+            page[i] = "Tape is Dead. Disk is Tape. Flash is Disk."[i % 42 + (i / 1000) % 2];
+        }
+        uint64_t length = PageCodec::compress(page.get(), pageSize, compressed.get(), pageSize);
+        assert(length > 0 && length < pageSize / 4);
+        assert(PageCodec::decompress(compressed.get(), length, decompressed.get(), pageSize));
+        assert(memcmp(page.get(), decompressed.get(), pageSize) == 0);
 
-    // restart buffer manager
+        unsigned seed = 42;
+        for (uint64_t i = 0; i < pageSize; ++i) {
+            page[i] = static_cast<char> (rand_r(&seed));
+        }
+        assert(PageCodec::compress(page.get(), pageSize, compressed.get(), pageSize * 3 / 4) == 0);
+    }
+
+    // restart buffer manager, it dumps its statistics during the scan and keeps the evicted pages compressed
     delete bm;
-    bm = new BufferManager(tmpDir, pagesInRAM);
+    const string statisticsFile = string(tmpDir) + "statistics";
+    options.statisticsInterval = 10;
+    options.statisticsFile = statisticsFile;
+    options.compressedCacheSize = pagesOnDisk * BufferManager::PAGE_SIZE / 4;
+    bm = new BufferManager(tmpDir, pagesInRAM, options);
 
-    // check counter
+    // check counter with a cold sequential scan, read-ahead prefetches the pages
     uint64_t totalCountOnDisk = 0;
+    ReadAhead readAhead(bm, pagesOnDisk);
+    start = std::chrono::steady_clock::now();
     for (uint64_t i = 0; i < pagesOnDisk; i++) {
-        std::shared_ptr<BufferFrame> bf = bm->fixPage(1, i, false);
+        readAhead.access(PageId(1, i));
+        PageGuard bf = bm->fixPage(1, i, false);
         totalCountOnDisk += reinterpret_cast<unsigned*> (bf->getData())[0];
         bm->unfixPage(bf, false);
     }
+    duration = std::chrono::steady_clock::now() - start;
+    cout << "cold scan throughput: " << static_cast<uint64_t> (pagesOnDisk / duration.count()) << " pages/s" << endl;
+
+    // scan again, the pages evicted by the first scan are decompressed instead of read from disk
+    uint64_t totalCountCompressed = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < pagesOnDisk; i++) {
+        PageGuard bf = bm->fixPage(1, i, false);
+        totalCountCompressed += reinterpret_cast<unsigned*> (bf->getData())[0];
+        bm->unfixPage(bf, false);
+    }
+    duration = std::chrono::steady_clock::now() - start;
+    StatisticsSnapshot compressed = bm->statistics();
+    assert(totalCountCompressed == totalCountOnDisk);
+    assert(pagesOnDisk <= pagesInRAM || compressed.counter(Counter::compressedHits) > 0);
+    assert(compressed.compressedBytes <= options.compressedCacheSize);
+    cout << "compressed scan throughput: " << static_cast<uint64_t> (pagesOnDisk / duration.count()) << " pages/s, compressed hits: " << compressed.counter(Counter::compressedHits) << ", load latency p50 < " << compressed.percentile(Histogram::compressedLoadLatency, 0.5) << " ns" << endl;
+
+    // the reporter dumps a last snapshot when it's stopped
+    delete bm;
+    bm = nullptr;
+    {
+        ifstream dump(statisticsFile);
+        string line;
+        getline(dump, line);
+        assert(line.find("--- statistics") == 0);
+    }
 
-    // delete temp folder and file
+    // delete temp folder and files
     if (remove(tmpFile) < 0) {
         perror("Could not delete temp file");
     }
+    if (remove(statisticsFile.c_str()) < 0) {
+        perror("Could not delete statistics file");
+    }
     if (remove(tmpDir) < 0) {
         perror("Could not delete temp folder");
     }
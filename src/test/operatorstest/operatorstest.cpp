@@ -1,3 +1,4 @@
+#include "bplustree.hpp"
 #include "buffer.hpp"
 #include "data.hpp"
 #include "file.hpp"
@@ -5,12 +6,17 @@
 #include "schema.hpp"
 #include "segment.hpp"
 
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -27,7 +33,7 @@ Record createEmployee(int64_t id, int64_t countryId, int64_t age, const std::str
     *reinterpret_cast<int64_t*> (buffer) = id;
     *reinterpret_cast<int64_t*> (buffer + sizeof (id)) = countryId;
     *reinterpret_cast<int64_t*> (buffer + sizeof (id) + sizeof (countryId)) = age;
-    std::memcpy(buffer + sizeof (id) + sizeof (countryId) + sizeof (age), paddedName.data(), paddedName.length());
+    std::memcpy(buffer + sizeof (id) + sizeof (countryId) + sizeof (age), paddedName.data(), nameLength);
     return Record(sizeof (buffer), buffer);
 }
 
@@ -38,10 +44,108 @@ Record createCountry(int64_t id, const std::string &name, uint64_t nameLength) {
     paddedName.append(nameLength - (name.length() - 1), ' ');
 
     *reinterpret_cast<int64_t*> (buffer) = id;
-    std::memcpy(buffer + sizeof (int64_t), paddedName.data(), paddedName.length());
+    std::memcpy(buffer + sizeof (int64_t), paddedName.data(), nameLength);
     return Record(sizeof (buffer), buffer);
 }
 
+void scanTable(Relation& relation, SPSegment& segment, std::atomic<bool>& stop, uint64_t& scannedTuples) {
+    // full table scans until the lookups are done
+    while (!stop.load()) {
+        TableScanOperator scan(relation, segment);
+        scan.open();
+        while (scan.next() && !stop.load()) {
+            ++scannedTuples;
+        }
+        scan.close();
+    }
+}
+
+void benchmarkLookupsWithScan(const char *tmpDir, bool directIO) {
+    // index lookups with a concurrent full scan of a table three times larger than the buffer
+    const uint64_t frames = 500;
+    const uint64_t indexKeys = 20000;
+    const uint64_t tablePages = 3 * frames;
+    const uint64_t lookups = 200000;
+
+    BufferManagerOptions options;
+    options.directIO = directIO;
+    std::shared_ptr<FileManager> fm = std::make_shared<FileManager>(tmpDir, IOBackendType::automatic, directIO);
+    std::shared_ptr<BufferManager> bm = std::make_shared<BufferManager>(tmpDir, frames, options);
+    std::shared_ptr<SegmentManager> sm = std::make_shared<SegmentManager>(tmpDir, bm, fm);
+
+    uint64_t indexSegmentId = sm->create();
+    uint64_t tableSegmentId = sm->create();
+    {
+        BPlusTree<uint64_t, uint64_t> index(indexSegmentId, sm, bm);
+        for (uint64_t i = 0; i < indexKeys; ++i) {
+            index.insert(i, i);
+        }
+
+        // one tuple per page
+        Relation relation("large", tableSegmentId);
+        relation.attributes.emplace_back("id", Attribute::Type::Integer, Attribute::TypeLength(Attribute::Type::Integer), true);
+        relation.attributes.emplace_back("payload", Attribute::Type::Char, 3000, false);
+        SPSegment table(tableSegmentId, sm, bm);
+        std::vector<char> tuple(sizeof (int64_t) + 3000, ' ');
+        std::vector<TID> tids;
+        for (uint64_t i = 0; i < tablePages; ++i) {
+            *reinterpret_cast<int64_t*> (tuple.data()) = i;
+            tids.push_back(table.insert(Record(tuple.size(), tuple.data())));
+        }
+
+        std::atomic<bool> stop(false);
+        uint64_t scannedTuples = 0;
+        boost::thread scanThread(scanTable, std::ref(relation), std::ref(table), std::ref(stop), std::ref(scannedTuples));
+
+        std::default_random_engine randomGenerator(42);
+        std::uniform_int_distribution<uint64_t> distribution(0, indexKeys - 1);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < lookups; ++i) {
+            uint64_t key = distribution(randomGenerator);
+            uint64_t value = index.lookup(key);
+            assert(value == key);
+        }
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+        stop.store(true);
+        scanThread.join();
+
+        std::cout << "index lookups during scan (direct I/O " << directIO << "): " << static_cast<uint64_t> (lookups / duration.count()) << " ops/s, scanned tuples: " << scannedTuples << std::endl;
+
+        // random tuple lookups like an index nested loop join, one by one and with one call, which batches the reads with direct I/O
+        std::uniform_int_distribution<uint64_t> tidDistribution(0, tablePages - 1);
+        std::vector<TID> probes;
+        for (uint64_t i = 0; i < 2 * tablePages; ++i) {
+            probes.push_back(tids[tidDistribution(randomGenerator)]);
+        }
+        std::vector<TID> batchedProbes(probes.begin() + tablePages, probes.end());
+        probes.erase(probes.begin() + tablePages, probes.end());
+
+        // both variants keep the records, like a join that materializes its result
+        start = std::chrono::steady_clock::now();
+        std::vector<Record> singleRecords;
+        for (TID tid : probes) {
+            singleRecords.push_back(table.lookup(tid));
+        }
+        std::chrono::duration<double> singleDuration = std::chrono::steady_clock::now() - start;
+        for (uint64_t i = 0; i < probes.size(); ++i) {
+            assert(tids[*reinterpret_cast<const int64_t*> (singleRecords[i].getData())] == probes[i]);
+        }
+
+        start = std::chrono::steady_clock::now();
+        std::vector<Record> records = table.lookup(batchedProbes);
+        std::chrono::duration<double> batchedDuration = std::chrono::steady_clock::now() - start;
+        for (uint64_t i = 0; i < batchedProbes.size(); ++i) {
+            assert(tids[*reinterpret_cast<const int64_t*> (records[i].getData())] == batchedProbes[i]);
+        }
+
+        std::cout << "tuple lookups (direct I/O " << directIO << "): single " << static_cast<uint64_t> (tablePages / singleDuration.count()) << " ops/s, vector " << static_cast<uint64_t> (tablePages / batchedDuration.count()) << " ops/s" << std::endl;
+    }
+
+    sm->remove(indexSegmentId);
+    sm->remove(tableSegmentId);
+}
+
 int main(int argc, char** argv) {
     // create tmp dir
     const char *tmpDir = "/tmp/operatorstest/";
@@ -117,6 +221,10 @@ int main(int argc, char** argv) {
         sm->remove(countrySegmentId);
     }
 
+    for (bool directIO : {false, true}) {
+        benchmarkLookupsWithScan(tmpDir, directIO);
+    }
+
     // delete tmp files and dir
     if (std::remove((std::string(tmpDir) + "segments").c_str()) < 0) {
         std::perror("Could not delete temp folder");
@@ -1,9 +1,14 @@
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <random>
 #include <string>
@@ -15,6 +20,8 @@
 #include "file.hpp"
 #include "segment.hpp"
 
+#include <boost/thread/thread.hpp>
+
 using namespace simpledb;
 using namespace std;
 
@@ -46,18 +53,21 @@ int main(int argc, char** argv) {
         }
     }
 
-    {
+    // run with writes through the page cache and with direct I/O, the records of the extents aren't aligned
+    for (bool directIO : {false, true}) {
         // Bookkeeping
         unordered_map<TID, unsigned> values; // TID -> testData entry
         unordered_map<unsigned, unsigned> usage; // pageID -> bytes used within this page
 
         // Setup everything
-        std::shared_ptr<FileManager> fm = std::make_shared<FileManager>(tmpDir);
-        std::shared_ptr<BufferManager> bm = std::make_shared<BufferManager>(tmpDir, 100);
+        BufferManagerOptions options;
+        options.directIO = directIO;
+        std::shared_ptr<FileManager> fm = std::make_shared<FileManager>(tmpDir, IOBackendType::automatic, directIO);
+        std::shared_ptr<BufferManager> bm = std::make_shared<BufferManager>(tmpDir, 100, options);
         std::shared_ptr<SegmentManager> sm = std::make_shared<SegmentManager>(tmpDir, bm, fm);
         uint64_t segmentId = sm->create();
         SPSegment sp(segmentId, sm, bm);
-        const unsigned pageSize = bm->pageSize();
+        const unsigned pageSize = bm->pageSize(segmentId);
 
         std::default_random_engine randomGenerator(88172645463325252ull);
         std::uniform_int_distribution<uint64_t> distributionTestData(0, testData.size() - 1);
@@ -73,7 +83,7 @@ int main(int argc, char** argv) {
 
             // Check that there is space available for 's'
             bool full = true;
-            for (unsigned p = 0; p < initialSize; ++p) {
+            for (unsigned p = 1; p <= initialSize; ++p) { // page 0 is the free space inventory
                 if (usage[p] + s.size() < loadFactor * pageSize) {
                     full = false;
                     break;
@@ -87,7 +97,7 @@ int main(int argc, char** argv) {
             assert(values.find(tid) == values.end()); // TIDs should not be overwritten
             values[tid] = r;
             unsigned pageId = tid.pageId().page; // extract the pageId from the TID
-            assert(pageId < initialSize); // pageId should be within [0, initialSize)
+            assert(pageId > 0 && pageId <= initialSize); // pageId should be within [1, initialSize]
             usage[pageId] += s.size();
         }
 
@@ -120,7 +130,8 @@ int main(int argc, char** argv) {
             }
         }
 
-        // Update some values ('usage' counter invalid from here on)
+        // Update some values ('usage' counter invalid from here on), while the vacuum moves redirected records back
+        unique_ptr<SPVacuum> vacuum(new SPVacuum(sp, 1));
         auto it_update = values.begin();
         for (unsigned i = 0; i < maxUpdates; ++i) {
             // Select victim
@@ -152,9 +163,529 @@ int main(int argc, char** argv) {
             //cout << rec.length() << " == " << len << endl;
         }
 
+        vacuum.reset();
+
+        // Batched lookups return the same records in the order of the TIDs
+        {
+            vector<TID> tids;
+            for (auto p : values) {
+                tids.push_back(p.first);
+            }
+            vector<Record> records = sp.lookup(tids);
+            assert(records.size() == tids.size());
+            for (unsigned i = 0; i < tids.size(); ++i) {
+                const std::string& value = testData[values[tids[i]]];
+                assert(records[i].length() == value.size());
+                assert(memcmp(records[i].getData(), value.c_str(), value.size()) == 0);
+            }
+        }
+
+        // more threads look up batches at once than batches fit into the buffer, the batches beyond the budget look up one by one
+        {
+            uint64_t probedSegmentId = sm->create();
+            SPSegment probed(probedSegmentId, sm, bm);
+            const string& s = testData[3];
+            vector<Record> records;
+            for (unsigned i = 0; i < 3 * 100 * pageSize / s.size(); ++i) { // three times the frames of the buffer
+                records.push_back(Record(s.size(), s.c_str()));
+            }
+            vector<TID> tids = probed.insertBatch(records);
+            boost::thread_group readers;
+            for (unsigned t = 0; t < 8; ++t) {
+                readers.create_thread([&, t]() {
+                    std::default_random_engine generator(t);
+                    std::uniform_int_distribution<uint64_t> distribution(0, tids.size() - 1);
+                    for (unsigned i = 0; i < 50; ++i) {
+                        vector<TID> probes;
+                        for (unsigned j = 0; j < 200; ++j) {
+                            probes.push_back(tids[distribution(generator)]);
+                        }
+                        vector<Record> found = probed.lookup(probes);
+                        for (unsigned j = 0; j < probes.size(); ++j) {
+                            assert(found[j].length() == s.size());
+                        }
+                    }
+                });
+            }
+            readers.join_all();
+            sm->remove(probedSegmentId);
+        }
+
+        // Lookups without copying borrow the records from their fixed pages, lookups of the page held by the guard don't fix it again
+        {
+            // the records fit into the buffer, so the lookups measure the fixes and not the reads
+            uint64_t viewedSegmentId = sm->create();
+            SPSegment viewed(viewedSegmentId, sm, bm);
+            vector<pair<TID, unsigned>> pageOrder;
+            for (unsigned i = 0; i < 2500; ++i) {
+                unsigned r = i % 3;
+                pageOrder.emplace_back(viewed.insert(Record(testData[r].size(), testData[r].c_str())), r);
+            }
+            assert(sm->retrieve(viewedSegmentId)->size() < 100 / 2);
+            vector<pair<TID, unsigned>> randomOrder = pageOrder;
+            shuffle(randomOrder.begin(), randomOrder.end(), randomGenerator);
+            sort(pageOrder.begin(), pageOrder.end(), [](const pair<TID, unsigned>& a, const pair<TID, unsigned>& b) {
+                return (a.first.pageId().page < b.first.pageId().page || (a.first.pageId().page == b.first.pageId().page && a.first.slotId() < b.first.slotId()));
+            });
+
+            const unsigned rounds = 50;
+            for (const vector<pair<TID, unsigned>>* lookups : {&randomOrder, &pageOrder}) {
+                PageGuard bufferFrame;
+                Record buffer;
+                uint64_t fixes = bm->statistics().counter(Counter::fixes);
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                for (unsigned round = 0; round < rounds; ++round) {
+                    for (const pair<TID, unsigned>& p : *lookups) {
+                        RecordView view = viewed.lookup(p.first, bufferFrame, buffer);
+                        assert(bufferFrame.isValid());
+                        assert(view.length() == testData[p.second].size());
+                        assert(memcmp(view.getData(), testData[p.second].c_str(), view.length()) == 0);
+                    }
+                }
+                chrono::duration<double> viewDuration = chrono::steady_clock::now() - start;
+                fixes = bm->statistics().counter(Counter::fixes) - fixes;
+                bm->unfixPage(bufferFrame, false);
+                if (lookups == &pageOrder) { // each page is fixed once per round
+                    assert(fixes <= rounds * sm->retrieve(viewedSegmentId)->size());
+                }
+
+                start = chrono::steady_clock::now();
+                for (unsigned round = 0; round < rounds; ++round) {
+                    for (const pair<TID, unsigned>& p : *lookups) {
+                        Record rec = viewed.lookup(p.first);
+                        assert(rec.length() == testData[p.second].size());
+                    }
+                }
+                chrono::duration<double> copyDuration = chrono::steady_clock::now() - start;
+
+                cout << "lookup throughput in " << (lookups == &pageOrder ? "page" : "random") << " order (direct I/O " << directIO << "): copy " << static_cast<uint64_t> (rounds * lookups->size() / copyDuration.count()) << " ops/s, view " << static_cast<uint64_t> (rounds * lookups->size() / viewDuration.count()) << " ops/s" << endl;
+            }
+
+            // scans read the records of their fixed page, with and without copying them
+            uint64_t bytes = 0;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (unsigned round = 0; round < rounds; ++round) {
+                for (unique_ptr<SPSegment::iterator> it = viewed.range(); it->isValid(); ++(*it)) {
+                    Record rec = **it;
+                    bytes += rec.length();
+                }
+            }
+            chrono::duration<double> copyDuration = chrono::steady_clock::now() - start;
+            uint64_t viewBytes = 0;
+            start = chrono::steady_clock::now();
+            for (unsigned round = 0; round < rounds; ++round) {
+                for (unique_ptr<SPSegment::iterator> it = viewed.range(); it->isValid(); ++(*it)) {
+                    viewBytes += it->view().length();
+                }
+            }
+            chrono::duration<double> viewDuration = chrono::steady_clock::now() - start;
+            assert(viewBytes == bytes);
+            sm->remove(viewedSegmentId);
+
+            cout << "scan throughput (direct I/O " << directIO << "): copy " << static_cast<uint64_t> (rounds * pageOrder.size() / copyDuration.count()) << " records/s, view " << static_cast<uint64_t> (rounds * pageOrder.size() / viewDuration.count()) << " records/s" << endl;
+        }
+
+        // the rings of open scans don't keep their frames fixed, more scans than fit into the buffer at once still get frames
+        {
+            uint64_t scannedSegmentId = sm->create();
+            SPSegment scanned(scannedSegmentId, sm, bm);
+            const string& s = testData[4];
+            vector<Record> records;
+            for (unsigned i = 0; i < 3 * 100 * pageSize / s.size(); ++i) { // three times the frames of the buffer
+                records.push_back(Record(s.size(), s.c_str()));
+            }
+            scanned.insertBatch(records);
+
+            vector<unique_ptr<SPSegment::iterator>> scans;
+            for (unsigned i = 0; i < 16; ++i) {
+                unsigned count = 0;
+                scans.push_back(scanned.range());
+                for (SPSegment::iterator& it = *scans.back(); it.isValid(); ++it) {
+                    ++count;
+                }
+                assert(count == records.size());
+            }
+            scans.clear();
+            sm->remove(scannedSegmentId);
+        }
+
+        // Large records are stored in extents
+        {
+            auto largeRecord = [](unsigned length, char c) {
+                string s(length, c);
+                for (unsigned i = 0; i < length; i += 97) {
+                    s[i] = static_cast<char> ('a' + i % 26);
+                }
+                return s;
+            };
+            const vector<string> largeData = {largeRecord(pageSize, 'x'), largeRecord(3 * pageSize + 1, 'y'), largeRecord(10 * pageSize, 'z')};
+
+            vector<pair<TID, string>> large;
+            for (const string &s : largeData) {
+                large.push_back(make_pair(sp.insert(Record(s.size(), s.c_str())), s));
+            }
+
+            // large -> larger, larger -> small, small -> large, the freed extents are reused
+            large[0].second = largeData[2] + largeData[1];
+            assert(sp.update(large[0].first, Record(large[0].second.size(), large[0].second.c_str())));
+            large[1].second = testData[0];
+            assert(sp.update(large[1].first, Record(large[1].second.size(), large[1].second.c_str())));
+            large[1].second = largeData[0];
+            assert(sp.update(large[1].first, Record(large[1].second.size(), large[1].second.c_str())));
+            TID smallTid = values.begin()->first;
+            large.push_back(make_pair(smallTid, largeData[1]));
+            assert(sp.update(smallTid, Record(largeData[1].size(), largeData[1].c_str())));
+            values.erase(smallTid);
+
+            vector<TID> largeTids;
+            for (auto p : large) {
+                Record rec = sp.lookup(p.first);
+                assert(rec.length() == p.second.size());
+                assert(memcmp(rec.getData(), p.second.c_str(), rec.length()) == 0);
+                largeTids.push_back(p.first);
+            }
+            {
+                PageGuard bufferFrame;
+                Record buffer;
+                for (auto p : large) {
+                    RecordView view = sp.lookup(p.first, bufferFrame, buffer);
+                    assert(!bufferFrame.isValid() && view.getData() == buffer.getData());
+                    assert(view.length() == p.second.size());
+                    assert(memcmp(view.getData(), p.second.c_str(), view.length()) == 0);
+                }
+            }
+            vector<Record> largeRecords = sp.lookup(largeTids);
+            for (unsigned i = 0; i < large.size(); ++i) {
+                assert(largeRecords[i].length() == large[i].second.size());
+                assert(memcmp(largeRecords[i].getData(), large[i].second.c_str(), largeRecords[i].length()) == 0);
+            }
+
+            // the iterator returns the large records as well
+            unsigned largeCount = 0;
+            unsigned largeViewCount = 0;
+            for (unique_ptr<SPSegment::iterator> it = sp.range(); it->isValid(); ++(*it)) {
+                Record rec = **it;
+                if (rec.length() >= pageSize) {
+                    ++largeCount;
+                }
+                RecordView view = it->view();
+                assert(view.length() == rec.length() && memcmp(view.getData(), rec.getData(), rec.length()) == 0);
+                if (view.length() >= pageSize) {
+                    ++largeViewCount;
+                }
+            }
+            assert(largeCount == large.size() && largeViewCount == large.size());
+
+            // the same records are read from a mapping of the segment, while it isn't modified
+            {
+                SPSegment mapped(segmentId, sm, bm, SegmentAccess::mapped);
+                for (auto p : values) {
+                    Record rec = mapped.lookup(p.first);
+                    assert(rec.length() == testData[p.second].size());
+                    assert(memcmp(rec.getData(), testData[p.second].c_str(), rec.length()) == 0);
+                }
+                PageGuard bufferFrame;
+                Record buffer;
+                for (auto p : values) {
+                    RecordView view = mapped.lookup(p.first, bufferFrame, buffer);
+                    assert(!bufferFrame.isValid());
+                    assert(view.length() == testData[p.second].size());
+                    assert(memcmp(view.getData(), testData[p.second].c_str(), view.length()) == 0);
+                }
+                vector<Record> mappedRecords = mapped.lookup(largeTids);
+                for (unsigned i = 0; i < large.size(); ++i) {
+                    assert(mappedRecords[i].length() == large[i].second.size());
+                    assert(memcmp(mappedRecords[i].getData(), large[i].second.c_str(), mappedRecords[i].length()) == 0);
+                }
+                unsigned count = 0;
+                for (unique_ptr<SPSegment::iterator> it = mapped.range(); it->isValid(); ++(*it)) {
+                    ++count;
+                }
+                assert(count == values.size() + large.size());
+            }
+
+            for (auto p : large) {
+                assert(sp.remove(p.first));
+                assert(sp.lookup(p.first).length() == 0);
+            }
+        }
+
+        // pages are compacted for records that only fit into the space of removed ones, the slots of removed records are reused
+        {
+            uint64_t compactedSegmentId = sm->create();
+            SPSegment compacted(compactedSegmentId, sm, bm);
+            const string quarter(pageSize / 4 - 64, 'q');
+            vector<TID> tids;
+            for (unsigned i = 0; i < 4; ++i) {
+                tids.push_back(compacted.insert(Record(quarter.size(), quarter.c_str())));
+                assert(tids[i].pageId() == tids[0].pageId());
+            }
+            assert(compacted.remove(tids[1]));
+            assert(compacted.remove(tids[2]));
+
+            const string half(pageSize / 2 - 64, 'h');
+            TID halfTid = compacted.insert(Record(half.size(), half.c_str()));
+            assert(halfTid.pageId() == tids[0].pageId() && halfTid.slotId() == tids[1].slotId());
+            assert(compacted.lookup(halfTid).length() == half.size());
+            assert(memcmp(compacted.lookup(tids[3]).getData(), quarter.c_str(), quarter.size()) == 0);
+
+            // a record redirected by an update is moved back by the vacuum, once its page has space again
+            const string larger(pageSize / 2 - 128, 'r');
+            assert(compacted.update(tids[0], Record(larger.size(), larger.c_str())));
+            assert(compacted.remove(halfTid));
+            assert(compacted.lookup(halfTid).length() == 0);
+            assert(get<1>(compacted.vacuum(0, numeric_limits<uint64_t>::max())) > 0);
+            assert(get<1>(compacted.vacuum(0, numeric_limits<uint64_t>::max())) == 0);
+            Record rec = compacted.lookup(tids[0]);
+            assert(rec.length() == larger.size() && memcmp(rec.getData(), larger.c_str(), larger.size()) == 0);
+            unsigned count = 0;
+            for (unique_ptr<SPSegment::iterator> it = compacted.range(); it->isValid(); ++(*it)) {
+                ++count;
+            }
+            assert(count == 2);
+
+            // the moved back record is updated and removed on its page
+            assert(compacted.update(tids[0], Record(quarter.size(), quarter.c_str())));
+            assert(compacted.remove(tids[0]));
+            assert(!compacted.remove(tids[0]));
+            sm->remove(compactedSegmentId);
+        }
+
+        // the vacuum fixes the pages of a record redirected to a lower page in page order, like the batches of lookups
+        {
+            uint64_t redirectedSegmentId = sm->create();
+            SPSegment redirected(redirectedSegmentId, sm, bm);
+            const string quarter(pageSize / 4 - 64, 'q');
+            vector<TID> tids;
+            for (unsigned i = 0; i < 8; ++i) {
+                tids.push_back(redirected.insert(Record(quarter.size(), quarter.c_str())));
+            }
+            assert(tids[0].pageId() == tids[3].pageId() && tids[4].pageId() == tids[7].pageId());
+            assert(tids[0].pageId().page < tids[4].pageId().page);
+            assert(redirected.remove(tids[1]));
+            assert(redirected.remove(tids[2]));
+            tids.erase(tids.begin() + 1, tids.begin() + 3);
+
+            // the larger record doesn't fit into its page, it's redirected to the space of the removed ones and stays there
+            const string larger(pageSize / 2 - 128, 'r');
+            assert(redirected.update(tids[2], Record(larger.size(), larger.c_str())));
+
+            std::atomic<bool> stop(false);
+            boost::thread vacuumThread([&]() {
+                while (!stop.load()) {
+                    redirected.vacuum(0, numeric_limits<uint64_t>::max());
+                }
+            });
+            for (unsigned i = 0; i < 100000; ++i) {
+                vector<Record> records = redirected.lookup(tids);
+                assert(records[2].length() == larger.size() && records[3].length() == quarter.size());
+            }
+            stop.store(true);
+            vacuumThread.join();
+            sm->remove(redirectedSegmentId);
+        }
+
+        // pages in the wide format of older segments stay readable, the vacuum converts them to the compact format
+        {
+            uint64_t wideSegmentId = sm->create();
+            SPSegment wide(wideSegmentId, sm, bm);
+            const string row(40, 'w');
+            uint64_t widePage = wide.insert(Record(row.size(), row.c_str())).pageId().page;
+            vector<TID> tids;
+            {
+                PageGuard bufferFrame = bm->fixPage(wideSegmentId, widePage, true);
+                SPPage *page = reinterpret_cast<SPPage *> (bufferFrame->getData());
+                page->init(pageSize, false);
+                while (page->hasFreeSpace(row.size())) {
+                    tids.push_back(TID(PageId(wideSegmentId, widePage), page->insert(Record(row.size(), row.c_str()), pageSize)));
+                }
+                bm->unfixPage(bufferFrame, true);
+            }
+            assert(wide.remove(tids[1]));
+            assert(wide.update(tids[2], Record(row.size() / 2, row.c_str())));
+
+            assert(get<1>(wide.vacuum(0, numeric_limits<uint64_t>::max())) > 0);
+            {
+                PageGuard bufferFrame = bm->fixPage(wideSegmentId, widePage, false);
+                assert(reinterpret_cast<SPPage *> (bufferFrame->getData())->isCompact());
+                bm->unfixPage(bufferFrame, false);
+            }
+            assert(wide.lookup(tids[1]).length() == 0);
+            assert(wide.lookup(tids[2]).length() == row.size() / 2);
+            for (unsigned i = 3; i < tids.size(); ++i) {
+                Record rec = wide.lookup(tids[i]);
+                assert(rec.length() == row.size() && memcmp(rec.getData(), row.c_str(), row.size()) == 0);
+            }
+            TID reused = wide.insert(Record(row.size(), row.c_str()));
+            assert(reused == tids[1]);
+
+            // the compact format holds more small records per page
+            vector<char> buffer(pageSize);
+            SPPage *page = reinterpret_cast<SPPage *> (buffer.data());
+            page->init(pageSize);
+            unsigned compactRecords = 0;
+            while (page->hasFreeSpace(row.size())) {
+                page->insert(Record(row.size(), row.c_str()), pageSize);
+                ++compactRecords;
+            }
+            assert(compactRecords > tids.size());
+            sm->remove(wideSegmentId);
+
+            cout << "records of " << row.size() << " bytes per page: wide " << tids.size() << ", compact " << compactRecords << endl;
+        }
+
+        // bulk loads fill new pages and write them without the buffer, the records are found like inserted ones
+        {
+            const unsigned bulkRecords = 20000;
+            vector<unsigned> bulkData;
+            vector<Record> records;
+            for (unsigned i = 0; i < bulkRecords; ++i) {
+                bulkData.push_back(randomData());
+                records.emplace_back(testData[bulkData.back()].size(), testData[bulkData.back()].c_str());
+            }
+            const string largeData(3 * pageSize, 'l');
+            records.emplace_back(largeData.size(), largeData.c_str());
+
+            uint64_t singleSegmentId = sm->create();
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            {
+                SPSegment single(singleSegmentId, sm, bm);
+                for (const Record &record : records) {
+                    single.insert(record);
+                }
+            }
+            chrono::duration<double> singleDuration = chrono::steady_clock::now() - start;
+            sm->remove(singleSegmentId);
+
+            uint64_t bulkSegmentId = sm->create();
+            SPSegment bulk(bulkSegmentId, sm, bm);
+            start = chrono::steady_clock::now();
+            vector<TID> tids = bulk.insertBatch(records);
+            chrono::duration<double> bulkDuration = chrono::steady_clock::now() - start;
+            assert(tids.size() == records.size());
+
+            vector<Record> bulkRecordsRead = bulk.lookup(tids);
+            for (unsigned i = 0; i < records.size(); ++i) {
+                assert(bulkRecordsRead[i].length() == records[i].length());
+                assert(memcmp(bulkRecordsRead[i].getData(), records[i].getData(), records[i].length()) == 0);
+            }
+            unsigned count = 0;
+            for (unique_ptr<SPSegment::iterator> it = bulk.range(); it->isValid(); ++(*it)) {
+                ++count;
+            }
+            assert(count == records.size());
+
+            // the free space of the bulk loaded pages is used by inserts, the segment doesn't grow
+            uint64_t bulkSize = sm->retrieve(bulkSegmentId)->size();
+            for (unsigned i = 0; i < 100; ++i) {
+                TID tid = bulk.insert(Record(testData[0].size(), testData[0].c_str()));
+                assert(tid.pageId().page < bulkSize);
+            }
+            assert(sm->retrieve(bulkSegmentId)->size() == bulkSize);
+            assert(bulk.remove(tids[0]));
+            sm->remove(bulkSegmentId);
+
+            cout << "insert throughput (direct I/O " << directIO << "): single " << static_cast<uint64_t> (records.size() / singleDuration.count()) << " records/s, batch " << static_cast<uint64_t> (records.size() / bulkDuration.count()) << " records/s" << endl;
+        }
+
+        // searches for small records skip the full pages of all inventory pages before them, the fixes per insert don't grow with the segment
+        {
+            const string row(40, 's');
+            vector<Record> rows;
+            for (unsigned i = 0; i < 3 * pageSize * (pageSize / 64); ++i) {
+                rows.emplace_back(row.size(), row.c_str());
+            }
+            uint64_t filledSegmentId = sm->create();
+            SPSegment filled(filledSegmentId, sm, bm);
+            filled.insertBatch(rows);
+            assert(sm->retrieve(filledSegmentId)->size() > 2 * (FSIPage::entries(pageSize) + 1));
+
+            const unsigned inserts = 1000;
+            uint64_t fixes = bm->statistics().counter(Counter::fixes);
+            for (unsigned i = 0; i < inserts; ++i) {
+                filled.insert(Record(row.size(), row.c_str()));
+            }
+            fixes = bm->statistics().counter(Counter::fixes) - fixes;
+            cout << "fixes per insert of " << row.size() << " bytes: " << static_cast<double> (fixes) / inserts << endl;
+            assert(fixes < 4 * inserts); // the inventory page, the data page and the update of its class
+            sm->remove(filledSegmentId);
+        }
+
+        // reads of one segment aren't blocked or broken by other segments being created and removed concurrently
+        {
+            volatile bool stopReading = false;
+            boost::thread reader([&]() {
+                std::unique_ptr<char[]> page(new char[pageSize]);
+                while (!stopReading) {
+                    fm->read(PageId(segmentId, 0), pageSize, page.get());
+                }
+            });
+            for (unsigned i = 0; i < 100; ++i) {
+                sm->remove(sm->create());
+            }
+            stopReading = true;
+            reader.join();
+        }
+
         sm->remove(segmentId);
     }
 
+    // segments written before the metadata file had a format version get the default page size and no extent segment,
+    // their slotted pages have no free space inventory, so the first page holds records as well
+    {
+        const uint64_t pageSize = BufferManager::PAGE_SIZE;
+        std::shared_ptr<FileManager> fm = std::make_shared<FileManager>(tmpDir);
+        std::shared_ptr<BufferManager> bm = std::make_shared<BufferManager>(tmpDir, 100);
+        {
+            // number of segments, then segment id and size of each segment
+            const uint64_t legacy[] = {3, 0, 0, 1, 2, 0, 0};
+            ofstream out(string(tmpDir) + "segments", ofstream::binary | ofstream::trunc);
+            out.write(reinterpret_cast<const char*> (legacy), sizeof (legacy));
+        }
+        {
+            // two pages in the wide format with a record each
+            std::unique_ptr<char, void (*)(void*)> pages = FileManager::alignedBuffer(2 * pageSize);
+            for (unsigned i = 0; i < 2; ++i) {
+                SPPage *page = reinterpret_cast<SPPage *> (pages.get() + i * pageSize);
+                page->init(pageSize, false);
+                page->insert(Record(testData[i].size(), testData[i].c_str()), pageSize);
+            }
+            fm->create(1);
+            fm->truncate(1, pageSize, 2);
+            fm->writePages(PageId(1, 0), pageSize, 2 * pageSize, pages.get());
+        }
+
+        // the first segment manager converts the file, the second one reads the current format
+        for (unsigned i = 0; i < 2; ++i) {
+            std::shared_ptr<SegmentManager> sm = std::make_shared<SegmentManager>(tmpDir, bm, fm);
+            std::shared_ptr<SegmentMetadata> legacySegment = sm->retrieve(1);
+            assert(legacySegment->size() == 2);
+            assert(legacySegment->pageSize() == pageSize);
+            assert(legacySegment->extentSegmentId() == 0);
+            assert(legacySegment->version() == 0);
+
+            SPSegment sp(1, sm, bm);
+            if (i == 0) {
+                // the insert uses the free space of the first page, it isn't an inventory page
+                TID tid = sp.insert(Record(testData[2].size(), testData[2].c_str()));
+                assert(tid.pageId().page == 0);
+            }
+            for (unsigned j = 0; j < 3; ++j) {
+                Record rec = sp.lookup(TID(PageId(1, j == 1 ? 1 : 0), j == 2 ? 1 : 0));
+                assert(rec.length() == testData[j].size());
+                assert(memcmp(rec.getData(), testData[j].c_str(), rec.length()) == 0);
+            }
+            unsigned count = 0;
+            for (unique_ptr<SPSegment::iterator> it = sp.range(); it->isValid(); ++(*it)) {
+                ++count;
+            }
+            assert(count == 3);
+            if (i == 1) {
+                sm->remove(1);
+            }
+        }
+    }
+
     // delete tmp files and dir
     if (remove((std::string(tmpDir) + "segments").c_str()) < 0) {
         perror("Could not delete temp folder");